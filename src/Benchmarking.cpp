@@ -0,0 +1,593 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Benchmark suite
+ *
+ * Each case is selected by name on the command line and prints
+ * exactly one JSON object on stdout. Meson stores the output in
+ * meson-logs/benchmarklog.json which can be compared between releases.
+ *
+ *   meson test --benchmark -C build
+ *   codeorb-bench parser-mix
+ */
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "SingleWireScheduling.h"
+#include "GwMsgDispatching.h"
+#include "RemoteCommanding.h"
+#include "TcpTransfering.h"
+#include "LibUart.h"
+
+#include "env.h"
+
+using namespace std;
+using namespace chrono;
+
+typedef bool (*FuncBenchmark)();
+
+struct BenchmarkCase
+{
+	const char *pName;
+	FuncBenchmark pFct;
+};
+
+struct BenchmarkResult
+{
+	const char *pName;
+	uint64_t cntOps;
+	uint64_t cntBytes;
+	uint64_t durationNs;
+};
+
+Environment env;
+
+class Benchmarking
+{
+
+public:
+
+	static bool parserNone();
+	static bool parserLog();
+	static bool parserProcFiltered();
+	static bool parserMix();
+	static bool fragmentAssembly();
+	static bool contentReceiveVirt();
+	static bool cmdQueueContention();
+	static bool dispatchFanOut();
+	static bool cmdCandidates();
+
+private:
+
+	static bool byteStreamProcess(const char *pName, const string &stream, uint64_t cntRounds);
+	static void resultPrint(const BenchmarkResult &res);
+	static void logFrameAppend(string &stream, uint8_t idContent, size_t len, bool unsolicited = false);
+	static uint64_t nsNow();
+
+};
+
+const uint64_t cCntRoundsDefault = 200;
+const size_t cCntPeersFanOut = 16;
+const size_t cCntCmdsCandidates = 4000;
+const size_t cCntThreadsContention = 4;
+const size_t cCntCmdsPerThread = 20000;
+
+static const BenchmarkCase cases[] =
+{
+	{ "parser-none",		Benchmarking::parserNone },
+	{ "parser-log",			Benchmarking::parserLog },
+	{ "parser-proc-filtered",	Benchmarking::parserProcFiltered },
+	{ "parser-mix",			Benchmarking::parserMix },
+	{ "fragment-assembly",		Benchmarking::fragmentAssembly },
+	{ "content-receive-virt",	Benchmarking::contentReceiveVirt },
+	{ "cmd-queue-contention",	Benchmarking::cmdQueueContention },
+	{ "dispatch-fan-out",		Benchmarking::dispatchFanOut },
+	{ "cmd-candidates",		Benchmarking::cmdCandidates },
+};
+
+/* SingleWire parser */
+
+bool Benchmarking::parserNone()
+{
+	string stream(64 * 1024, (char)IdContentTaToScNone);
+
+	return byteStreamProcess("parser-none", stream, cCntRoundsDefault);
+}
+
+bool Benchmarking::parserLog()
+{
+	string stream;
+
+	while (stream.size() < 64 * 1024)
+		logFrameAppend(stream, IdContentTaToScLog, 80);
+
+	return byteStreamProcess("parser-log", stream, cCntRoundsDefault);
+}
+
+bool Benchmarking::parserProcFiltered()
+{
+	string stream;
+
+	while (stream.size() < 64 * 1024)
+		logFrameAppend(stream, IdContentTaToScProc, 1024);
+
+	env.rateRefreshMs = 20000;
+
+	return byteStreamProcess("parser-proc-filtered", stream, cCntRoundsDefault);
+}
+
+/*
+ * Roughly what a busy target produces while monitored:
+ * mostly 'none', some logs, few command responses and
+ * unsolicited logs in between.
+ */
+bool Benchmarking::parserMix()
+{
+	string stream;
+	uint32_t i = 0;
+
+	while (stream.size() < 64 * 1024)
+	{
+		++i;
+
+		if (i % 10 < 6)
+		{
+			stream.push_back((char)IdContentTaToScNone);
+			continue;
+		}
+
+		if (i % 10 < 8)
+		{
+			logFrameAppend(stream, IdContentTaToScLog, 60);
+			continue;
+		}
+
+		if (i % 10 < 9)
+		{
+			logFrameAppend(stream, IdContentTaToScLog, 40, true);
+			continue;
+		}
+
+		logFrameAppend(stream, IdContentTaToScCmd, 120);
+	}
+
+	env.rateRefreshMs = 0;
+
+	return byteStreamProcess("parser-mix", stream, cCntRoundsDefault);
+}
+
+/*
+ * Content split into many cut fragments. The result
+ * is reported per assembled KB of payload.
+ */
+bool Benchmarking::fragmentAssembly()
+{
+	const size_t sizePayload = 4 * 1024;
+	const size_t sizeChunk = 32;
+	string stream;
+
+	for (size_t i = 0; i < sizePayload; i += sizeChunk)
+	{
+		stream.push_back((char)IdContentTaToScLog);
+		stream.append(sizeChunk, 'f');
+		stream.push_back((char)(i + sizeChunk < sizePayload ? IdContentCut : IdContentEnd));
+	}
+
+	SingleWireScheduling *pSched = SingleWireScheduling::create();
+	if (!pSched)
+		return false;
+
+	BenchmarkResult res = { "fragment-assembly", 0, 0, 0 };
+	uint64_t cntRounds = 4000;
+	uint64_t startNs = nsNow();
+
+	for (uint64_t r = 0; r < cntRounds; ++r)
+	{
+		for (size_t i = 0; i < stream.size(); ++i)
+			pSched->byteProcess((uint8_t)stream[i], 0);
+
+		pSched->mFragments.clear();
+	}
+
+	res.durationNs = nsNow() - startNs;
+	res.cntOps = cntRounds * sizePayload / 1024;
+	res.cntBytes = cntRounds * stream.size();
+
+	Processing::destroy(pSched);
+
+	resultPrint(res);
+
+	return true;
+}
+
+/*
+ * Same path as in operation: uartRead() on the
+ * virtual UART followed by byte processing.
+ */
+bool Benchmarking::contentReceiveVirt()
+{
+	string stream;
+
+	while (stream.size() < 32 * 1024)
+	{
+		stream.push_back((char)IdContentTaToScNone);
+		logFrameAppend(stream, IdContentTaToScLog, 60);
+	}
+
+	SingleWireScheduling *pSched = SingleWireScheduling::create();
+	if (!pSched)
+		return false;
+
+	uartVirtual = 1;
+	uartVirtualMounted = 1;
+	uartVirtualMode = UartVirtModeUart;
+
+	BenchmarkResult res = { "content-receive-virt", 0, 0, 0 };
+	uint64_t cntRounds = cCntRoundsDefault;
+	uint64_t startNs = nsNow();
+	Success success;
+
+	for (uint64_t r = 0; r < cntRounds; ++r)
+	{
+		uartVirtRcv(RefDeviceUartInvalid, stream.data(), stream.size());
+
+		while (1)
+		{
+			success = pSched->contentReceive();
+			if (success != Positive)
+				break;
+
+			++res.cntOps;
+		}
+	}
+
+	res.durationNs = nsNow() - startNs;
+	res.cntBytes = cntRounds * stream.size();
+
+	Processing::destroy(pSched);
+
+	uartVirtual = 0;
+	uartVirtualMounted = 0;
+
+	resultPrint(res);
+
+	return uartVirtDropped() == 0;
+}
+
+/* Command queue */
+
+/*
+ * Several requesters against the scheduler side
+ * consuming requests and producing responses.
+ */
+bool Benchmarking::cmdQueueContention()
+{
+	SingleWireScheduling *pSched = SingleWireScheduling::create();
+	if (!pSched)
+		return false;
+
+	uartVirtual = 1;
+	uartVirtualMounted = 1;
+	uartVirtualMode = UartVirtModeUart;
+
+	BenchmarkResult res = { "cmd-queue-contention", 0, 0, 0 };
+	atomic<size_t> cntDone(0);
+	vector<thread> threads;
+	uint64_t startNs = nsNow();
+
+	for (size_t t = 0; t < cCntThreadsContention; ++t)
+	{
+		threads.emplace_back([&cntDone, t]()
+		{
+			PrioCmd prio = (PrioCmd)(t % cNumPrioCmd);
+			uint32_t idReq;
+			string resp;
+
+			for (size_t i = 0; i < cCntCmdsPerThread; ++i)
+			{
+				while (!SingleWireScheduling::commandSend("infoHelp", idReq, prio))
+					this_thread::yield();
+
+				while (!SingleWireScheduling::commandResponseGet(idReq, resp))
+					this_thread::yield();
+			}
+
+			++cntDone;
+		});
+	}
+
+	while (cntDone < cCntThreadsContention)
+	{
+		if (pSched->cmdQueueConsume() != Positive)
+		{
+			this_thread::yield();
+			continue;
+		}
+
+		pSched->cmdResponseReceived("infoHelp|||");
+		++res.cntOps;
+	}
+
+	res.durationNs = nsNow() - startNs;
+
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	Processing::destroy(pSched);
+
+	uartVirtual = 0;
+	uartVirtualMounted = 0;
+
+	resultPrint(res);
+
+	return res.cntOps == cCntThreadsContention * cCntCmdsPerThread;
+}
+
+/* Dispatching */
+
+bool Benchmarking::dispatchFanOut()
+{
+	GwMsgDispatching *pDisp = GwMsgDispatching::create();
+	if (!pDisp)
+		return false;
+
+	RemoteDebuggingPeer peer;
+	vector<int> fdsRemote;
+	TcpTransfering *pTrans;
+	int fds[2];
+	bool ok = true;
+
+	for (size_t i = 0; i < cCntPeersFanOut; ++i)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+		{
+			ok = false;
+			break;
+		}
+
+		fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+		fdsRemote.push_back(fds[1]);
+
+		pTrans = TcpTransfering::create(fds[0]);
+		if (!pTrans)
+		{
+			close(fds[0]);
+			ok = false;
+			break;
+		}
+
+		for (int t = 0; t < 8; ++t)
+			pTrans->treeTick();
+
+		peer.type = RemotePeerLog;
+		peer.typeDesc = "log";
+		peer.pProc = pTrans;
+		peer.levelLog = 5;
+		peer.pFiltShared = NULL;
+		peer.seqHist = 0;
+
+		pDisp->mListPeers.push_back(peer);
+	}
+
+	BenchmarkResult res = { "dispatch-fan-out", 0, 0, 0 };
+	string msg(120, 'l');
+	char buf[4096];
+	uint64_t durationNs = 0, startNs;
+
+	msg += "\r\n";
+
+	for (size_t r = 0; ok && r < 20000; ++r)
+	{
+		startNs = nsNow();
+		pDisp->contentSend(msg, RemotePeerLog);
+		durationNs += nsNow() - startNs;
+
+		++res.cntOps;
+		res.cntBytes += msg.size() * fdsRemote.size();
+
+		for (size_t i = 0; i < fdsRemote.size(); ++i)
+		{
+			while (read(fdsRemote[i], buf, sizeof(buf)) > 0)
+				;
+		}
+	}
+
+	res.durationNs = durationNs;
+
+	list<RemoteDebuggingPeer>::iterator iter;
+
+	iter = pDisp->mListPeers.begin();
+	for (; iter != pDisp->mListPeers.end(); ++iter)
+		Processing::destroy(iter->pProc);
+
+	pDisp->mListPeers.clear();
+	Processing::destroy(pDisp);
+
+	for (size_t i = 0; i < fdsRemote.size(); ++i)
+		close(fdsRemote[i]);
+
+	if (!ok)
+		return false;
+
+	resultPrint(res);
+
+	return true;
+}
+
+/* Remote commanding */
+
+bool Benchmarking::cmdCandidates()
+{
+	list<string> listCmds;
+	char buf[64];
+
+	for (size_t i = 0; i < cCntCmdsCandidates; ++i)
+	{
+		snprintf(buf, sizeof(buf), "cmd%zu|c%zu|Synthetic entry|Group %zu",
+					i, i, i / 32);
+		listCmds.push_back(buf);
+	}
+
+	RemoteCommanding::listCommandsUpdate(listCmds);
+
+	RemoteCommanding *pCmd = RemoteCommanding::create(INVALID_SOCKET);
+	if (!pCmd)
+		return false;
+
+	pCmd->mTxtPrompt.ustrWorkSet(U"cmd12");
+	pCmd->mCursorEditLow = 5;
+
+	BenchmarkResult res = { "cmd-candidates", 0, 0, 0 };
+	list<const char32_t *> candidates;
+	uint64_t cntRounds = 2000;
+	uint64_t startNs = nsNow();
+
+	for (uint64_t r = 0; r < cntRounds; ++r)
+	{
+		candidates.clear();
+		pCmd->cmdCandidatesGet(candidates);
+	}
+
+	res.durationNs = nsNow() - startNs;
+	res.cntOps = cntRounds;
+	res.cntBytes = cntRounds * cCntCmdsCandidates;
+
+	Processing::destroy(pCmd);
+
+	resultPrint(res);
+
+	return candidates.size() > 0;
+}
+
+/* helpers */
+
+bool Benchmarking::byteStreamProcess(const char *pName, const string &stream, uint64_t cntRounds)
+{
+	SingleWireScheduling *pSched = SingleWireScheduling::create();
+	if (!pSched)
+		return false;
+
+	BenchmarkResult res = { pName, 0, 0, 0 };
+	uint32_t curTimeMs = 0;
+	uint64_t startNs = nsNow();
+	Success success;
+
+	for (uint64_t r = 0; r < cntRounds; ++r)
+	{
+		for (size_t i = 0; i < stream.size(); ++i)
+		{
+			success = pSched->byteProcess((uint8_t)stream[i], curTimeMs);
+			pSched->mByteLast = (uint8_t)stream[i];
+
+			if (success == Positive)
+				++res.cntOps;
+		}
+
+		++curTimeMs;
+	}
+
+	res.durationNs = nsNow() - startNs;
+	res.cntBytes = cntRounds * stream.size();
+
+	Processing::destroy(pSched);
+
+	resultPrint(res);
+
+	return true;
+}
+
+void Benchmarking::logFrameAppend(string &stream, uint8_t idContent, size_t len, bool unsolicited)
+{
+	if (unsolicited)
+		stream.push_back((char)IdContentUnsolicited);
+
+	stream.push_back((char)idContent);
+
+	for (size_t i = 0; i < len; ++i)
+		stream.push_back((char)('a' + i % 26));
+
+	stream.push_back((char)IdContentEnd);
+}
+
+void Benchmarking::resultPrint(const BenchmarkResult &res)
+{
+	double durationSec = (double)res.durationNs / 1e9;
+
+	fprintf(stdout, "{\"name\": \"%s\", \"version\": \"%s\", "
+			"\"ops\": %" PRIu64 ", \"bytes\": %" PRIu64 ", "
+			"\"duration_ns\": %" PRIu64 ", "
+			"\"ns_per_op\": %.1f, \"mb_per_s\": %.2f}\n",
+			res.pName, dVersion,
+			res.cntOps, res.cntBytes,
+			res.durationNs,
+			res.cntOps ? (double)res.durationNs / (double)res.cntOps : 0.0,
+			durationSec > 0 ? (double)res.cntBytes / durationSec / 1e6 : 0.0);
+}
+
+uint64_t Benchmarking::nsNow()
+{
+	return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+	size_t cntCases = sizeof(cases) / sizeof(cases[0]);
+	bool ok = true;
+	string name;
+
+	levelLogSet(0);
+
+	env.rateRefreshMs = 500;
+
+	for (size_t i = 0; i < cntCases; ++i)
+	{
+		if (argc >= 2 && string(argv[1]) != cases[i].pName)
+			continue;
+
+		name = cases[i].pName;
+
+		if (cases[i].pFct())
+			continue;
+
+		fprintf(stderr, "benchmark failed: %s\n", cases[i].pName);
+		ok = false;
+	}
+
+	if (!name.size())
+	{
+		fprintf(stderr, "unknown benchmark: %s\n", argc >= 2 ? argv[1] : "");
+		return 1;
+	}
+
+	return ok ? 0 : 1;
+}
+
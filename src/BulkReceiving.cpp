@@ -0,0 +1,311 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BulkReceiving.h"
+#include "SingleWireScheduling.h"
+#include "LibTime.h"
+
+#define dForEach_ProcState(gen) \
+		gen(StStart) \
+		gen(StSizeWait) \
+		gen(StDataReceive) \
+		gen(StFlush) \
+
+#define dGenProcStateEnum(s) s,
+dProcessStateEnum(ProcState);
+
+#if 1
+#define dGenProcStateString(s) #s,
+dProcessStateStr(ProcState);
+#endif
+
+using namespace std;
+
+const uint32_t cTimeoutBulkDataMs = 3000;
+const size_t cSizeBufOutMax = 16 << 10;
+
+BulkReceiving::BulkReceiving()
+	: Processing("BulkReceiving")
+	, mSource("")
+	, mNameFile("")
+	, mpTrans(NULL)
+	, mErr("")
+	, mSize(0)
+	, mCntBytes(0)
+	, mDurationMs(0)
+	, mStartMs(0)
+	, mStartAllMs(0)
+	, mIdXfer(0)
+	, mXferOpen(false)
+	, mIdReq(0)
+	, mReqPending(false)
+	, mpFile(NULL)
+	, mBufOut("")
+{
+	mState = StStart;
+}
+
+/* member functions */
+
+Success BulkReceiving::process()
+{
+	uint32_t curTimeMs = millis();
+	uint32_t diffMs = curTimeMs - mStartMs;
+	unsigned int idXfer;
+	unsigned long size;
+	Success success;
+	string resp;
+	bool ok;
+	int res;
+#if 0
+	dStateTrace;
+#endif
+	switch (mState)
+	{
+	case StStart:
+
+		if (!mSource.size())
+			return procErrLog(-1, "no source given");
+
+		if (!mNameFile.size() && !mpTrans)
+			return procErrLog(-1, "no destination given");
+
+		mStartAllMs = curTimeMs;
+
+		ok = SingleWireScheduling::bulkOpen(mIdXfer);
+		if (!ok)
+		{
+			mErr = "bulk transfer not supported or busy";
+			return Positive;
+		}
+
+		mXferOpen = true;
+
+		if (mNameFile.size())
+		{
+			mpFile = fopen(mNameFile.c_str(), "wb");
+			if (!mpFile)
+			{
+				mErr = "could not open file";
+				transferClose();
+				return Positive;
+			}
+		}
+
+		ok = SingleWireScheduling::commandSend(
+						"bulkRead " + to_string(mIdXfer) + " " + mSource,
+						mIdReq);
+		if (!ok)
+		{
+			mErr = "could not send command";
+			transferClose();
+			return Positive;
+		}
+
+		mReqPending = true;
+
+		mStartMs = curTimeMs;
+		mState = StSizeWait;
+
+		break;
+	case StSizeWait:
+
+		if (diffMs > cTimeoutCommandResponseMs)
+		{
+			mErr = "command response timeout";
+			transferClose();
+			return Positive;
+		}
+
+		ok = SingleWireScheduling::commandResponseGet(mIdReq, resp);
+		if (!ok)
+			break;
+
+		mReqPending = false;
+
+		res = sscanf(resp.c_str(), "Bulk %u %lu", &idXfer, &size);
+		if (res != 2 || idXfer != mIdXfer)
+		{
+			mErr = resp.size() ? resp : "transfer refused by target";
+			transferClose();
+			return Positive;
+		}
+
+		mSize = size;
+		procDbgLog("reading %zu bytes from '%s'", mSize, mSource.c_str());
+
+		mStartMs = curTimeMs;
+		mState = StDataReceive;
+
+		break;
+	case StDataReceive:
+
+		success = outputFlush();
+		if (success != Positive && success != Pending)
+		{
+			mErr = "could not send data";
+			transferClose();
+			return Positive;
+		}
+
+		if (mBufOut.size() > cSizeBufOutMax)
+			break;
+
+		if (diffMs > cTimeoutBulkDataMs)
+		{
+			mErr = "timeout receiving data";
+			transferClose();
+			return Positive;
+		}
+
+		success = dataReceive(curTimeMs);
+		if (success == Pending)
+			break;
+
+		transferClose();
+
+		if (success != Positive)
+		{
+			mErr = "transfer aborted";
+			return Positive;
+		}
+
+		mDurationMs = curTimeMs - mStartAllMs;
+
+		mState = StFlush;
+
+		break;
+	case StFlush:
+
+		success = outputFlush();
+		if (success == Pending)
+			break;
+
+		if (success != Positive)
+			mErr = "could not send data";
+
+		return Positive;
+
+		break;
+	default:
+		break;
+	}
+
+	return Pending;
+}
+
+Success BulkReceiving::shutdown()
+{
+	if (mReqPending)
+		SingleWireScheduling::commandCancel(mIdReq);
+
+	transferClose();
+
+	return Positive;
+}
+
+Success BulkReceiving::dataReceive(uint32_t curTimeMs)
+{
+	Success success;
+	string data;
+	size_t lenWritten;
+
+	while (mCntBytes < mSize)
+	{
+		success = SingleWireScheduling::bulkDataGet(mIdXfer, data);
+		if (success == Pending)
+			return Pending;
+
+		if (success != Positive)
+			return -1;
+
+		mStartMs = curTimeMs;
+
+		if (data.size() > mSize - mCntBytes)
+			data.resize(mSize - mCntBytes);
+
+		mCntBytes += data.size();
+
+		if (!mpFile)
+		{
+			mBufOut += data;
+
+			if (mBufOut.size() > cSizeBufOutMax)
+				return Pending;
+
+			continue;
+		}
+
+		lenWritten = fwrite(data.data(), 1, data.size(), mpFile);
+		if (lenWritten != data.size())
+			return procErrLog(-1, "could not write to file");
+	}
+
+	return Positive;
+}
+
+Success BulkReceiving::outputFlush()
+{
+	ssize_t lenDone;
+
+	if (!mBufOut.size())
+		return Positive;
+
+	if (!mpTrans->mSendReady)
+		return Pending;
+
+	lenDone = mpTrans->send(mBufOut.data(), mBufOut.size());
+	if (lenDone < 0)
+		return -1;
+
+	mBufOut.erase(0, (size_t)lenDone);
+
+	return mBufOut.size() ? Pending : Positive;
+}
+
+void BulkReceiving::transferClose()
+{
+	if (mpFile)
+	{
+		fclose(mpFile);
+		mpFile = NULL;
+	}
+
+	if (!mXferOpen)
+		return;
+
+	SingleWireScheduling::bulkClose(mIdXfer);
+	mXferOpen = false;
+}
+
+void BulkReceiving::processInfo(char *pBuf, char *pBufEnd)
+{
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("Source\t\t\t%s\n", mSource.c_str());
+	dInfo("Received\t\t%zu / %zu [bytes]\n", mCntBytes, mSize);
+}
+
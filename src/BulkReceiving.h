@@ -0,0 +1,104 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BULK_RECEIVING_H
+#define BULK_RECEIVING_H
+
+#include <cstdio>
+#include <string>
+
+#include "Processing.h"
+#include "TcpTransfering.h"
+
+/*
+ * Reads a source from the target using the bulk channel.
+ * Chunks are written to a file or a TCP client as they
+ * arrive. Nothing is buffered beyond the send buffer.
+ */
+class BulkReceiving : public Processing
+{
+
+public:
+
+	static BulkReceiving *create()
+	{
+		return new dNoThrow BulkReceiving;
+	}
+
+	// input
+	std::string mSource;
+	std::string mNameFile;
+	TcpTransfering *mpTrans;
+
+	// output
+	std::string mErr;
+	size_t mSize;
+	size_t mCntBytes;
+	uint32_t mDurationMs;
+
+protected:
+
+	BulkReceiving();
+	virtual ~BulkReceiving() {}
+
+private:
+
+	BulkReceiving(const BulkReceiving &) = delete;
+	BulkReceiving &operator=(const BulkReceiving &) = delete;
+
+	/*
+	 * Naming of functions:  objectVerb()
+	 * Example:              peerAdd()
+	 */
+
+	/* member functions */
+	Success process();
+	Success shutdown();
+	void processInfo(char *pBuf, char *pBufEnd);
+
+	Success dataReceive(uint32_t curTimeMs);
+	Success outputFlush();
+	void transferClose();
+
+	/* member variables */
+	uint32_t mStartMs;
+	uint32_t mStartAllMs;
+	uint8_t mIdXfer;
+	bool mXferOpen;
+	uint32_t mIdReq;
+	bool mReqPending;
+	FILE *mpFile;
+	std::string mBufOut;
+
+	/* static functions */
+
+	/* static variables */
+
+	/* constants */
+
+};
+
+#endif
+
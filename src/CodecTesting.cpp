@@ -0,0 +1,469 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Codec tests
+ *
+ * Round trips and rejection of damaged input for the binary
+ * formats used on the link and on disk. Each case is selected
+ * by name on the command line.
+ *
+ *   meson test -C build
+ *   codeorb-test v2-frame
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "LibSingleWireV2.h"
+#include "LibBulkTransfer.h"
+#include "LibLogStore.h"
+#include "LibSampling.h"
+#include "LibProcHistory.h"
+
+#include "env.h"
+
+using namespace std;
+
+typedef bool (*FuncTest)();
+
+struct TestCase
+{
+	const char *pName;
+	FuncTest pFct;
+};
+
+Environment env;
+
+class CodecTesting
+{
+
+public:
+
+	static bool v2Frame();
+	static bool bulkChunk();
+	static bool blockCodec();
+	static bool sampleFrame();
+	static bool procHistory();
+
+private:
+
+	static bool check(bool ok, const char *pDesc);
+	static bool v2FrameDecode(const string &frame, FrameHdrV2 &hdr, string &payload);
+	static string payloadBinary(size_t len);
+	static void u32Append(uint32_t val, string &str);
+
+};
+
+static const TestCase cases[] =
+{
+	{ "v2-frame",		CodecTesting::v2Frame },
+	{ "bulk-chunk",		CodecTesting::bulkChunk },
+	{ "block-codec",	CodecTesting::blockCodec },
+	{ "sample-frame",	CodecTesting::sampleFrame },
+	{ "proc-history",	CodecTesting::procHistory },
+};
+
+/* SingleWire v2 */
+
+bool CodecTesting::v2Frame()
+{
+	FrameHdrV2 hdr, hdrDec;
+	string payload, payloadDec, frame, frameBad;
+	bool ok = true;
+
+	hdr.type = 0x13;
+	hdr.flags = FlagFrameUnsolicited;
+	hdr.seq = 0xFE;
+
+	for (size_t len = 0; len < 3000; len += 299)
+	{
+		payload = payloadBinary(len);
+		hdr.len = (uint16_t)len;
+
+		frameV2Encode(hdr, payload, frame);
+
+		ok &= check(frame.size() == cLenFrameV2Hdr + len + cLenFrameV2Crc, "v2 frame size");
+		ok &= check(v2FrameDecode(frame, hdrDec, payloadDec), "v2 frame decode");
+		ok &= check(hdrDec.type == hdr.type && hdrDec.flags == hdr.flags &&
+				hdrDec.seq == hdr.seq && hdrDec.len == hdr.len, "v2 header round trip");
+		ok &= check(payloadDec == payload, "v2 payload round trip");
+	}
+
+	// Every single bit error must be detected
+	payload = "proc tree line";
+	hdr.len = (uint16_t)payload.size();
+	frameV2Encode(hdr, payload, frame);
+
+	for (size_t i = 1; i < frame.size(); ++i)
+	{
+		for (size_t k = 0; k < 8; ++k)
+		{
+			frameBad = frame;
+			frameBad[i] ^= (char)(1 << k);
+
+			ok &= check(!v2FrameDecode(frameBad, hdrDec, payloadDec), "v2 corrupted frame rejected");
+		}
+	}
+
+	// Truncated payload
+	frameBad = frame.substr(0, frame.size() - 1);
+	ok &= check(!v2FrameDecode(frameBad, hdrDec, payloadDec), "v2 truncated frame rejected");
+
+	// Known check values
+	ok &= check(crc16Calc("123456789", 9) == 0x29B1, "crc16 check value");
+	ok &= check(crc32Calc("123456789", 9) == 0xCBF43926, "crc32 check value");
+
+	return ok;
+}
+
+/* Bulk channel */
+
+bool CodecTesting::bulkChunk()
+{
+	string raw, esc, unesc, frame, frameBad;
+	BulkChunk chunk, chunkDec;
+	BulkAck ack, ackDec;
+	bool ok = true;
+
+	// All byte values survive escaping. No control bytes on the wire
+	raw = payloadBinary(512);
+
+	bulkEscape(raw, esc);
+
+	for (size_t i = 0; i < esc.size(); ++i)
+		ok &= check((uint8_t)esc[i] >= 0x20 || (uint8_t)esc[i] == cBulkEsc, "bulk escape output");
+
+	ok &= check(bulkUnescape(esc, unesc) && unesc == raw, "bulk escape round trip");
+
+	// Escape byte at the end has no successor
+	ok &= check(!bulkUnescape(esc + (char)cBulkEsc, unesc), "bulk truncated escape rejected");
+
+	chunk.idXfer = 3;
+	chunk.seq = 0x12345678;
+	chunk.data = payloadBinary(cLenBulkChunkMax);
+
+	bulkChunkEncode(chunk, frame);
+
+	ok &= check(bulkChunkDecode(frame, chunkDec), "bulk chunk decode");
+	ok &= check(chunkDec.idXfer == chunk.idXfer && chunkDec.seq == chunk.seq &&
+			chunkDec.data == chunk.data, "bulk chunk round trip");
+
+	ok &= check(bulkUnescape(frame, raw), "bulk chunk unescape");
+
+	// Corrupt the unescaped chunk and escape it again
+	for (size_t i = 0; i < raw.size(); i += 97)
+	{
+		string rawBad = raw;
+
+		rawBad[i] ^= 0x01;
+		bulkEscape(rawBad, frameBad);
+
+		ok &= check(!bulkChunkDecode(frameBad, chunkDec), "bulk corrupted chunk rejected");
+	}
+
+	bulkEscape(raw.substr(0, raw.size() - 1), frameBad);
+	ok &= check(!bulkChunkDecode(frameBad, chunkDec), "bulk truncated chunk rejected");
+
+	ack.idXfer = 3;
+	ack.seqNext = 0xA0B0C0D0;
+	ack.flags = BulkAckResend;
+
+	bulkAckEncode(ack, frame);
+
+	ok &= check(bulkAckDecode(frame, ackDec), "bulk ack decode");
+	ok &= check(ackDec.idXfer == ack.idXfer && ackDec.seqNext == ack.seqNext &&
+			ackDec.flags == ack.flags, "bulk ack round trip");
+	ok &= check(!bulkAckDecode(frame.substr(0, 3), ackDec), "bulk truncated ack rejected");
+
+	return ok;
+}
+
+/* Log store compression */
+
+bool CodecTesting::blockCodec()
+{
+	vector<uint8_t> src, comp, dec;
+	string str;
+	bool ok = true;
+
+	// Empty, binary, log lines and one long run
+	for (size_t variant = 0; variant < 4; ++variant)
+	{
+		src.clear();
+
+		if (variant == 1)
+			str = payloadBinary(5000);
+		else
+		if (variant == 2)
+		{
+			str.clear();
+			for (size_t i = 0; i < 200; ++i)
+				str += "1234567  SystemDebugging  INF: entry " + to_string(i % 7) + "\n";
+		}
+		else
+		if (variant == 3)
+			str = string(70000, 'x');
+		else
+			str.clear();
+
+		src.assign(str.begin(), str.end());
+
+		blockCompress(src.data(), src.size(), comp);
+
+		ok &= check(blockDecompress(comp.data(), comp.size(), src.size(), dec), "block decompress");
+		ok &= check(dec == src, "block round trip");
+
+		if (variant == 2 || variant == 3)
+			ok &= check(comp.size() < src.size() / 4, "block compression ratio");
+
+		// Nothing to truncate
+		if (!src.size())
+			continue;
+
+		// Truncated input
+		ok &= check(!blockDecompress(comp.data(), comp.size() - 1, src.size(), dec),
+				"block truncated input rejected");
+
+		// Wrong raw size
+		ok &= check(!blockDecompress(comp.data(), comp.size(), src.size() + 1, dec),
+				"block wrong size rejected");
+	}
+
+	// Literal 'a' followed by a match pointing before the start
+	const uint8_t compBad[] = { 0x10, 'a', 0x05, 0x00 };
+	ok &= check(!blockDecompress(compBad, sizeof(compBad), 5, dec), "block invalid offset rejected");
+
+	// Literal length beyond the input
+	const uint8_t compShort[] = { 0x50, 'a', 'b' };
+	ok &= check(!blockDecompress(compShort, sizeof(compShort), 5, dec), "block short literal rejected");
+
+	return ok;
+}
+
+/* Sampling */
+
+bool CodecTesting::sampleFrame()
+{
+	vector<string> channels;
+	vector<SampleBucket> buckets;
+	string raw, frame, frameBad, strErr, info;
+	uint64_t nowUs = sampleNowUs();
+	const size_t cLenSampleHdr = 11;
+	const uint16_t cnt = 10;
+	bool ok = true;
+
+	channels.push_back("adc0");
+	channels.push_back("adc1");
+
+	sampleSetStart(1, 1000, channels);
+
+	// id(1) seq(4) tsUs(4) cnt(2) values crc32(4)
+	raw.push_back(1);
+	u32Append(0, raw);
+	u32Append(5000, raw);
+	raw.push_back((char)(uint8_t)cnt);
+	raw.push_back((char)(uint8_t)(cnt >> 8));
+
+	for (int32_t i = 0; i < cnt; ++i)
+	{
+		u32Append((uint32_t)(i * 10), raw);
+		u32Append((uint32_t)(-i), raw);
+	}
+
+	u32Append(crc32Calc(raw.data(), raw.size()), raw);
+
+	bulkEscape(raw, frame);
+	sampleFrameAdd(frame, nowUs);
+
+	ok &= check(sampleRange("adc0", 0, nowUs + 1000000, 1, buckets, strErr), "sample range");
+	ok &= check(buckets.size() == 1 && buckets[0].min == 0 &&
+			buckets[0].max == 90, "sample channel 0 round trip");
+
+	ok &= check(sampleRange("adc1", 0, nowUs + 1000000, 1, buckets, strErr), "sample range");
+	ok &= check(buckets.size() == 1 && buckets[0].min == -9 &&
+			buckets[0].max == 0, "sample channel 1 round trip");
+
+	// Corrupted value and truncated frame are counted, not stored
+	frameBad = raw;
+	frameBad[cLenSampleHdr + 6] ^= 0x40;
+	bulkEscape(frameBad, frame);
+	sampleFrameAdd(frame, nowUs);
+
+	bulkEscape(raw.substr(0, raw.size() - 2), frame);
+	sampleFrameAdd(frame, nowUs);
+
+	sampleInfoGet(info);
+
+	ok &= check(info.find("Samples received: 10\n") != string::npos, "sample corrupted frame not stored");
+	ok &= check(info.find("Frames received/lost/corrupt: 1 / 0 / 2\n") != string::npos,
+			"sample corrupted frames rejected");
+
+	sampleSetStop("");
+
+	return ok;
+}
+
+/* Process tree history */
+
+bool CodecTesting::procHistory()
+{
+	vector<string> trees;
+	uint64_t seqFirst, seqLast, tsMs;
+	string tree, line;
+	bool ok = true;
+
+	// Crosses several keyframes. Line count changes in between
+	for (size_t i = 0; i < 300; ++i)
+	{
+		tree.clear();
+
+		for (size_t k = 0; k < 20 + i % 3; ++k)
+		{
+			line = "Proc" + to_string(k) + "  Pending";
+			if (k == i % 20)
+				line += "  " + to_string(i);
+
+			if (k)
+				tree += "\n";
+			tree += line;
+		}
+
+		// Complete change forces a keyframe
+		if (i == 100)
+			tree = "Restarted\nProc0";
+
+		trees.push_back(tree);
+		procHistAdd(tree);
+	}
+
+	procHistRange(seqFirst, seqLast);
+
+	ok &= check(seqFirst == 1 && seqLast == trees.size(), "history range");
+
+	for (uint64_t seq = seqFirst; seq <= seqLast; ++seq)
+	{
+		ok &= check(procHistGet(seq, tree, tsMs), "history get");
+		ok &= check(tree == trees[seq - 1], "history reconstruction");
+	}
+
+	ok &= check(!procHistGet(seqLast + 1, tree, tsMs), "history future seq rejected");
+
+	// Oldest keyframe and its deltas are dropped first
+	procHistSizeMax = 16 << 10;
+	procHistAdd(trees.back());
+	trees.push_back(trees.back());
+
+	procHistRange(seqFirst, seqLast);
+
+	ok &= check(seqFirst > 1 && seqLast == trees.size(), "history front dropped");
+	ok &= check(!procHistGet(seqFirst - 1, tree, tsMs), "history dropped seq rejected");
+
+	for (uint64_t seq = seqFirst; seq <= seqLast; ++seq)
+	{
+		ok &= check(procHistGet(seq, tree, tsMs), "history get after drop");
+		ok &= check(tree == trees[seq - 1], "history reconstruction after drop");
+	}
+
+	return ok;
+}
+
+/* helpers */
+
+bool CodecTesting::check(bool ok, const char *pDesc)
+{
+	if (!ok)
+		fprintf(stderr, "check failed: %s\n", pDesc);
+
+	return ok;
+}
+
+// Same checks as the scheduler
+bool CodecTesting::v2FrameDecode(const string &frame, FrameHdrV2 &hdr, string &payload)
+{
+	if (frame.size() < cLenFrameV2Hdr || (uint8_t)frame[0] != cSofV2)
+		return false;
+
+	if (!frameV2HdrDecode((const uint8_t *)frame.data(), hdr))
+		return false;
+
+	if (frame.size() != cLenFrameV2Hdr + hdr.len + cLenFrameV2Crc)
+		return false;
+
+	payload = frame.substr(cLenFrameV2Hdr);
+
+	if (!frameV2PayloadCheck(payload))
+		return false;
+
+	payload.resize(hdr.len);
+
+	return true;
+}
+
+string CodecTesting::payloadBinary(size_t len)
+{
+	string str;
+
+	for (size_t i = 0; i < len; ++i)
+		str.push_back((char)(uint8_t)(i * 7 + (i >> 8)));
+
+	return str;
+}
+
+void CodecTesting::u32Append(uint32_t val, string &str)
+{
+	for (size_t i = 0; i < 4; ++i)
+		str.push_back((char)(uint8_t)(val >> (8 * i)));
+}
+
+int main(int argc, char *argv[])
+{
+	size_t cntCases = sizeof(cases) / sizeof(cases[0]);
+	bool ok = true;
+	string name;
+
+	for (size_t i = 0; i < cntCases; ++i)
+	{
+		if (argc >= 2 && string(argv[1]) != cases[i].pName)
+			continue;
+
+		name = cases[i].pName;
+
+		if (cases[i].pFct())
+			continue;
+
+		fprintf(stderr, "test failed: %s\n", cases[i].pName);
+		ok = false;
+	}
+
+	if (!name.size())
+	{
+		fprintf(stderr, "unknown test: %s\n", argc >= 2 ? argv[1] : "");
+		return 1;
+	}
+
+	return ok ? 0 : 1;
+}
@@ -25,6 +25,12 @@
 
 #include "GwMsgDispatching.h"
 #include "ThreadPooling.h"
+#include "UartCapturing.h"
+#include "LibCapture.h"
+#include "LogStoring.h"
+#include "LogQuerying.h"
+#include "LibProcHistory.h"
+#include "LibStreaming.h"
 #include "LibTime.h"
 
 #include "env.h"
@@ -56,9 +62,16 @@ using namespace std;
 
 typedef list<struct RemoteDebuggingPeer>::iterator PeerIter;
 
+const uint8_t cLevelLogTargetIdle = 1;
+const uint8_t cLevelLogTargetMax = 5;
+const uint8_t cLevelLogTargetUnknown = 0xFF;
+const size_t cSizeBufInMax = 1024;
+
 const string cSeqCtrlC = "\xff\xf4\xff\xfd\x06";
 const size_t cLenSeqCtrlC = cSeqCtrlC.size();
 
+const size_t cSizeRingCapture = 4 * 1024 * 1024;
+
 GwMsgDispatching::GwMsgDispatching()
 	: Processing("GwMsgDispatching")
 	//, mStartMs(0)
@@ -68,13 +81,24 @@ GwMsgDispatching::GwMsgDispatching()
 	, mpLstLog(NULL)
 	, mpLstCmd(NULL)
 	, mpLstCmdAuto(NULL)
+	, mpLstQuery(NULL)
+	, mpLstStream(NULL)
 	, mpSched(NULL)
 	, mpGather(NULL)
 	, mCursorVisible(true)
 	, mDevUartIsOnline(true)
 	, mTargetIsOnline(false)
 	, mListPeers()
+	, mFiltersLog()
+	, mCntPeersStream(0)
+	, mLinesStream()
 	, mHdrDate("")
+	, mLevelLogTarget(cLevelLogTargetUnknown)
+	, mLevelLogIdle(cLevelLogTargetUnknown)
+	, mIdReqLevel(0)
+	, mStartLevelMs(0)
+	, mLevelLogPending(false)
+	, mpProfTick(profilingTickRegister("GwSupervising;GwMsgDispatching"))
 {
 	mState = StStart;
 }
@@ -91,8 +115,10 @@ uint32_t cntTimeCreate()
 #endif
 Success GwMsgDispatching::process()
 {
+	ProfilingTickScope profTick(mpProfTick);
 	//uint32_t curTimeMs = millis();
 	//uint32_t diffMs = curTimeMs - mStartMs;
+	PipeEntry<list<string> > entryCmds;
 	Success success;
 	bool ok;
 #if 0
@@ -122,7 +148,13 @@ Success GwMsgDispatching::process()
 		start(mpSched, DrivenByNewInternalDriver);
 #endif
 		fprintf(stdout, "%s\n", dVersion);
-		fprintf(stdout, "Using device: %s\n", env.deviceUart.c_str());
+		if (env.fileReplay.size())
+			fprintf(stdout, "Replaying: %s\n", env.fileReplay.c_str());
+		else
+		if (env.targetSim)
+			fprintf(stdout, "Using target simulator\n");
+		else
+			fprintf(stdout, "Using device: %s\n", env.deviceUart.c_str());
 
 		fprintf(stdout, "Listening on\n"
 					"  %u .. Process tree\n"
@@ -133,6 +165,9 @@ Success GwMsgDispatching::process()
 					(uint16_t)(mPortStart + 2),
 					(uint16_t)(mPortStart + 4),
 					(uint16_t)(mPortStart + 6));
+		fprintf(stdout, "  %u .. Stream (JSON lines)\n", (uint16_t)(mPortStart + 10));
+		if (mpLstQuery)
+			fprintf(stdout, "  %u .. Log Query\n", (uint16_t)(mPortStart + 8));
 		if (env.ctrlManual)
 			fprintf(stdout, "Manual control enabled\n");
 
@@ -149,6 +184,7 @@ Success GwMsgDispatching::process()
 		stateOnlineCheckAndPrint();
 		peerListUpdate();
 		commandAutoProcess();
+		queryProcess();
 		contentDistribute();
 
 		if (!mTargetIsOnline)
@@ -169,6 +205,8 @@ Success GwMsgDispatching::process()
 			break;
 		}
 
+		mpGather->depthPipelineSet((uint8_t)(env.depthGather > 0xFF ? 0xFF : env.depthGather));
+
 		//mpGather->procTreeDisplaySet(false);
 		start(mpGather, DrivenByExternalDriver);
 		ThreadPooling::procAdd(mpGather);
@@ -181,17 +219,27 @@ Success GwMsgDispatching::process()
 		stateOnlineCheckAndPrint();
 		peerListUpdate();
 		commandAutoProcess();
+		queryProcess();
 		contentDistribute();
 
 		if (!mTargetIsOnline)
 		{
+			mLevelLogTarget = cLevelLogTargetUnknown;
+			mLevelLogIdle = cLevelLogTargetUnknown;
+			mLevelLogPending = false;
+
 			mState = StTargetOffline;
 			break;
 		}
 
+		levelLogTargetUpdate();
+
 		if (!mpGather)
 			break;
 
+		if (mpGather->ppEntriesCached.get(entryCmds) > 0)
+			RemoteCommanding::listCommandsUpdate(entryCmds.particle);
+
 		success = mpGather->success();
 		if (success == Pending)
 			break;
@@ -215,6 +263,9 @@ Success GwMsgDispatching::process()
 
 Success GwMsgDispatching::shutdown()
 {
+	// Children are shut down afterwards. The writer gets everything
+	logStoreFlush(true);
+
 	if (!mCursorVisible)
 		cursorShow();
 
@@ -313,6 +364,31 @@ bool GwMsgDispatching::servicesStart()
 	mpLstCmdAuto->procTreeDisplaySet(false);
 	start(mpLstCmdAuto);
 
+	// stream
+	mpLstStream = TcpListening::create();
+	if (!mpLstStream)
+		return procErrLog(-1, "could not create process");
+
+	mpLstStream->portSet(mPortStart + 10, mListenLocal);
+	mpLstStream->maxConnQueuedSet(4);
+
+	mpLstStream->procTreeDisplaySet(false);
+	start(mpLstStream);
+
+	// log query
+	if (env.dirLogStore.size())
+	{
+		mpLstQuery = TcpListening::create();
+		if (!mpLstQuery)
+			return procErrLog(-1, "could not create process");
+
+		mpLstQuery->portSet(mPortStart + 8, mListenLocal);
+		mpLstQuery->maxConnQueuedSet(4);
+
+		mpLstQuery->procTreeDisplaySet(false);
+		start(mpLstQuery);
+	}
+
 	// thread pool
 	ThreadPooling *pPool;
 
@@ -325,6 +401,41 @@ bool GwMsgDispatching::servicesStart()
 	pPool->procTreeDisplaySet(false);
 	start(pPool);
 
+	// UART capture
+	if (env.fileCapture.size())
+	{
+		UartCapturing *pCap;
+
+		if (!captureInit(cSizeRingCapture))
+			return procErrLog(-1, "could not initialize capture");
+
+		pCap = UartCapturing::create();
+		if (!pCap)
+			return procErrLog(-1, "could not create process");
+
+		pCap->fileSet(env.fileCapture);
+
+		start(pCap, DrivenByExternalDriver);
+		ThreadPooling::procAdd(pCap);
+	}
+
+	// log store
+	if (env.dirLogStore.size())
+	{
+		LogStoring *pStore;
+
+		pStore = LogStoring::create();
+		if (!pStore)
+			return procErrLog(-1, "could not create process");
+
+		pStore->dirSet(env.dirLogStore);
+		pStore->fsyncSet((LogStoreFsync)env.fsyncLogStore);
+		pStore->sizeStoreMaxSet((uint64_t)env.sizeLogStoreMaxMb * 1024 * 1024);
+
+		start(pStore, DrivenByExternalDriver);
+		ThreadPooling::procAdd(pStore);
+	}
+
 	list<string> mEntriesDummy;
 	RemoteCommanding::listCommandsUpdate(mEntriesDummy);
 
@@ -339,6 +450,127 @@ void GwMsgDispatching::peerListUpdate()
 	peerAdd(mpLstLog, RemotePeerLog, "log");
 #endif
 	peerAdd(mpLstCmd, RemotePeerCmd, "command");
+	peerAdd(mpLstStream, RemotePeerStream, "stream");
+}
+
+/*
+ * Log entries nobody consumes still occupy the UART.
+ * The target is told the most verbose level wanted by
+ * any log peer. Capture, log store and stream clients
+ * keep everything. Without consumers the target gets
+ * the idle level. By default this is the level read
+ * from the target when it came online.
+ */
+void GwMsgDispatching::levelLogTargetUpdate()
+{
+	uint32_t curTimeMs = millis();
+	uint8_t level;
+	string resp;
+	bool ok;
+
+	if (!env.levelLogAuto)
+		return;
+
+	if (mLevelLogPending)
+	{
+		ok = SingleWireScheduling::commandResponseGet(mIdReqLevel, resp);
+		if (ok)
+		{
+			mLevelLogPending = false;
+
+			if (mLevelLogIdle == cLevelLogTargetUnknown)
+				levelLogIdleSet(resp);
+
+			return;
+		}
+
+		if (curTimeMs - mStartLevelMs < cTimeoutCommandResponseMs)
+			return;
+
+		procWrnLog("timeout on log level command");
+		SingleWireScheduling::commandCancel(mIdReqLevel);
+
+		if (mLevelLogIdle == cLevelLogTargetUnknown)
+			levelLogIdleSet("");
+
+		mLevelLogTarget = cLevelLogTargetUnknown;
+		mLevelLogPending = false;
+	}
+
+	if (mLevelLogIdle == cLevelLogTargetUnknown &&
+			env.levelLogIdle != cLevelLogIdleRestore)
+		mLevelLogIdle = env.levelLogIdle;
+
+	if (mLevelLogIdle == cLevelLogTargetUnknown)
+	{
+		// Without argument the target reports its level
+		ok = SingleWireScheduling::commandSend("levelLogSys",
+							mIdReqLevel, PrioSysHigh);
+		if (!ok)
+			return;
+
+		mStartLevelMs = curTimeMs;
+		mLevelLogPending = true;
+
+		return;
+	}
+
+	level = levelLogWanted();
+	if (level == mLevelLogTarget)
+		return;
+
+	ok = SingleWireScheduling::commandSend("levelLogSys " + to_string(level),
+						mIdReqLevel, PrioSysHigh);
+	if (!ok)
+		return;
+
+	procDbgLog("log level on target: %u", level);
+
+	mLevelLogTarget = level;
+
+	mStartLevelMs = curTimeMs;
+	mLevelLogPending = true;
+}
+
+// Level is the last word of the response
+void GwMsgDispatching::levelLogIdleSet(const string &resp)
+{
+	size_t len = resp.size();
+
+	if (len && resp[len - 1] >= '0' && resp[len - 1] <= '5' &&
+			(len == 1 || resp[len - 2] == ' '))
+	{
+		mLevelLogIdle = resp[len - 1] - '0';
+		procDbgLog("log level of target without consumers: %u", mLevelLogIdle);
+		return;
+	}
+
+	procWrnLog("could not read log level of target. Using %u", cLevelLogTargetIdle);
+	mLevelLogIdle = cLevelLogTargetIdle;
+}
+
+uint8_t GwMsgDispatching::levelLogWanted()
+{
+	uint8_t level = mLevelLogIdle;
+	PeerIter iter;
+
+	if (env.fileCapture.size() || env.dirLogStore.size())
+		return cLevelLogTargetMax;
+
+	if (mCntPeersStream)
+		return cLevelLogTargetMax;
+
+	iter = mListPeers.begin();
+	for (; iter != mListPeers.end(); ++iter)
+	{
+		if (iter->type != RemotePeerLog)
+			continue;
+
+		if (iter->levelLog > level)
+			level = iter->levelLog;
+	}
+
+	return level;
 }
 
 void GwMsgDispatching::commandAutoProcess()
@@ -366,8 +598,34 @@ void GwMsgDispatching::commandAutoProcess()
 	}
 }
 
+void GwMsgDispatching::queryProcess()
+{
+	PipeEntry<SOCKET> peerFd;
+	LogQuerying *pQuery;
+
+	if (!mpLstQuery)
+		return;
+
+	while (1)
+	{
+		if (mpLstQuery->ppPeerFd.get(peerFd) < 1)
+			break;
+
+		pQuery = LogQuerying::create(peerFd.particle);
+		if (!pQuery)
+		{
+			procErrLog(-1, "could not create process");
+			continue;
+		}
+
+		pQuery->procTreeDisplaySet(false);
+		whenFinishedRepel(start(pQuery));
+	}
+}
+
 void GwMsgDispatching::contentDistribute()
 {
+	uint64_t tsMs = logStoreNowMs();
 	string msg;
 
 	// proc tree
@@ -377,10 +635,21 @@ void GwMsgDispatching::contentDistribute()
 
 		mHdrDate = nowToStr("%Y-%m-%d  %H:%M:%S");
 
-		msgProcHdr(msg, str.size());
+		msgProcHdr(msg, str.size(), mHdrDate);
 		msg += str;
 
 		contentSend(msg, RemotePeerProc);
+
+		if (mCntPeersStream)
+		{
+			vector<string> lines;
+
+			procTreeLinesSplit(str, lines);
+			streamProcEncode(tsMs, lines, &mLinesStream, msg);
+
+			contentSend(msg, RemotePeerStream);
+			mLinesStream.swap(lines);
+		}
 	}
 
 	// log
@@ -391,15 +660,43 @@ void GwMsgDispatching::contentDistribute()
 		if (mpSched->ppEntriesLog.get(entryLog) < 1)
 			break;
 
-		msg += dColorGrey;
+		logStoreAppend(tsMs, entryLog.particle);
+
+		if (mCntPeersStream)
+		{
+			streamLogEncode(tsMs, entryLog.particle, msg);
+			contentSend(msg, RemotePeerStream);
+		}
+
+		msg = dColorGrey;
 		msg += nowToStr("%Y-%m-%d  %H:%M:%S   ");
 		msg += dColorClear;
 
 		msg += entryLog.particle;
 		msg += "\r\n";
 
-		contentSend(msg, RemotePeerLog);
+		contentLogSend(msg, entryLog.particle);
+	}
+
+	// commands
+	PipeEntry<CommandDone> entryCmd;
+
+	while (1)
+	{
+		if (mpSched->ppCmdsDone.get(entryCmd) < 1)
+			break;
+
+		if (!mCntPeersStream)
+			continue;
+
+		const CommandDone &done = entryCmd.particle;
+
+		streamCmdEncode(tsMs, done.idReq, done.cmd, done.resp, done.durationMs, msg);
+		contentSend(msg, RemotePeerStream);
 	}
+
+	// Entries kept back by logStoreAppend()
+	logStoreFlush();
 }
 
 void GwMsgDispatching::contentSend(const string &str, RemotePeerType typePeer)
@@ -413,13 +710,253 @@ void GwMsgDispatching::contentSend(const string &str, RemotePeerType typePeer)
 		if (iter->type != typePeer)
 			continue;
 
+		if (iter->seqHist)
+			continue;
+
 		pTrans = (TcpTransfering *)iter->pProc;
 
 		pTrans->send(str.data(), str.size());
 	}
 }
 
-bool GwMsgDispatching::disconnectRequestedCheck(TcpTransfering *pTrans)
+// Each filter is evaluated once per entry
+void GwMsgDispatching::contentLogSend(const string &msg, const string &entry)
+{
+	list<LogFilterShared>::iterator iterFilt;
+	LogEntryInfo info;
+	PeerIter iter;
+	TcpTransfering *pTrans;
+
+	if (mFiltersLog.size())
+		logEntryParse(entry, info);
+
+	iterFilt = mFiltersLog.begin();
+	for (; iterFilt != mFiltersLog.end(); ++iterFilt)
+		iterFilt->matched = logFilterMatch(iterFilt->filt, entry, info);
+
+	iter = mListPeers.begin();
+	for (; iter != mListPeers.end(); ++iter)
+	{
+		if (iter->type != RemotePeerLog)
+			continue;
+
+		if (iter->pFiltShared && !iter->pFiltShared->matched)
+			continue;
+
+		pTrans = (TcpTransfering *)iter->pProc;
+
+		pTrans->send(msg.data(), msg.size());
+	}
+}
+
+void GwMsgDispatching::logFilterInput(RemoteDebuggingPeer &peer, const string &data)
+{
+	TcpTransfering *pTrans = (TcpTransfering *)peer.pProc;
+	list<LogFilterShared>::iterator iterFilt;
+	LogFilterShared filtShared;
+	string line, strErr, msg;
+	bool changed = false;
+
+	peer.bufIn += data;
+
+	while (lineGet(peer.bufIn, line))
+	{
+		if (!logFilterDirective(peer.filt, line, strErr))
+		{
+			msg = "<filter: " + strErr + ">\r\n";
+			pTrans->send(msg.data(), msg.size());
+			continue;
+		}
+
+		changed = true;
+	}
+
+	if (peer.bufIn.size() > cSizeBufInMax)
+		peer.bufIn.clear();
+
+	if (!changed)
+		return;
+
+	logFilterRelease(peer);
+
+	peer.levelLog = peer.filt.level;
+
+	filtShared.key = logFilterKey(peer.filt);
+
+	iterFilt = mFiltersLog.begin();
+	for (; iterFilt != mFiltersLog.end(); ++iterFilt)
+	{
+		if (iterFilt->key == filtShared.key)
+			break;
+	}
+
+	if (iterFilt == mFiltersLog.end())
+	{
+		filtShared.filt = peer.filt;
+		filtShared.cntRefs = 0;
+		filtShared.matched = false;
+
+		mFiltersLog.push_back(filtShared);
+		iterFilt = --mFiltersLog.end();
+	}
+
+	++iterFilt->cntRefs;
+	peer.pFiltShared = &(*iterFilt);
+
+	procDbgLog("log filter set. shared filters: %zu", mFiltersLog.size());
+}
+
+void GwMsgDispatching::logFilterRelease(RemoteDebuggingPeer &peer)
+{
+	list<LogFilterShared>::iterator iterFilt;
+
+	if (!peer.pFiltShared)
+		return;
+
+	--peer.pFiltShared->cntRefs;
+
+	if (!peer.pFiltShared->cntRefs)
+	{
+		iterFilt = mFiltersLog.begin();
+		for (; iterFilt != mFiltersLog.end(); ++iterFilt)
+		{
+			if (&(*iterFilt) != peer.pFiltShared)
+				continue;
+
+			mFiltersLog.erase(iterFilt);
+			break;
+		}
+	}
+
+	peer.pFiltShared = NULL;
+}
+
+/*
+ * Time travel on the process tree port. One command per line:
+ *
+ *   b [n]      n snapshots back. Default: 1
+ *   f [n]      n snapshots forward. Leaving the end returns to live
+ *   t <sec>    Snapshot taken <sec> seconds ago
+ *   live       Follow the target again
+ */
+void GwMsgDispatching::procHistInput(RemoteDebuggingPeer &peer, const string &data)
+{
+	TcpTransfering *pTrans = (TcpTransfering *)peer.pProc;
+	uint64_t seqFirst, seqLast, seq, nowMs, agoMs;
+	string line, cmd, msg;
+	char *pEnd;
+	uint64_t cnt;
+	size_t idxSpace;
+
+	peer.bufIn += data;
+
+	while (lineGet(peer.bufIn, line))
+	{
+		idxSpace = line.find(' ');
+		cmd = line.substr(0, idxSpace);
+
+		cnt = 1;
+		pEnd = NULL;
+
+		if (idxSpace != string::npos)
+			cnt = strtoull(line.c_str() + idxSpace + 1, &pEnd, 10);
+
+		if (pEnd && *pEnd)
+			cmd = "";
+
+		procHistRange(seqFirst, seqLast);
+
+		if (seqFirst > seqLast)
+		{
+			msg = "<history empty>\r\n";
+			pTrans->send(msg.data(), msg.size());
+			continue;
+		}
+
+		seq = peer.seqHist ? peer.seqHist : seqLast;
+		if (seq < seqFirst)
+			seq = seqFirst;
+
+		if (cmd == "b")
+			seq = cnt < seq - seqFirst ? seq - cnt : seqFirst;
+		else
+		if (cmd == "f")
+			seq = cnt <= seqLast - seq ? seq + cnt : 0;
+		else
+		if (cmd == "t")
+		{
+			nowMs = logStoreNowMs();
+			agoMs = cnt * 1000;
+
+			seq = procHistSeqAt(agoMs < nowMs ? nowMs - agoMs : 0);
+		}
+		else
+		if (cmd == "live")
+			seq = 0;
+		else
+		{
+			msg = "<history: b [n] | f [n] | t <sec> | live>\r\n";
+			pTrans->send(msg.data(), msg.size());
+			continue;
+		}
+
+		peer.seqHist = seq;
+		procHistSend(peer);
+	}
+
+	if (peer.bufIn.size() > cSizeBufInMax)
+		peer.bufIn.clear();
+}
+
+void GwMsgDispatching::procHistSend(RemoteDebuggingPeer &peer)
+{
+	TcpTransfering *pTrans = (TcpTransfering *)peer.pProc;
+	uint64_t seqFirst, seqLast, tsMs;
+	string tree, msg, date;
+	char bufTime[32];
+	struct tm tmLocal;
+	time_t t;
+
+	if (!peer.seqHist)
+	{
+		const string &str = mpSched->mContentProc;
+
+		msgProcHdr(msg, str.size(), mHdrDate);
+		msg += str;
+
+		pTrans->send(msg.data(), msg.size());
+		return;
+	}
+
+	if (!procHistGet(peer.seqHist, tree, tsMs))
+	{
+		peer.seqHist = 0;
+		procHistSend(peer);
+		return;
+	}
+
+	procHistRange(seqFirst, seqLast);
+
+	t = (time_t)(tsMs / 1000);
+#if defined(_WIN32)
+	localtime_s(&tmLocal, &t);
+#else
+	localtime_r(&t, &tmLocal);
+#endif
+	strftime(bufTime, sizeof(bufTime), "%Y-%m-%d  %H:%M:%S", &tmLocal);
+
+	date = bufTime;
+	date += "." + to_string(1000 + tsMs % 1000).substr(1);
+
+	msgProcHdr(msg, tree.size(), date,
+			"History " + to_string(peer.seqHist - seqFirst + 1) +
+			"/" + to_string(seqLast - seqFirst + 1));
+	msg += tree;
+
+	pTrans->send(msg.data(), msg.size());
+}
+
+bool GwMsgDispatching::disconnectRequestedCheck(TcpTransfering *pTrans, string *pData)
 {
 	if (!pTrans)
 		return false;
@@ -455,6 +992,9 @@ bool GwMsgDispatching::disconnectRequestedCheck(TcpTransfering *pTrans)
 		return true;
 	}
 
+	if (pData)
+		pData->append(buf, (size_t)lenDone);
+
 	return false;
 #else
 	return true;
@@ -467,6 +1007,7 @@ void GwMsgDispatching::peerCheck()
 	struct RemoteDebuggingPeer peer;
 	Processing *pProc;
 	bool disconnectReq, removeReq;
+	string data;
 
 	iter = mListPeers.begin();
 	while (iter != mListPeers.end())
@@ -475,13 +1016,29 @@ void GwMsgDispatching::peerCheck()
 		pProc = peer.pProc;
 
 		if (peer.type == RemotePeerProc)
-			disconnectReq = disconnectRequestedCheck((TcpTransfering *)pProc);
+		{
+			TcpTransfering *pTrans = (TcpTransfering *)pProc;
+
+			data.clear();
+			disconnectReq = disconnectRequestedCheck(pTrans, &data);
+
+			if (!disconnectReq && data.size())
+				procHistInput(*iter, data);
+		}
 		else
 		if (peer.type == RemotePeerLog)
 		{
 			TcpTransfering *pTrans = (TcpTransfering *)pProc;
-			disconnectReq = disconnectRequestedCheck(pTrans);
+
+			data.clear();
+			disconnectReq = disconnectRequestedCheck(pTrans, &data);
+
+			if (!disconnectReq && data.size())
+				logFilterInput(*iter, data);
 		}
+		else
+		if (peer.type == RemotePeerStream)
+			disconnectReq = disconnectRequestedCheck((TcpTransfering *)pProc);
 		else
 			disconnectReq = false;
 
@@ -495,6 +1052,11 @@ void GwMsgDispatching::peerCheck()
 		procDbgLog("removing %s peer. process: %p", peer.typeDesc.c_str(), pProc);
 		repel(pProc);
 
+		logFilterRelease(*iter);
+
+		if (peer.type == RemotePeerStream)
+			streamPeerRemoved();
+
 		iter = mListPeers.erase(iter);
 	}
 }
@@ -544,31 +1106,77 @@ void GwMsgDispatching::peerAdd(TcpListening *pListener, enum RemotePeerType peer
 			const string &str = mpSched->mContentProc;
 			string msg;
 
-			msgProcHdr(msg, str.size());
+			msgProcHdr(msg, str.size(), mHdrDate);
 			msg += str;
 
 			pTrans->send(msg.data(), msg.size());
 		}
 
+		if (peerType == RemotePeerStream)
+			streamPeerAdded(pTrans);
+
 		procDbgLog("adding %s peer. process: %p", pTypeDesc, pTrans);
 
 		peer.type = peerType;
 		peer.typeDesc = pTypeDesc;
 		peer.pProc = pTrans;
+		peer.levelLog = cLevelLogTargetMax;
+		peer.bufIn = "";
+		peer.pFiltShared = NULL;
+		peer.seqHist = 0;
+
+		logFilterClear(peer.filt);
 
 		mListPeers.push_back(peer);
 	}
 }
 
-void GwMsgDispatching::msgProcHdr(string &msg, size_t sz)
+/*
+ * Command responses are only collected by the scheduler
+ * and process tree lines only kept while stream clients
+ * are connected.
+ */
+void GwMsgDispatching::streamPeerAdded(TcpTransfering *pTrans)
+{
+	string msg;
+
+	if (!mCntPeersStream)
+	{
+		procTreeLinesSplit(mpSched->mContentProc, mLinesStream);
+		mpSched->mCmdsDoneReport = true;
+	}
+
+	++mCntPeersStream;
+
+	streamHelloEncode(msg);
+	pTrans->send(msg.data(), msg.size());
+
+	streamProcEncode(logStoreNowMs(), mLinesStream, NULL, msg);
+	pTrans->send(msg.data(), msg.size());
+}
+
+void GwMsgDispatching::streamPeerRemoved()
+{
+	--mCntPeersStream;
+
+	if (mCntPeersStream)
+		return;
+
+	mLinesStream.clear();
+	mpSched->mCmdsDoneReport = false;
+}
+
+void GwMsgDispatching::msgProcHdr(string &msg, size_t sz, const string &date, const string &info)
 {
 	msg = dScreenClear;
 
 	msg += dColorGrey;
 	msg += "{CodeOrb -- ";
-	msg += mHdrDate;
+	msg += date;
 	msg += " -- Size: ";
 	msg += to_string(sz);
+	if (info.size())
+		msg += " -- " + info;
 	msg += "}";
 	msg += dColorClear;
 	msg += "\r\n\r\n";
@@ -597,8 +1205,41 @@ void GwMsgDispatching::processInfo(char *pBuf, char *pBufEnd)
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 #endif
 	dInfo("Number of peers\t\t%zu\n", mListPeers.size());
+	dInfo("Log filters\t\t%zu\n", mFiltersLog.size());
+	dInfo("Stream clients\t\t%zu\n", mCntPeersStream);
 	dInfo("Refresh rate\t\t%u [ms]\n", env.rateRefreshMs);
+
+	if (env.levelLogAuto && mLevelLogTarget != cLevelLogTargetUnknown)
+		dInfo("Log level target\t%u (auto)\n", mLevelLogTarget);
+	else
+		dInfo("Log level target\t%s\n", env.levelLogAuto ? "-" : "manual");
+
+	if (env.levelLogAuto && mLevelLogIdle != cLevelLogTargetUnknown)
+		dInfo("Log level idle\t\t%u\n", mLevelLogIdle);
+
+	profilingTickInfo(pBuf, pBufEnd, mpProfTick);
 }
 
 /* static functions */
 
+bool GwMsgDispatching::lineGet(string &buf, string &line)
+{
+	size_t idxEnd;
+
+	while (1)
+	{
+		idxEnd = buf.find('\n');
+		if (idxEnd == string::npos)
+			return false;
+
+		line = buf.substr(0, idxEnd);
+		buf.erase(0, idxEnd + 1);
+
+		if (line.size() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.size())
+			return true;
+	}
+}
+
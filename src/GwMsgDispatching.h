@@ -26,17 +26,31 @@
 #ifndef GW_MSG_DISPATCHING_H
 #define GW_MSG_DISPATCHING_H
 
+#include <vector>
+
 #include "Processing.h"
+#include "LibProfiling.h"
 #include "TcpListening.h"
 #include "TcpTransfering.h"
 #include "SingleWireScheduling.h"
 #include "RemoteCommanding.h"
 #include "InfoGathering.h"
+#include "LibLogFiltering.h"
 
 enum RemotePeerType {
 	RemotePeerProc = 0,
 	RemotePeerLog,
 	RemotePeerCmd,
+	RemotePeerStream,
+};
+
+// Peers with equal filters share the result per entry
+struct LogFilterShared
+{
+	std::string key;
+	LogFilter filt;
+	size_t cntRefs;
+	bool matched;
 };
 
 struct RemoteDebuggingPeer
@@ -44,6 +58,11 @@ struct RemoteDebuggingPeer
 	RemotePeerType type;
 	std::string typeDesc;
 	Processing *pProc;
+	uint8_t levelLog;
+	LogFilter filt;
+	std::string bufIn;
+	LogFilterShared *pFiltShared;
+	uint64_t seqHist; // 0: live
 };
 
 class GwMsgDispatching : public Processing
@@ -66,6 +85,8 @@ private:
 	GwMsgDispatching(const GwMsgDispatching &) = delete;
 	GwMsgDispatching &operator=(const GwMsgDispatching &) = delete;
 
+	friend class Benchmarking;
+
 	/*
 	 * Naming of functions:  objectVerb()
 	 * Example:              peerAdd()
@@ -80,13 +101,24 @@ private:
 	void onlinePrint(bool online = true);
 	bool servicesStart();
 	void peerListUpdate();
+	void levelLogTargetUpdate();
+	void levelLogIdleSet(const std::string &resp);
+	uint8_t levelLogWanted();
 	void commandAutoProcess();
+	void queryProcess();
 	void contentDistribute();
 	void contentSend(const std::string &str, RemotePeerType typePeer);
-	bool disconnectRequestedCheck(TcpTransfering *pTrans);
+	void contentLogSend(const std::string &msg, const std::string &entry);
+	void logFilterInput(RemoteDebuggingPeer &peer, const std::string &data);
+	void logFilterRelease(RemoteDebuggingPeer &peer);
+	void procHistInput(RemoteDebuggingPeer &peer, const std::string &data);
+	void procHistSend(RemoteDebuggingPeer &peer);
+	bool disconnectRequestedCheck(TcpTransfering *pTrans, std::string *pData = NULL);
+	void streamPeerAdded(TcpTransfering *pTrans);
+	void streamPeerRemoved();
 	void peerCheck();
 	void peerAdd(TcpListening *pListener, enum RemotePeerType peerType, const char *pTypeDesc);
-	void msgProcHdr(std::string &msg, size_t sz);
+	void msgProcHdr(std::string &msg, size_t sz, const std::string &date, const std::string &info = "");
 	void cursorShow(bool val = true);
 
 	/* member variables */
@@ -97,15 +129,27 @@ private:
 	TcpListening *mpLstLog;
 	TcpListening *mpLstCmd;
 	TcpListening *mpLstCmdAuto;
+	TcpListening *mpLstQuery;
+	TcpListening *mpLstStream;
 	SingleWireScheduling *mpSched;
 	InfoGathering *mpGather;
 	bool mCursorVisible;
 	bool mDevUartIsOnline;
 	bool mTargetIsOnline;
 	std::list<struct RemoteDebuggingPeer> mListPeers;
+	std::list<LogFilterShared> mFiltersLog;
+	size_t mCntPeersStream;
+	std::vector<std::string> mLinesStream;
 	std::string mHdrDate;
+	uint8_t mLevelLogTarget;
+	uint8_t mLevelLogIdle;
+	uint32_t mIdReqLevel;
+	uint32_t mStartLevelMs;
+	bool mLevelLogPending;
+	ProfilingTick *mpProfTick;
 
 	/* static functions */
+	static bool lineGet(std::string &buf, std::string &line);
 
 	/* static variables */
 
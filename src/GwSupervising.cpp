@@ -30,6 +30,8 @@
 
 #include "GwSupervising.h"
 #include "SystemDebugging.h"
+#include "LibTracing.h"
+#include "LibProcHistory.h"
 #include "LibFilesys.h"
 
 #include "env.h"
@@ -73,6 +75,7 @@ GwSupervising::GwSupervising()
 	//, mStartMs(0)
 	, mStateSd(StSdStart)
 	, mpApp(NULL)
+	, mpProfTick(profilingTickRegister("GwSupervising"))
 {
 	mState = StStart;
 }
@@ -81,6 +84,7 @@ GwSupervising::GwSupervising()
 
 Success GwSupervising::process()
 {
+	ProfilingTickScope profTick(mpProfTick);
 	//uint32_t curTimeMs = millis();
 	//uint32_t diffMs = curTimeMs - mStartMs;
 	//Success success;
@@ -245,6 +249,10 @@ bool GwSupervising::servicesStart()
 	pDbg->procTreeDisplaySet(false);
 	start(pDbg);
 
+	profilingCommandsRegister();
+	cmdTraceCommandsRegister();
+	procHistCommandsRegister();
+
 	mpApp = GwMsgDispatching::create();
 	if (!mpApp)
 	{
@@ -259,11 +267,10 @@ bool GwSupervising::servicesStart()
 
 void GwSupervising::processInfo(char *pBuf, char *pBufEnd)
 {
-	(void)pBuf;
-	(void)pBufEnd;
 #if 0
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 #endif
+	profilingTickInfo(pBuf, pBufEnd, mpProfTick);
 }
 
 /* static functions */
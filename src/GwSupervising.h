@@ -27,6 +27,7 @@
 #define GW_SUPERVISING_H
 
 #include "Processing.h"
+#include "LibProfiling.h"
 #include "GwMsgDispatching.h"
 
 class GwSupervising : public Processing
@@ -65,6 +66,7 @@ private:
 	//uint32_t mStartMs;
 	uint32_t mStateSd;
 	GwMsgDispatching *mpApp;
+	ProfilingTick *mpProfTick;
 
 	/* static functions */
 
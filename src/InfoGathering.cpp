@@ -23,13 +23,19 @@
   along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <fstream>
+
 #include "InfoGathering.h"
 #include "SingleWireScheduling.h"
 
 #include "LibTime.h"
 
+#include "env.h"
+
 #define dForEach_ProcState(gen) \
 		gen(StStart) \
+		gen(StIdFwSend) \
+		gen(StIdFwWait) \
 		gen(StCmdSend) \
 		gen(StRespCmdWait) \
 
@@ -44,6 +50,8 @@ dProcessStateStr(ProcState);
 using namespace std;
 
 const uint8_t cCntFiltMax = 4;
+const uint8_t cDepthPipelineDefault = 4;
+const uint8_t cDepthPipelineMax = 16;
 
 InfoGathering::InfoGathering()
 	: Processing("InfoGathering")
@@ -52,6 +60,14 @@ InfoGathering::InfoGathering()
 	, mStartAllMs(0)
 	, mIdReq(0)
 	, mCntFilt(0)
+	, mDepthPipeline(cDepthPipelineDefault)
+	, mRequests()
+	, mEntriesSeen()
+	, mDurationGatherMs(0)
+	, mLatencyEntrySumMs(0)
+	, mLatencyEntryMaxMs(0)
+	, mIdFw(0)
+	, mEntriesCached()
 {
 	mState = StStart;
 }
@@ -63,6 +79,7 @@ Success InfoGathering::process()
 	uint32_t curTimeMs = millis();
 	uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
+	string resp;
 	bool ok;
 #if 0
 	dStateTrace;
@@ -72,20 +89,63 @@ Success InfoGathering::process()
 	case StStart:
 
 		mEntriesReceived.clear();
+		mEntriesSeen.clear();
 
 		mStartAllMs = curTimeMs;
+
+		if (!env.dirCache.size() || !env.cmdIdFw.size())
+		{
+			mState = StCmdSend;
+			break;
+		}
+
+		mState = StIdFwSend;
+
+		break;
+	case StIdFwSend:
+
+		ok = SingleWireScheduling::commandSend(env.cmdIdFw, mIdReq, PrioSysHigh);
+		if (!ok)
+			return procErrLog(-1, "could not send command");
+
+		mStartMs = curTimeMs;
+		mState = StIdFwWait;
+
+		break;
+	case StIdFwWait:
+
+		if (diffMs > cTimeoutCommandResponseMs)
+		{
+			procWrnLog("timeout getting firmware identity");
+
+			mState = StCmdSend;
+			break;
+		}
+
+		ok = SingleWireScheduling::commandResponseGet(mIdReq, resp);
+		if (!ok)
+			break;
+
+		if (!idFwValid(resp))
+		{
+			procWrnLog("invalid firmware identity. Command cache disabled");
+
+			mState = StCmdSend;
+			break;
+		}
+
+		mIdFw = hashFnv1a(resp);
+		cacheLoad();
+
 		mState = StCmdSend;
 
 		break;
 	case StCmdSend:
 
-		ok = SingleWireScheduling::commandSend("infoHelp", mIdReq, PrioSysLow);
+		ok = requestsFill(curTimeMs);
 		if (!ok)
 			return procErrLog(-1, "could not send command");
 
-		//procWrnLog("request ID: %u", mIdReq);
-
-		mStartMs = curTimeMs;
 		mState = StRespCmdWait;
 
 		break;
@@ -94,17 +154,21 @@ Success InfoGathering::process()
 		if (diffMs > cTimeoutCommandResponseMs)
 		{
 			if (mCntFilt >= cCntFiltMax)
+			{
+				requestsCancel();
 				return procErrLog(-1, "timeout getting response");
+			}
 
 			++mCntFilt;
 
-			// clear?
+			SingleWireScheduling::commandCancel(mRequests.front().idReq);
+			mRequests.pop_front();
 
 			mState = StCmdSend;
 			break;
 		}
 
-		success = entryNewGet();
+		success = entryNewGet(curTimeMs);
 		if (success == Pending)
 			break;
 
@@ -114,8 +178,14 @@ Success InfoGathering::process()
 			break;
 		}
 
-		diffMs = curTimeMs - mStartAllMs;
-		procDbgLog("gathered information in %u ms", diffMs);
+		requestsCancel();
+
+		mDurationGatherMs = curTimeMs - mStartAllMs;
+		procDbgLog("gathered %zu entries in %u ms",
+					mEntriesReceived.size(), mDurationGatherMs);
+
+		if (mIdFw && mEntriesReceived != mEntriesCached)
+			cacheSave();
 #if 0
 		{
 			list<string>::iterator iter;
@@ -135,41 +205,177 @@ Success InfoGathering::process()
 	return Pending;
 }
 
-Success InfoGathering::entryNewGet()
+void InfoGathering::depthPipelineSet(uint8_t depth)
+{
+	if (!depth)
+		depth = 1;
+
+	if (depth > cDepthPipelineMax)
+		depth = cDepthPipelineMax;
+
+	mDepthPipeline = depth;
+}
+
+/*
+ * Keep several enumeration requests queued in the scheduler.
+ * The target answers them in order, so no round trip through
+ * this process is needed between two consecutive entries.
+ * Batch priority: Not spread over monitoring cycles like low
+ * priority commands.
+ */
+bool InfoGathering::requestsFill(uint32_t curTimeMs)
 {
+	RequestGathering req;
+	bool ok;
+
+	if (!mRequests.size())
+		mStartMs = curTimeMs;
+
+	while (mRequests.size() < mDepthPipeline)
+	{
+		ok = SingleWireScheduling::commandSend("infoHelp", mIdReq, PrioSysBatch);
+		if (!ok)
+			return mRequests.size() > 0; // queue full
+
+		//procWrnLog("request ID: %u", mIdReq);
+
+		req.idReq = mIdReq;
+		req.startMs = curTimeMs;
+
+		mRequests.push_back(req);
+	}
+
+	return true;
+}
+
+void InfoGathering::requestsCancel()
+{
+	list<RequestGathering>::iterator iter;
+
+	iter = mRequests.begin();
+	for (; iter != mRequests.end(); ++iter)
+		SingleWireScheduling::commandCancel(iter->idReq);
+
+	mRequests.clear();
+}
+
+Success InfoGathering::entryNewGet(uint32_t curTimeMs)
+{
+	const RequestGathering &req = mRequests.front();
+	uint32_t latencyMs;
 	string resp;
 	bool ok;
 
-	ok = SingleWireScheduling::commandResponseGet(mIdReq, resp);
+	ok = SingleWireScheduling::commandResponseGet(req.idReq, resp);
 	if (!ok)
 		return Pending;
 
 	procDbgLog("response received: %s", resp.c_str());
 	mCntFilt = 0;
 
-	ok = entryFound(resp);
-	if (ok)
+	latencyMs = curTimeMs - req.startMs;
+	mRequests.pop_front();
+
+	mStartMs = curTimeMs;
+
+	ok = mEntriesSeen.insert(resp).second;
+	if (!ok)
 		return -1;
 
+	mLatencyEntrySumMs += latencyMs;
+	if (latencyMs > mLatencyEntryMaxMs)
+		mLatencyEntryMaxMs = latencyMs;
+
 	mEntriesReceived.push_back(resp);
 
 	return Positive;
 }
 
-bool InfoGathering::entryFound(const string &entry)
+void InfoGathering::cacheLoad()
+{
+	string nameFile = fileCacheName();
+	ifstream file(nameFile.c_str());
+	string line;
+
+	if (!file.is_open())
+	{
+		procDbgLog("no cached commands for firmware %016" PRIx64, mIdFw);
+		return;
+	}
+
+	mEntriesCached.clear();
+
+	while (getline(file, line))
+	{
+		if (line.size() && line.back() == '\r')
+			line.pop_back();
+
+		if (!line.size())
+			continue;
+
+		mEntriesCached.push_back(line);
+	}
+
+	if (!mEntriesCached.size())
+		return;
+
+	procDbgLog("loaded %zu cached commands for firmware %016" PRIx64,
+				mEntriesCached.size(), mIdFw);
+
+	ppEntriesCached.commit(mEntriesCached);
+}
+
+void InfoGathering::cacheSave()
 {
-	list<string>::iterator iter;
+	string nameFile = fileCacheName();
+	string nameTmp = nameFile + ".tmp";
+	list<string>::const_iterator iter;
+	FILE *pFile;
+	bool failed = false;
+
+	// Written completely before it replaces the old file
+	pFile = fopen(nameTmp.c_str(), "w");
+	if (!pFile)
+	{
+		procWrnLog("could not open command cache file");
+		return;
+	}
 
 	iter = mEntriesReceived.begin();
 	for (; iter != mEntriesReceived.end(); ++iter)
 	{
-		if (*iter != entry)
-			continue;
+		failed |= fwrite(iter->data(), 1, iter->size(), pFile) != iter->size();
+		failed |= fputc('\n', pFile) == EOF;
+	}
+
+	failed |= fclose(pFile) != 0;
 
-		return true;
+	if (failed)
+	{
+		procWrnLog("error writing to command cache file");
+		remove(nameTmp.c_str());
+		return;
+	}
+#if defined(_WIN32)
+	remove(nameFile.c_str());
+#endif
+	if (rename(nameTmp.c_str(), nameFile.c_str()))
+	{
+		procWrnLog("could not replace command cache file");
+		remove(nameTmp.c_str());
+		return;
 	}
 
-	return false;
+	procDbgLog("command cache updated for firmware %016" PRIx64, mIdFw);
+}
+
+string InfoGathering::fileCacheName()
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%016" PRIx64, mIdFw);
+
+	return env.dirCache + "/codeorb_cmds_" + buf + ".txt";
 }
 
 void InfoGathering::processInfo(char *pBuf, char *pBufEnd)
@@ -177,7 +383,62 @@ void InfoGathering::processInfo(char *pBuf, char *pBufEnd)
 #if 1
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 #endif
+	dInfo("Firmware ID\t\t%016" PRIx64 "\n", mIdFw);
+	dInfo("Cached entries\t\t%zu\n", mEntriesCached.size());
+	dInfo("Received entries\t%zu\n", mEntriesReceived.size());
+	dInfo("Pipeline depth\t\t%u\n", mDepthPipeline);
+	dInfo("Requests pending\t%zu\n", mRequests.size());
+
+	size_t cntEntries = mEntriesReceived.size();
+
+	dInfo("Gather time\t\t%u [ms]\n", mDurationGatherMs);
+	dInfo("Entry latency avg/max\t%u / %u [ms]\n",
+			cntEntries ? (uint32_t)(mLatencyEntrySumMs / cntEntries) : 0,
+			mLatencyEntryMaxMs);
 }
 
 /* static functions */
 
+/*
+ * Targets without the identity command answer with an
+ * error text. Using that as key would let all of them
+ * share one cache file. Error texts usually name the
+ * command. With --id-fw-prefix the answer must start
+ * with the given text.
+ */
+bool InfoGathering::idFwValid(const string &resp)
+{
+	const string &prefix = env.prefixIdFw;
+
+	if (resp.size() <= prefix.size())
+		return false;
+
+	if (resp.compare(0, prefix.size(), prefix))
+		return false;
+
+	if (!prefix.size() && resp.find(env.cmdIdFw) != string::npos)
+		return false;
+
+	for (size_t i = prefix.size(); i < resp.size(); ++i)
+	{
+		if (resp[i] < 0x20 || resp[i] > 0x7E)
+			return false;
+	}
+
+	return true;
+}
+
+// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+uint64_t InfoGathering::hashFnv1a(const string &str)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		hash ^= (uint8_t)str[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
@@ -26,10 +26,19 @@
 #ifndef INFO_GATHERING_H
 #define INFO_GATHERING_H
 
+#include <cinttypes>
 #include <string>
 #include <list>
+#include <unordered_set>
 
 #include "Processing.h"
+#include "Pipe.h"
+
+struct RequestGathering
+{
+	uint32_t idReq;
+	uint32_t startMs;
+};
 
 class InfoGathering : public Processing
 {
@@ -41,7 +50,12 @@ public:
 		return new dNoThrow InfoGathering;
 	}
 
+	// input
+	void depthPipelineSet(uint8_t depth);
+
+	// output
 	std::list<std::string> mEntriesReceived;
+	Pipe<std::list<std::string> > ppEntriesCached;
 
 protected:
 
@@ -62,17 +76,30 @@ private:
 	Success process();
 	void processInfo(char *pBuf, char *pBufEnd);
 
-	Success entryNewGet();
-	bool entryFound(const std::string &entry);
+	bool requestsFill(uint32_t curTimeMs);
+	void requestsCancel();
+	Success entryNewGet(uint32_t curTimeMs);
+	void cacheLoad();
+	void cacheSave();
+	std::string fileCacheName();
 
 	/* member variables */
 	uint32_t mStartMs;
 	uint32_t mStartAllMs;
 	uint32_t mIdReq;
-	std::string mResp;
 	uint8_t mCntFilt;
+	uint8_t mDepthPipeline;
+	std::list<RequestGathering> mRequests;
+	std::unordered_set<std::string> mEntriesSeen;
+	uint32_t mDurationGatherMs;
+	uint32_t mLatencyEntrySumMs;
+	uint32_t mLatencyEntryMaxMs;
+	uint64_t mIdFw;
+	std::list<std::string> mEntriesCached;
 
 	/* static functions */
+	static bool idFwValid(const std::string &resp);
+	static uint64_t hashFnv1a(const std::string &str);
 
 	/* static variables */
 
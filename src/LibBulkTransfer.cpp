@@ -0,0 +1,184 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LibBulkTransfer.h"
+
+using namespace std;
+
+static void u32Append(uint32_t val, string &str)
+{
+	for (size_t i = 0; i < 4; ++i)
+		str.push_back((char)(uint8_t)(val >> (8 * i)));
+}
+
+static uint32_t u32Get(const string &str, size_t idx)
+{
+	uint32_t val = 0;
+
+	for (size_t i = 0; i < 4; ++i)
+		val |= (uint32_t)(uint8_t)str[idx + i] << (8 * i);
+
+	return val;
+}
+
+// https://en.wikipedia.org/wiki/Cyclic_redundancy_check
+uint32_t crc32Calc(const void *pData, size_t len, uint32_t crc)
+{
+	const uint8_t *pSrc = (const uint8_t *)pData;
+
+	crc = ~crc;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		crc ^= pSrc[i];
+
+		for (size_t k = 0; k < 8; ++k)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+
+	return ~crc;
+}
+
+void bulkEscape(const string &src, string &dst)
+{
+	uint8_t ch;
+
+	dst.clear();
+	dst.reserve(src.size() + (src.size() >> 3));
+
+	for (size_t i = 0; i < src.size(); ++i)
+	{
+		ch = (uint8_t)src[i];
+
+		if (ch >= 0x20)
+		{
+			dst.push_back((char)ch);
+			continue;
+		}
+
+		dst.push_back((char)cBulkEsc);
+		dst.push_back((char)(ch ^ 0x40));
+	}
+}
+
+bool bulkUnescape(const string &src, string &dst)
+{
+	uint8_t ch;
+
+	dst.clear();
+	dst.reserve(src.size());
+
+	for (size_t i = 0; i < src.size(); ++i)
+	{
+		ch = (uint8_t)src[i];
+
+		if (ch != cBulkEsc)
+		{
+			dst.push_back((char)ch);
+			continue;
+		}
+
+		if (++i >= src.size())
+			return false;
+
+		dst.push_back((char)((uint8_t)src[i] ^ 0x40));
+	}
+
+	return true;
+}
+
+void bulkChunkEncode(const BulkChunk &chunk, string &frame)
+{
+	string raw;
+	size_t len = chunk.data.size();
+
+	raw.reserve(cLenBulkHdr + len + 4);
+
+	raw.push_back((char)chunk.idXfer);
+	u32Append(chunk.seq, raw);
+	raw.push_back((char)(uint8_t)len);
+	raw.push_back((char)(uint8_t)(len >> 8));
+	raw += chunk.data;
+
+	u32Append(crc32Calc(raw.data(), raw.size()), raw);
+
+	bulkEscape(raw, frame);
+}
+
+bool bulkChunkDecode(const string &frame, BulkChunk &chunk)
+{
+	string raw;
+	size_t len;
+	bool ok;
+
+	ok = bulkUnescape(frame, raw);
+	if (!ok)
+		return false;
+
+	if (raw.size() < cLenBulkHdr + 4)
+		return false;
+
+	len = (uint8_t)raw[5] | (size_t)(uint8_t)raw[6] << 8;
+
+	if (len > cLenBulkChunkMax || raw.size() != cLenBulkHdr + len + 4)
+		return false;
+
+	if (crc32Calc(raw.data(), cLenBulkHdr + len) != u32Get(raw, cLenBulkHdr + len))
+		return false;
+
+	chunk.idXfer = (uint8_t)raw[0];
+	chunk.seq = u32Get(raw, 1);
+	chunk.data.assign(raw, cLenBulkHdr, len);
+
+	return true;
+}
+
+void bulkAckEncode(const BulkAck &ack, string &frame)
+{
+	string raw;
+
+	raw.push_back((char)ack.idXfer);
+	u32Append(ack.seqNext, raw);
+	raw.push_back((char)ack.flags);
+
+	bulkEscape(raw, frame);
+}
+
+bool bulkAckDecode(const string &frame, BulkAck &ack)
+{
+	string raw;
+	bool ok;
+
+	ok = bulkUnescape(frame, raw);
+	if (!ok || raw.size() != 6)
+		return false;
+
+	ack.idXfer = (uint8_t)raw[0];
+	ack.seqNext = u32Get(raw, 1);
+	ack.flags = (uint8_t)raw[5];
+
+	return true;
+}
+
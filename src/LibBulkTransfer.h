@@ -0,0 +1,101 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_BULK_TRANSFER_H
+#define LIB_BULK_TRANSFER_H
+
+#include <cinttypes>
+#include <string>
+
+/*
+ * Bulk transfer
+ *
+ * Binary content channel for memory regions, trace buffers
+ * and files. Negotiated with the system command 'bulkCaps'.
+ * The target answers 'Bulk <version> <window> <size chunk>'.
+ *
+ * A transfer is started with 'bulkRead <id> <source>' and
+ * answered with 'Bulk <id> <size>'. The target then answers
+ * data requests with chunks until all bytes are acknowledged.
+ *
+ * Target -> Scheduler
+ *   IdContentTaToScBulk <escaped chunk> IdContentEnd
+ *   Chunk: id(1) seq(4) len(2) data(len) crc32(4), little endian
+ *
+ * Scheduler -> Target. Not answered
+ *   FlowSchedToTarget IdContentScToTaBulk <escaped ack> IdContentEnd
+ *   Ack: id(1) seqNext(4) flags(1)
+ *
+ * All bytes below 0x20 are escaped with cBulkEsc followed by
+ * the byte XOR 0x40. This way payloads may contain NUL and
+ * protocol control bytes.
+ *
+ * Flow control is go-back-N. The target may send 'window'
+ * chunks beyond the last acknowledged one. Acks are
+ * cumulative. If the scheduler detects a gap or a checksum
+ * error it sends an ack with BulkAckResend and the target
+ * continues at seqNext.
+ */
+
+const uint8_t IdContentTaToScBulk = 0x14;
+const uint8_t IdContentScToTaBulk = 0x18;
+
+const uint8_t cBulkEsc = 0x10;
+const uint32_t cVersionBulk = 1;
+
+const size_t cLenBulkHdr = 7;
+const size_t cLenBulkChunkMax = 1024;
+
+enum BulkAckFlag
+{
+	BulkAckResend = 1,
+};
+
+struct BulkChunk
+{
+	uint8_t idXfer;
+	uint32_t seq;
+	std::string data;
+};
+
+struct BulkAck
+{
+	uint8_t idXfer;
+	uint32_t seqNext;
+	uint8_t flags;
+};
+
+uint32_t crc32Calc(const void *pData, size_t len, uint32_t crc = 0);
+
+void bulkEscape(const std::string &src, std::string &dst);
+bool bulkUnescape(const std::string &src, std::string &dst);
+
+void bulkChunkEncode(const BulkChunk &chunk, std::string &frame);
+bool bulkChunkDecode(const std::string &frame, BulkChunk &chunk);
+void bulkAckEncode(const BulkAck &ack, std::string &frame);
+bool bulkAckDecode(const std::string &frame, BulkAck &ack);
+
+#endif
+
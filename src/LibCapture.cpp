@@ -0,0 +1,546 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <vector>
+#include <chrono>
+
+#include "LibCapture.h"
+#include "LibSingleWireV2.h"
+#include "LibBulkTransfer.h"
+#include "LibSampling.h"
+#include "SingleWire.h"
+
+using namespace std;
+using namespace chrono;
+
+atomic<bool> captureEnabled(false);
+
+static vector<uint8_t> ringCapture;
+static size_t maskRing = 0;
+static atomic<size_t> idxWrite(0);
+static atomic<size_t> idxRead(0);
+static atomic<size_t> cntDropped(0);
+
+bool captureInit(size_t sizeRing)
+{
+	// power of two
+	if (!sizeRing || (sizeRing & (sizeRing - 1)))
+		return false;
+
+	ringCapture.resize(sizeRing);
+	maskRing = sizeRing - 1;
+
+	idxWrite = 0;
+	idxRead = 0;
+	cntDropped = 0;
+
+	captureEnabled = true;
+
+	return true;
+}
+
+static void ringWrite(size_t idx, const void *pData, size_t len)
+{
+	const uint8_t *pSrc = (const uint8_t *)pData;
+	size_t offs = idx & maskRing;
+	size_t lenFirst = PMIN(len, ringCapture.size() - offs);
+
+	memcpy(&ringCapture[offs], pSrc, lenFirst);
+
+	if (lenFirst < len)
+		memcpy(&ringCapture[0], pSrc + lenFirst, len - lenFirst);
+}
+
+static void ringRead(size_t idx, void *pData, size_t len)
+{
+	uint8_t *pDst = (uint8_t *)pData;
+	size_t offs = idx & maskRing;
+	size_t lenFirst = PMIN(len, ringCapture.size() - offs);
+
+	memcpy(pDst, &ringCapture[offs], lenFirst);
+
+	if (lenFirst < len)
+		memcpy(pDst + lenFirst, &ringCapture[0], len - lenFirst);
+}
+
+static void u64ToLe(uint8_t *pData, uint64_t val, size_t len)
+{
+	for (size_t i = 0; i < len; ++i)
+	{
+		pData[i] = (uint8_t)val;
+		val >>= 8;
+	}
+}
+
+static uint64_t leToU64(const uint8_t *pData, size_t len)
+{
+	uint64_t val = 0;
+
+	for (size_t i = len; i > 0; --i)
+		val = (val << 8) | pData[i - 1];
+
+	return val;
+}
+
+static void recordWrite(uint8_t dir, const uint8_t *pData, size_t len)
+{
+	size_t lenRecord = cLenCaptureRecordHdr + len;
+	size_t idxW = idxWrite.load(memory_order_relaxed);
+	size_t idxR = idxRead.load(memory_order_acquire);
+	uint8_t hdr[cLenCaptureRecordHdr];
+	uint64_t tsNs;
+
+	if (ringCapture.size() - (idxW - idxR) < lenRecord)
+	{
+		cntDropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	tsNs = (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+
+	u64ToLe(hdr, tsNs, 8);
+	hdr[8] = dir;
+	u64ToLe(hdr + 9, len, 4);
+
+	ringWrite(idxW, hdr, sizeof(hdr));
+	ringWrite(idxW + sizeof(hdr), pData, len);
+
+	idxWrite.store(idxW + lenRecord, memory_order_release);
+}
+
+void captureRecord(uint8_t dir, const void *pData, size_t len)
+{
+	const uint8_t *pSrc = (const uint8_t *)pData;
+	size_t lenPart;
+
+	while (len)
+	{
+		lenPart = PMIN(len, cLenCaptureDataMax);
+
+		recordWrite(dir, pSrc, lenPart);
+
+		pSrc += lenPart;
+		len -= lenPart;
+	}
+}
+
+// Whole records only. lenMax must hold at least one record
+size_t captureFetch(uint8_t *pBuf, size_t lenMax)
+{
+	size_t idxR = idxRead.load(memory_order_relaxed);
+	size_t idxW = idxWrite.load(memory_order_acquire);
+	uint8_t lenData[4];
+	size_t lenRecord, lenDone = 0;
+
+	while (idxW - idxR - lenDone >= cLenCaptureRecordHdr)
+	{
+		ringRead(idxR + lenDone + 9, lenData, sizeof(lenData));
+		lenRecord = cLenCaptureRecordHdr + (uint32_t)leToU64(lenData, sizeof(lenData));
+
+		if (lenDone + lenRecord > lenMax)
+			break;
+
+		lenDone += lenRecord;
+	}
+
+	if (!lenDone)
+		return 0;
+
+	ringRead(idxR, pBuf, lenDone);
+	idxRead.store(idxR + lenDone, memory_order_release);
+
+	return lenDone;
+}
+
+size_t captureDropped()
+{
+	return cntDropped.load(memory_order_relaxed);
+}
+
+// Decoder
+
+struct DecodingSwt
+{
+	uint32_t state;
+	uint8_t idContent;
+	bool unsolicited;
+	uint8_t byteLast;
+	string content;
+	bool v2;
+	uint8_t hdrV2[cLenFrameV2Hdr];
+	size_t lenHdrV2;
+	FrameHdrV2 frmV2;
+};
+
+enum DecodingState
+{
+	DecWait = 0,
+	DecCmdId,
+	DecData,
+	DecEndWait,
+	DecV2Hdr,
+	DecV2Payload,
+};
+
+static void frameDecodedPrint(double tsSec, uint8_t dir, const DecodingSwt &dec, const char *pSuffix = "")
+{
+	const char *pType = "unknown";
+	bool printContent = true;
+
+	if (dir == CaptureDirTx)
+		pType = "cmd";
+	else
+	if (dec.idContent == IdContentTaToScProc)
+	{
+		pType = "proc";
+		printContent = false;
+	}
+	else
+	if (dec.idContent == IdContentTaToScLog)
+		pType = "log";
+	else
+	if (dec.idContent == IdContentTaToScCmd)
+		pType = "cmd";
+	else
+	if (dec.idContent == IdContentTaToScBulk)
+	{
+		pType = "bulk";
+		printContent = false;
+	}
+	else
+	if (dec.idContent == IdContentTaToScSample)
+	{
+		pType = "smpl";
+		printContent = false;
+	}
+
+	fprintf(stdout, "%14.6f %s %-4s%s%s",
+			tsSec,
+			dir == CaptureDirTx ? "TX" : "RX",
+			pType,
+			dec.unsolicited ? " (unsolicited)" : "",
+			pSuffix);
+
+	if (printContent)
+		fprintf(stdout, " '%s'\n", dec.content.c_str());
+	else
+		fprintf(stdout, " [%zu bytes]\n", dec.content.size());
+}
+
+static void byteDecodeTx(double tsSec, uint8_t ch, DecodingSwt &dec)
+{
+	switch (dec.state)
+	{
+	case DecWait:
+
+		if (ch == FlowTargetToSched)
+		{
+			fprintf(stdout, "%14.6f TX data request\n", tsSec);
+			break;
+		}
+
+		if (ch == FlowSchedToTarget)
+			dec.state = DecCmdId;
+
+		break;
+	case DecCmdId:
+
+		dec.content.clear();
+		dec.idContent = ch;
+		dec.unsolicited = false;
+
+		dec.state = ch == IdContentScToTaCmd ? DecData : DecWait;
+
+		break;
+	case DecData:
+
+		if (!ch)
+		{
+			dec.state = DecEndWait;
+			break;
+		}
+
+		dec.content.push_back((char)ch);
+
+		break;
+	case DecEndWait:
+
+		frameDecodedPrint(tsSec, CaptureDirTx, dec, ch == IdContentEnd ? "" : " (malformed)");
+		dec.state = DecWait;
+
+		break;
+	default:
+		break;
+	}
+}
+
+static void byteDecodeRx(double tsSec, uint8_t ch, DecodingSwt &dec)
+{
+	switch (dec.state)
+	{
+	case DecWait:
+
+		if (ch == IdContentTaToScNone)
+		{
+			fprintf(stdout, "%14.6f RX none\n", tsSec);
+			break;
+		}
+
+		if (ch < IdContentTaToScProc || ch > IdContentTaToScCmd)
+			break;
+
+		dec.content.clear();
+		dec.idContent = ch;
+		dec.unsolicited = dec.byteLast == IdContentUnsolicited;
+
+		dec.state = DecData;
+
+		break;
+	case DecData:
+
+		if (ch == IdContentCut)
+		{
+			frameDecodedPrint(tsSec, CaptureDirRx, dec, " (cut)");
+			dec.state = DecWait;
+			break;
+		}
+
+		if (ch == IdContentEnd)
+		{
+			frameDecodedPrint(tsSec, CaptureDirRx, dec);
+			dec.state = DecWait;
+			break;
+		}
+
+		if (ch)
+			dec.content.push_back((char)ch);
+
+		break;
+	default:
+		break;
+	}
+
+	dec.byteLast = ch;
+}
+
+static void frameV2DecodedPrint(double tsSec, uint8_t dir, DecodingSwt &dec, bool crcOk)
+{
+	const FrameHdrV2 &frm = dec.frmV2;
+	char suffix[32];
+
+	dec.content.resize(frm.len);
+
+	snprintf(suffix, sizeof(suffix), " #%u%s", frm.seq, crcOk ? "" : " (crc error)");
+
+	if (dir == CaptureDirTx && frm.type == FlowTargetToSched)
+	{
+		fprintf(stdout, "%14.6f TX data request%s\n", tsSec, suffix);
+		return;
+	}
+
+	if (dir == CaptureDirTx && frm.type == IdFrameResend)
+	{
+		fprintf(stdout, "%14.6f TX resend request%s for #%u\n", tsSec, suffix,
+				dec.content.size() ? (uint8_t)dec.content[0] : 0);
+		return;
+	}
+
+	if (dir == CaptureDirTx && frm.type == IdContentScToTaBulk)
+	{
+		fprintf(stdout, "%14.6f TX bulk ack%s\n", tsSec, suffix);
+		return;
+	}
+
+	if (dir == CaptureDirRx && frm.type == IdContentTaToScNone)
+	{
+		fprintf(stdout, "%14.6f RX none%s\n", tsSec, suffix);
+		return;
+	}
+
+	dec.idContent = frm.type;
+	dec.unsolicited = frm.flags & FlagFrameUnsolicited;
+
+	frameDecodedPrint(tsSec, dir, dec, suffix);
+}
+
+/*
+ * v2 frames are found by their start of frame byte and
+ * checked like in the scheduler. In TX direction the init
+ * code is still v1 framed and switches back to v1.
+ */
+static void byteDecodeV2(double tsSec, uint8_t dir, uint8_t ch, DecodingSwt &dec)
+{
+	switch (dec.state)
+	{
+	case DecWait:
+
+		if (dir == CaptureDirTx && ch == FlowSchedToTarget)
+		{
+			dec.v2 = false;
+			dec.state = DecCmdId;
+			break;
+		}
+
+		if (ch != cSofV2)
+			break;
+
+		dec.hdrV2[0] = ch;
+		dec.lenHdrV2 = 1;
+
+		dec.state = DecV2Hdr;
+
+		break;
+	case DecV2Hdr:
+
+		dec.hdrV2[dec.lenHdrV2++] = ch;
+
+		if (dec.lenHdrV2 < cLenFrameV2Hdr)
+			break;
+
+		if (!frameV2HdrDecode(dec.hdrV2, dec.frmV2))
+		{
+			fprintf(stdout, "%14.6f %s header error\n", tsSec,
+					dir == CaptureDirTx ? "TX" : "RX");
+			dec.state = DecWait;
+			break;
+		}
+
+		dec.content.clear();
+		dec.state = DecV2Payload;
+
+		break;
+	case DecV2Payload:
+
+		dec.content.push_back((char)ch);
+
+		if (dec.content.size() < dec.frmV2.len + cLenFrameV2Crc)
+			break;
+
+		frameV2DecodedPrint(tsSec, dir, dec, frameV2PayloadCheck(dec.content));
+		dec.state = DecWait;
+
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Both directions switch to v2 after the target
+ * answered 'Proto 2'. The init code switches back.
+ */
+int captureDecode(const string &nameFile)
+{
+	uint8_t hdr[cLenCaptureRecordHdr];
+	char magic[cLenCaptureMagic];
+	DecodingSwt decRx = {};
+	DecodingSwt decTx;
+	vector<uint8_t> data;
+	uint64_t tsNs, tsFirstNs = 0;
+	bool tsFirstValid = false;
+	size_t lenData, cntRecords = 0;
+	double tsSec;
+	FILE *pFile;
+
+	pFile = fopen(nameFile.c_str(), "rb");
+	if (!pFile)
+	{
+		fprintf(stderr, "could not open capture file\n");
+		return 1;
+	}
+
+	if (fread(magic, 1, sizeof(magic), pFile) != sizeof(magic) ||
+			memcmp(magic, cCaptureMagic, sizeof(magic)))
+	{
+		fprintf(stderr, "not a capture file\n");
+		fclose(pFile);
+		return 1;
+	}
+
+	while (fread(hdr, 1, sizeof(hdr), pFile) == sizeof(hdr))
+	{
+		tsNs = leToU64(hdr, 8);
+		lenData = (uint32_t)leToU64(hdr + 9, 4);
+
+		if (!tsFirstValid)
+		{
+			tsFirstNs = tsNs;
+			tsFirstValid = true;
+		}
+
+		data.resize(lenData);
+
+		if (fread(data.data(), 1, lenData, pFile) != lenData)
+			break;
+
+		tsSec = (double)(tsNs - tsFirstNs) / 1e9;
+
+		for (size_t i = 0; i < lenData; ++i)
+		{
+			if (hdr[8] == CaptureDirTx)
+			{
+				if (decTx.v2)
+					byteDecodeV2(tsSec, CaptureDirTx, data[i], decTx);
+				else
+					byteDecodeTx(tsSec, data[i], decTx);
+
+				if (!decTx.v2 && decRx.v2)
+				{
+					decRx.v2 = false;
+					decRx.state = DecWait;
+				}
+
+				continue;
+			}
+
+			if (decRx.v2)
+			{
+				byteDecodeV2(tsSec, CaptureDirRx, data[i], decRx);
+				continue;
+			}
+
+			byteDecodeRx(tsSec, data[i], decRx);
+
+			if (decRx.state != DecWait || data[i] != IdContentEnd ||
+					decRx.idContent != IdContentTaToScCmd ||
+					decRx.content != "Proto " + to_string(cVersionProto))
+				continue;
+
+			decRx.v2 = true;
+			decTx.v2 = true;
+			decTx.state = DecWait;
+		}
+
+		++cntRecords;
+	}
+
+	fclose(pFile);
+
+	fprintf(stdout, "%zu records\n", cntRecords);
+
+	return 0;
+}
+
@@ -0,0 +1,60 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_CAPTURE_H
+#define LIB_CAPTURE_H
+
+#include <cinttypes>
+#include <string>
+#include <atomic>
+
+#include "LibUart.h"
+
+/*
+ * UART traffic capture
+ *
+ * Producer: uartSend() and uartRead() on the main thread
+ * Consumer: UartCapturing in the thread pool
+ *
+ * Records are stored in a lock-free single producer,
+ * single consumer ring. When the ring is full, records
+ * are dropped and counted. Larger transfers are split
+ * into records of at most cLenCaptureDataMax bytes, so
+ * every record fits into the buffer of captureFetch().
+ */
+
+const size_t cLenCaptureDataMax = 4 * 1024;
+
+extern std::atomic<bool> captureEnabled;
+
+bool captureInit(size_t sizeRing);
+void captureRecord(uint8_t dir, const void *pData, size_t len);
+size_t captureFetch(uint8_t *pBuf, size_t lenMax);
+size_t captureDropped();
+
+int captureDecode(const std::string &nameFile);
+
+#endif
+
@@ -0,0 +1,255 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "LibLogFiltering.h"
+
+using namespace std;
+
+const uint8_t cLevelLogMax = 5;
+
+static const char *tagsLevel[] =
+{
+	"ERR:", "WRN:", "INF:", "DBG:", "COR:",
+};
+
+/*
+ * Candidates are located with memchr() which is vectorized
+ * in the common C libraries. Only those are compared fully.
+ */
+static const char *strFind(const char *pHay, size_t lenHay, const char *pNeedle, size_t lenNeedle)
+{
+	const char *pEnd = pHay + lenHay;
+	const char *pCur = pHay;
+
+	if (!lenNeedle)
+		return pHay;
+
+	while ((size_t)(pEnd - pCur) >= lenNeedle)
+	{
+		pCur = (const char *)memchr(pCur, *pNeedle, (size_t)(pEnd - pCur) - lenNeedle + 1);
+		if (!pCur)
+			return NULL;
+
+		if (!memcmp(pCur + 1, pNeedle + 1, lenNeedle - 1))
+			return pCur;
+
+		++pCur;
+	}
+
+	return NULL;
+}
+
+void logFilterClear(LogFilter &filt)
+{
+	filt.level = cLevelLogMax;
+	filt.includes.clear();
+	filt.excludes.clear();
+	filt.procs.clear();
+}
+
+bool logFilterDirective(LogFilter &filt, const string &line, string &strErr)
+{
+	size_t idxSep = line.find(' ');
+	string key = line.substr(0, idxSep);
+	string val;
+
+	if (idxSep != string::npos)
+		val = line.substr(idxSep + 1);
+
+	if (key == "clear")
+	{
+		logFilterClear(filt);
+		return true;
+	}
+
+	if (key != "level" && key != "include" &&
+			key != "exclude" && key != "proc")
+	{
+		strErr = "unknown directive '" + key + "'";
+		return false;
+	}
+
+	if (!val.size())
+	{
+		strErr = "missing value for '" + key + "'";
+		return false;
+	}
+
+	if (key == "level")
+	{
+		unsigned long level = strtoul(val.c_str(), NULL, 10);
+
+		if (!level || level > cLevelLogMax)
+		{
+			strErr = "level must be 1 .. 5";
+			return false;
+		}
+
+		filt.level = (uint8_t)level;
+		return true;
+	}
+
+	if (key == "include")
+	{
+		filt.includes.push_back(val);
+		return true;
+	}
+
+	if (key == "exclude")
+	{
+		filt.excludes.push_back(val);
+		return true;
+	}
+
+	filt.procs.push_back(val);
+
+	return true;
+}
+
+// Equal filters result in equal keys
+string logFilterKey(const LogFilter &filt)
+{
+	vector<string> inc = filt.includes;
+	vector<string> exc = filt.excludes;
+	vector<string> procs = filt.procs;
+	string key;
+
+	sort(inc.begin(), inc.end());
+	sort(exc.begin(), exc.end());
+	sort(procs.begin(), procs.end());
+
+	key = to_string(filt.level);
+
+	for (size_t i = 0; i < inc.size(); ++i)
+		key += "\n+" + inc[i];
+
+	for (size_t i = 0; i < exc.size(); ++i)
+		key += "\n-" + exc[i];
+
+	for (size_t i = 0; i < procs.size(); ++i)
+		key += "\n@" + procs[i];
+
+	return key;
+}
+
+/*
+ * Entries look like
+ *   <time>  <process>  INF: <message>
+ * The process is the token in front of the level tag.
+ */
+void logEntryParse(const string &entry, LogEntryInfo &info)
+{
+	const char *pStart = entry.data();
+	const char *pTag = NULL;
+	const char *pEnd;
+	size_t len = entry.size();
+
+	info.level = 0;
+	info.pProc = NULL;
+	info.lenProc = 0;
+
+	for (size_t i = 0; i < sizeof(tagsLevel) / sizeof(*tagsLevel); ++i)
+	{
+		const char *pFound;
+
+		pFound = strFind(pStart, len, tagsLevel[i], 4);
+		if (!pFound)
+			continue;
+
+		if (pTag && pFound > pTag)
+			continue;
+
+		pTag = pFound;
+		info.level = (uint8_t)(i + 1);
+	}
+
+	if (!pTag)
+		return;
+
+	pEnd = pTag;
+
+	while (pEnd > pStart && pEnd[-1] == ' ')
+		--pEnd;
+
+	info.pProc = pEnd;
+
+	while (info.pProc > pStart && info.pProc[-1] != ' ')
+		--info.pProc;
+
+	info.lenProc = (size_t)(pEnd - info.pProc);
+}
+
+bool logFilterMatch(const LogFilter &filt, const string &entry, const LogEntryInfo &info)
+{
+	const char *pEntry = entry.data();
+	size_t lenEntry = entry.size();
+	bool found;
+
+	if (info.level && info.level > filt.level)
+		return false;
+
+	if (filt.procs.size())
+	{
+		found = false;
+
+		for (size_t i = 0; i < filt.procs.size() && !found; ++i)
+		{
+			const string &proc = filt.procs[i];
+
+			found = info.lenProc >= proc.size() &&
+				!memcmp(info.pProc, proc.data(), proc.size());
+		}
+
+		if (!found)
+			return false;
+	}
+
+	for (size_t i = 0; i < filt.excludes.size(); ++i)
+	{
+		if (strContains(pEntry, lenEntry, filt.excludes[i]))
+			return false;
+	}
+
+	if (!filt.includes.size())
+		return true;
+
+	for (size_t i = 0; i < filt.includes.size(); ++i)
+	{
+		if (strContains(pEntry, lenEntry, filt.includes[i]))
+			return true;
+	}
+
+	return false;
+}
+
+bool strContains(const char *pHay, size_t lenHay, const string &needle)
+{
+	return strFind(pHay, lenHay, needle.data(), needle.size()) != NULL;
+}
+
@@ -0,0 +1,68 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_LOG_FILTERING_H
+#define LIB_LOG_FILTERING_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/*
+ * Log subscription filters
+ *
+ * A log peer configures its filter with one directive per line:
+ *
+ *   level <n>          Maximum level. 1: ERR .. 5: COR
+ *   include <text>     Entry must contain one of the texts
+ *   exclude <text>     Entry must not contain any of the texts
+ *   proc <name>        Source process must start with one of the names
+ *   clear              Back to receiving everything
+ */
+
+struct LogEntryInfo
+{
+	uint8_t level; // 0: unknown
+	const char *pProc;
+	size_t lenProc;
+};
+
+struct LogFilter
+{
+	uint8_t level;
+	std::vector<std::string> includes;
+	std::vector<std::string> excludes;
+	std::vector<std::string> procs;
+};
+
+void logFilterClear(LogFilter &filt);
+bool logFilterDirective(LogFilter &filt, const std::string &line, std::string &strErr);
+std::string logFilterKey(const LogFilter &filt);
+void logEntryParse(const std::string &entry, LogEntryInfo &info);
+bool logFilterMatch(const LogFilter &filt, const std::string &entry, const LogEntryInfo &info);
+bool strContains(const char *pHay, size_t lenHay, const std::string &needle);
+
+#endif
+
@@ -0,0 +1,529 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "LibLogStore.h"
+
+using namespace std;
+using namespace chrono;
+
+typedef lock_guard<mutex> Guard;
+
+uint8_t logStoreEnabled = 0;
+
+static deque<LogStoreEntry> entriesHandover;
+static deque<LogStoreEntry> entriesKeptBack;
+static mutex mtxHandover;
+static size_t cntDropped = 0;
+
+const size_t cNumEntriesKeptBackMax = 64 * 1024;
+const char *cPrefixSegment = "codeorb_log_";
+
+/* dispatcher */
+
+void logStoreAppend(uint64_t tsMs, const string &str)
+{
+	if (!logStoreEnabled)
+		return;
+
+	if (entriesKeptBack.size() >= cNumEntriesKeptBackMax)
+	{
+		entriesKeptBack.pop_front();
+		++cntDropped;
+	}
+
+	entriesKeptBack.push_back(LogStoreEntry());
+	entriesKeptBack.back().tsMs = tsMs;
+	entriesKeptBack.back().str = str;
+
+	logStoreFlush();
+}
+
+void logStoreFlush(bool wait)
+{
+	if (!entriesKeptBack.size())
+		return;
+
+	unique_lock<mutex> lock(mtxHandover, defer_lock);
+
+	if (wait)
+		lock.lock();
+	else
+	if (!lock.try_lock())
+		return;
+
+	while (entriesKeptBack.size())
+	{
+		entriesHandover.push_back(LogStoreEntry());
+		entriesHandover.back().tsMs = entriesKeptBack.front().tsMs;
+		entriesHandover.back().str.swap(entriesKeptBack.front().str);
+
+		entriesKeptBack.pop_front();
+	}
+}
+
+size_t logStoreDropped()
+{
+	return cntDropped;
+}
+
+uint64_t logStoreNowMs()
+{
+	return (uint64_t)duration_cast<milliseconds>(
+				system_clock::now().time_since_epoch()).count();
+}
+
+/* writer */
+
+void logStoreFetch(deque<LogStoreEntry> &entries)
+{
+	Guard lock(mtxHandover);
+
+	if (!entries.size())
+	{
+		entries.swap(entriesHandover);
+		return;
+	}
+
+	while (entriesHandover.size())
+	{
+		entries.push_back(LogStoreEntry());
+		entries.back().tsMs = entriesHandover.front().tsMs;
+		entries.back().str.swap(entriesHandover.front().str);
+
+		entriesHandover.pop_front();
+	}
+}
+
+/* format */
+
+static void u32ToLe(uint32_t val, uint8_t *pBuf)
+{
+	for (size_t i = 0; i < 4; ++i)
+		pBuf[i] = (uint8_t)(val >> (8 * i));
+}
+
+static void u64ToLe(uint64_t val, uint8_t *pBuf)
+{
+	for (size_t i = 0; i < 8; ++i)
+		pBuf[i] = (uint8_t)(val >> (8 * i));
+}
+
+static uint32_t leToU32(const uint8_t *pBuf)
+{
+	uint32_t val = 0;
+
+	for (size_t i = 0; i < 4; ++i)
+		val |= (uint32_t)pBuf[i] << (8 * i);
+
+	return val;
+}
+
+static uint64_t leToU64(const uint8_t *pBuf)
+{
+	uint64_t val = 0;
+
+	for (size_t i = 0; i < 8; ++i)
+		val |= (uint64_t)pBuf[i] << (8 * i);
+
+	return val;
+}
+
+void logStoreBlockHdrWrite(const LogStoreBlockHdr &hdr, uint8_t *pBuf)
+{
+	u32ToLe(cLogStoreMagic, pBuf);
+	pBuf[4] = hdr.method;
+	u32ToLe(hdr.cntEntries, pBuf + 5);
+	u64ToLe(hdr.tsFirstMs, pBuf + 9);
+	u64ToLe(hdr.tsLastMs, pBuf + 17);
+	u32ToLe(hdr.lenRaw, pBuf + 25);
+	u32ToLe(hdr.lenStored, pBuf + 29);
+}
+
+bool logStoreBlockHdrRead(const uint8_t *pBuf, LogStoreBlockHdr &hdr)
+{
+	if (leToU32(pBuf) != cLogStoreMagic)
+		return false;
+
+	hdr.method = pBuf[4];
+	hdr.cntEntries = leToU32(pBuf + 5);
+	hdr.tsFirstMs = leToU64(pBuf + 9);
+	hdr.tsLastMs = leToU64(pBuf + 17);
+	hdr.lenRaw = leToU32(pBuf + 25);
+	hdr.lenStored = leToU32(pBuf + 29);
+
+	return hdr.method <= LogStoreMethodLz;
+}
+
+void logStoreIdxRecordWrite(const LogStoreIdxRecord &rec, uint8_t *pBuf)
+{
+	u64ToLe(rec.tsFirstMs, pBuf);
+	u64ToLe(rec.tsLastMs, pBuf + 8);
+	u64ToLe(rec.offset, pBuf + 16);
+	u32ToLe(rec.cntEntries, pBuf + 24);
+}
+
+void logStoreIdxRecordRead(const uint8_t *pBuf, LogStoreIdxRecord &rec)
+{
+	rec.tsFirstMs = leToU64(pBuf);
+	rec.tsLastMs = leToU64(pBuf + 8);
+	rec.offset = leToU64(pBuf + 16);
+	rec.cntEntries = leToU32(pBuf + 24);
+}
+
+void logStoreEntryEncode(const LogStoreEntry &entry, vector<uint8_t> &buf)
+{
+	size_t idx = buf.size();
+
+	buf.resize(idx + 12 + entry.str.size());
+
+	u64ToLe(entry.tsMs, &buf[idx]);
+	u32ToLe((uint32_t)entry.str.size(), &buf[idx + 8]);
+
+	if (entry.str.size())
+		memcpy(&buf[idx + 12], entry.str.data(), entry.str.size());
+}
+
+bool logStoreEntriesDecode(const vector<uint8_t> &buf, vector<LogStoreEntry> &entries)
+{
+	const uint8_t *pBuf = buf.data();
+	size_t idx = 0;
+	uint32_t len;
+
+	while (idx < buf.size())
+	{
+		if (buf.size() - idx < 12)
+			return false;
+
+		len = leToU32(pBuf + idx + 8);
+
+		if (buf.size() - idx - 12 < len)
+			return false;
+
+		entries.push_back(LogStoreEntry());
+		entries.back().tsMs = leToU64(pBuf + idx);
+		entries.back().str.assign((const char *)pBuf + idx + 12, len);
+
+		idx += 12 + len;
+	}
+
+	return true;
+}
+
+/* terms */
+
+/*
+ * Terms are lower case words of letters, digits and underscores.
+ * Very short and very long words aren't indexed.
+ */
+void logStoreTermsExtract(const string &str, unordered_set<string> &terms)
+{
+	const size_t cLenTermMin = 3;
+	const size_t cLenTermMax = 32;
+	string term;
+	char ch;
+
+	for (size_t i = 0; i <= str.size(); ++i)
+	{
+		ch = i < str.size() ? str[i] : ' ';
+
+		if (isalnum((uint8_t)ch) || ch == '_')
+		{
+			term.push_back((char)tolower((uint8_t)ch));
+			continue;
+		}
+
+		if (term.size() >= cLenTermMin && term.size() <= cLenTermMax)
+			terms.insert(term);
+
+		term.clear();
+	}
+}
+
+void logStoreTermRecordEncode(uint64_t offset,
+			const unordered_set<string> &terms,
+			vector<uint8_t> &buf)
+{
+	unordered_set<string>::const_iterator iter;
+	size_t idx;
+
+	buf.resize(12);
+
+	u64ToLe(offset, &buf[0]);
+	u32ToLe((uint32_t)terms.size(), &buf[8]);
+
+	iter = terms.begin();
+	for (; iter != terms.end(); ++iter)
+	{
+		idx = buf.size();
+		buf.resize(idx + 1 + iter->size());
+
+		buf[idx] = (uint8_t)iter->size();
+		memcpy(&buf[idx + 1], iter->data(), iter->size());
+	}
+}
+
+/* compression */
+
+static void lengthExtWrite(size_t len, vector<uint8_t> &dst)
+{
+	while (len >= 255)
+	{
+		dst.push_back(255);
+		len -= 255;
+	}
+
+	dst.push_back((uint8_t)len);
+}
+
+static void sequenceWrite(const uint8_t *pLit, size_t lenLit,
+				size_t offset, size_t lenMatch, vector<uint8_t> &dst)
+{
+	uint8_t token;
+
+	token = (uint8_t)((lenLit < 15 ? lenLit : 15) << 4);
+	if (lenMatch)
+		token |= (uint8_t)(lenMatch - 4 < 15 ? lenMatch - 4 : 15);
+
+	dst.push_back(token);
+
+	if (lenLit >= 15)
+		lengthExtWrite(lenLit - 15, dst);
+
+	dst.insert(dst.end(), pLit, pLit + lenLit);
+
+	if (!lenMatch)
+		return;
+
+	dst.push_back((uint8_t)offset);
+	dst.push_back((uint8_t)(offset >> 8));
+
+	if (lenMatch - 4 >= 15)
+		lengthExtWrite(lenMatch - 4 - 15, dst);
+}
+
+/*
+ * Byte oriented LZ77 in the LZ4 block format. Log text
+ * is very repetitive and compresses well with this at
+ * little CPU cost.
+ *
+ * Literature
+ * - https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+ */
+void blockCompress(const uint8_t *pSrc, size_t lenSrc, vector<uint8_t> &dst)
+{
+	const size_t cBitsHash = 12;
+	vector<int32_t> table((size_t)1 << cBitsHash, -1);
+	size_t idx = 0, idxAnchor = 0, idxLimit, idxMatchLimit;
+	uint32_t seq, seqRef, hash;
+	size_t idxRef, lenMatch;
+
+	dst.clear();
+
+	if (lenSrc < 13)
+	{
+		sequenceWrite(pSrc, lenSrc, 0, 0, dst);
+		return;
+	}
+
+	idxLimit = lenSrc - 12;
+	idxMatchLimit = lenSrc - 5;
+
+	while (idx < idxLimit)
+	{
+		memcpy(&seq, pSrc + idx, 4);
+		hash = (seq * 2654435761U) >> (32 - cBitsHash);
+
+		idxRef = (size_t)table[hash];
+		table[hash] = (int32_t)idx;
+
+		if (idxRef == (size_t)-1 || idx - idxRef > 0xFFFF)
+		{
+			++idx;
+			continue;
+		}
+
+		memcpy(&seqRef, pSrc + idxRef, 4);
+		if (seqRef != seq)
+		{
+			++idx;
+			continue;
+		}
+
+		lenMatch = 4;
+		while (idx + lenMatch < idxMatchLimit &&
+				pSrc[idxRef + lenMatch] == pSrc[idx + lenMatch])
+			++lenMatch;
+
+		sequenceWrite(pSrc + idxAnchor, idx - idxAnchor, idx - idxRef, lenMatch, dst);
+
+		idx += lenMatch;
+		idxAnchor = idx;
+	}
+
+	sequenceWrite(pSrc + idxAnchor, lenSrc - idxAnchor, 0, 0, dst);
+}
+
+static bool lengthExtRead(const uint8_t *pSrc, size_t lenSrc, size_t &idx, size_t &len)
+{
+	uint8_t val;
+
+	do
+	{
+		if (idx >= lenSrc)
+			return false;
+
+		val = pSrc[idx++];
+		len += val;
+	} while (val == 255);
+
+	return true;
+}
+
+bool blockDecompress(const uint8_t *pSrc, size_t lenSrc, size_t lenRaw, vector<uint8_t> &dst)
+{
+	size_t idx = 0, lenLit, lenMatch, offset, idxFrom;
+	uint8_t token;
+
+	dst.clear();
+	dst.reserve(lenRaw);
+
+	while (idx < lenSrc)
+	{
+		token = pSrc[idx++];
+
+		lenLit = token >> 4;
+		if (lenLit == 15 && !lengthExtRead(pSrc, lenSrc, idx, lenLit))
+			return false;
+
+		if (lenSrc - idx < lenLit || dst.size() + lenLit > lenRaw)
+			return false;
+
+		dst.insert(dst.end(), pSrc + idx, pSrc + idx + lenLit);
+		idx += lenLit;
+
+		if (idx >= lenSrc)
+			break; // last sequence has no match
+
+		if (lenSrc - idx < 2)
+			return false;
+
+		offset = pSrc[idx] | (size_t)pSrc[idx + 1] << 8;
+		idx += 2;
+
+		if (!offset || offset > dst.size())
+			return false;
+
+		lenMatch = token & 15;
+		if (lenMatch == 15 && !lengthExtRead(pSrc, lenSrc, idx, lenMatch))
+			return false;
+
+		lenMatch += 4;
+
+		if (dst.size() + lenMatch > lenRaw)
+			return false;
+
+		// overlapping copy
+		idxFrom = dst.size() - offset;
+		for (size_t i = 0; i < lenMatch; ++i)
+			dst.push_back(dst[idxFrom + i]);
+	}
+
+	return dst.size() == lenRaw;
+}
+
+/* segments */
+
+string logStoreSegmentName(const string &dir, uint64_t tsStartMs)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%013" PRIu64, tsStartMs);
+
+	return dir + "/" + cPrefixSegment + buf;
+}
+
+// Sorted from old to new
+void logStoreSegmentsList(const string &dir, vector<string> &namesBase)
+{
+	size_t lenPrefix = strlen(cPrefixSegment);
+	string name;
+
+	namesBase.clear();
+#if defined(_WIN32)
+	WIN32_FIND_DATAA data;
+	HANDLE hFind;
+
+	hFind = FindFirstFileA((dir + "\\*.dat").c_str(), &data);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		name = data.cFileName;
+#else
+	DIR *pDir;
+	struct dirent *pEnt;
+
+	pDir = opendir(dir.c_str());
+	if (!pDir)
+		return;
+
+	while ((pEnt = readdir(pDir)))
+	{
+		name = pEnt->d_name;
+#endif
+		if (name.size() != lenPrefix + 13 + 4)
+			continue;
+
+		if (name.compare(0, lenPrefix, cPrefixSegment))
+			continue;
+
+		if (name.compare(name.size() - 4, 4, ".dat"))
+			continue;
+
+		namesBase.push_back(dir + "/" + name.substr(0, name.size() - 4));
+#if defined(_WIN32)
+	} while (FindNextFileA(hFind, &data));
+
+	FindClose(hFind);
+#else
+	}
+
+	closedir(pDir);
+#endif
+	sort(namesBase.begin(), namesBase.end());
+}
+
@@ -0,0 +1,138 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_LOG_STORE_H
+#define LIB_LOG_STORE_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+
+/*
+ * Segmented log store
+ *
+ * The dispatcher hands entries over with logStoreAppend().
+ * This never blocks: If the writer holds the lock, entries
+ * are kept back. logStoreFlush() hands them over and must be
+ * called on every dispatcher tick and before the writer
+ * shuts down.
+ *
+ * Segment: <dir>/codeorb_log_<ms since epoch>.dat + .idx
+ *
+ * Data file: Sequence of blocks
+ *   Header: u32 magic, u8 method, u32 entries, u64 ts first,
+ *           u64 ts last, u32 length raw, u32 length stored
+ *   Raw payload: Entries with u64 ts, u32 length, data
+ *
+ * Index file: One record per block (sparse time index)
+ *   u64 ts first, u64 ts last, u64 offset, u32 entries
+ *
+ * Term file: One record per block. Base of the inverted index
+ *   u64 offset, u32 number of terms, terms with u8 length
+ *
+ * The index record of a block is written last. It marks
+ * the block as complete.
+ *
+ * All numbers are little endian. Timestamps in ms since epoch.
+ */
+
+struct LogStoreEntry
+{
+	uint64_t tsMs;
+	std::string str;
+};
+
+struct LogStoreBlockHdr
+{
+	uint8_t method;
+	uint32_t cntEntries;
+	uint64_t tsFirstMs;
+	uint64_t tsLastMs;
+	uint32_t lenRaw;
+	uint32_t lenStored;
+};
+
+struct LogStoreIdxRecord
+{
+	uint64_t tsFirstMs;
+	uint64_t tsLastMs;
+	uint64_t offset;
+	uint32_t cntEntries;
+};
+
+enum LogStoreMethod
+{
+	LogStoreMethodRaw = 0,
+	LogStoreMethodLz,
+};
+
+enum LogStoreFsync
+{
+	LogStoreFsyncNever = 0,
+	LogStoreFsyncBlock,
+	LogStoreFsyncInterval,
+};
+
+const uint32_t cLogStoreMagic = 0x4B4C4243; // "CBLK"
+const size_t cLenLogStoreBlockHdr = 33;
+const size_t cLenLogStoreIdxRecord = 28;
+
+extern uint8_t logStoreEnabled;
+
+// dispatcher
+void logStoreAppend(uint64_t tsMs, const std::string &str);
+void logStoreFlush(bool wait = false);
+size_t logStoreDropped();
+uint64_t logStoreNowMs();
+
+// writer
+void logStoreFetch(std::deque<LogStoreEntry> &entries);
+
+// format
+void logStoreBlockHdrWrite(const LogStoreBlockHdr &hdr, uint8_t *pBuf);
+bool logStoreBlockHdrRead(const uint8_t *pBuf, LogStoreBlockHdr &hdr);
+void logStoreIdxRecordWrite(const LogStoreIdxRecord &rec, uint8_t *pBuf);
+void logStoreIdxRecordRead(const uint8_t *pBuf, LogStoreIdxRecord &rec);
+void logStoreEntryEncode(const LogStoreEntry &entry, std::vector<uint8_t> &buf);
+bool logStoreEntriesDecode(const std::vector<uint8_t> &buf, std::vector<LogStoreEntry> &entries);
+
+// terms
+void logStoreTermsExtract(const std::string &str, std::unordered_set<std::string> &terms);
+void logStoreTermRecordEncode(uint64_t offset,
+			const std::unordered_set<std::string> &terms,
+			std::vector<uint8_t> &buf);
+
+// compression
+void blockCompress(const uint8_t *pSrc, size_t lenSrc, std::vector<uint8_t> &dst);
+bool blockDecompress(const uint8_t *pSrc, size_t lenSrc, size_t lenRaw, std::vector<uint8_t> &dst);
+
+// segments
+std::string logStoreSegmentName(const std::string &dir, uint64_t tsStartMs);
+void logStoreSegmentsList(const std::string &dir, std::vector<std::string> &namesBase);
+
+#endif
+
@@ -0,0 +1,342 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <ctime>
+
+#include "LibProcHistory.h"
+#include "SystemDebugging.h"
+
+using namespace std;
+using namespace chrono;
+
+struct ProcHistLine
+{
+	uint32_t idx;
+	string str;
+};
+
+struct ProcHistSnapshot
+{
+	uint64_t tsMs;
+	bool keyframe;
+	uint32_t cntLines;
+	vector<ProcHistLine> lines;
+	size_t size;
+};
+
+size_t procHistSizeMax = 16 << 20;
+
+static deque<ProcHistSnapshot> snapshots;
+static uint64_t seqFront = 1;
+static vector<string> linesLast;
+static size_t sizeHist = 0;
+static size_t cntSinceKeyframe = 0;
+static mutex mtxHist;
+
+const size_t cIntervalKeyframe = 64;
+const size_t cSizeLineOverhead = sizeof(ProcHistLine);
+
+void procTreeLinesSplit(const string &str, vector<string> &lines)
+{
+	size_t idxStart = 0, idxEnd;
+
+	lines.clear();
+
+	while (1)
+	{
+		idxEnd = str.find('\n', idxStart);
+		if (idxEnd == string::npos)
+			break;
+
+		lines.push_back(str.substr(idxStart, idxEnd - idxStart));
+		idxStart = idxEnd + 1;
+	}
+
+	lines.push_back(str.substr(idxStart));
+}
+
+static void linesJoin(const vector<string> &lines, string &str)
+{
+	str.clear();
+
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		if (i)
+			str += '\n';
+		str += lines[i];
+	}
+}
+
+static void snapshotApply(const ProcHistSnapshot &snap, vector<string> &lines)
+{
+	vector<ProcHistLine>::const_iterator iter;
+
+	if (snap.keyframe)
+		lines.clear();
+
+	lines.resize(snap.cntLines);
+
+	iter = snap.lines.begin();
+	for (; iter != snap.lines.end(); ++iter)
+		lines[iter->idx] = iter->str;
+}
+
+static void frontDrop()
+{
+	// Deltas are useless without their keyframe
+	do
+	{
+		sizeHist -= snapshots.front().size;
+		snapshots.pop_front();
+		++seqFront;
+	} while (snapshots.size() && !snapshots.front().keyframe);
+}
+
+void procHistAdd(const string &tree)
+{
+	if (!procHistSizeMax)
+		return;
+
+	ProcHistSnapshot snap;
+	ProcHistLine line;
+	vector<string> lines;
+
+	snap.tsMs = (uint64_t)duration_cast<milliseconds>(
+				system_clock::now().time_since_epoch()).count();
+
+	procTreeLinesSplit(tree, lines);
+
+	Guard lock(mtxHist);
+
+	snap.keyframe = !snapshots.size() || cntSinceKeyframe >= cIntervalKeyframe;
+	snap.cntLines = (uint32_t)lines.size();
+	snap.size = sizeof(snap);
+
+	for (uint32_t i = 0; i < lines.size(); ++i)
+	{
+		if (!snap.keyframe && i < linesLast.size() && lines[i] == linesLast[i])
+			continue;
+
+		line.idx = i;
+		line.str = lines[i];
+
+		snap.lines.push_back(line);
+		snap.size += cSizeLineOverhead + line.str.size();
+	}
+
+	// Large changes are cheaper to restore from a keyframe
+	if (!snap.keyframe && snap.lines.size() > lines.size() / 2)
+	{
+		snap.keyframe = true;
+		snap.lines.clear();
+		snap.size = sizeof(snap);
+
+		for (uint32_t i = 0; i < lines.size(); ++i)
+		{
+			line.idx = i;
+			line.str = lines[i];
+
+			snap.lines.push_back(line);
+			snap.size += cSizeLineOverhead + line.str.size();
+		}
+	}
+
+	cntSinceKeyframe = snap.keyframe ? 0 : cntSinceKeyframe + 1;
+
+	sizeHist += snap.size;
+	snapshots.push_back(snap);
+	linesLast.swap(lines);
+
+	while (sizeHist > procHistSizeMax && snapshots.size() > 1)
+		frontDrop();
+}
+
+bool procHistGet(uint64_t seq, string &tree, uint64_t &tsMs)
+{
+	vector<string> lines;
+	size_t idx, idxKey;
+
+	Guard lock(mtxHist);
+
+	if (seq < seqFront || seq >= seqFront + snapshots.size())
+		return false;
+
+	idx = seq - seqFront;
+
+	idxKey = idx;
+	while (!snapshots[idxKey].keyframe)
+		--idxKey;
+
+	for (; idxKey <= idx; ++idxKey)
+		snapshotApply(snapshots[idxKey], lines);
+
+	linesJoin(lines, tree);
+	tsMs = snapshots[idx].tsMs;
+
+	return true;
+}
+
+void procHistRange(uint64_t &seqFirst, uint64_t &seqLast)
+{
+	Guard lock(mtxHist);
+
+	seqFirst = seqFront;
+	seqLast = seqFront + snapshots.size() - 1;
+}
+
+// Last snapshot taken at or before the given time
+uint64_t procHistSeqAt(uint64_t tsMs)
+{
+	size_t idxLow = 0, idxHigh, idxMid;
+
+	Guard lock(mtxHist);
+
+	if (!snapshots.size() || snapshots.front().tsMs > tsMs)
+		return seqFront;
+
+	idxHigh = snapshots.size() - 1;
+
+	while (idxLow < idxHigh)
+	{
+		idxMid = idxLow + (idxHigh - idxLow + 1) / 2;
+
+		if (snapshots[idxMid].tsMs <= tsMs)
+			idxLow = idxMid;
+		else
+			idxHigh = idxMid - 1;
+	}
+
+	return seqFront + idxLow;
+}
+
+/*
+ * The dump contains every snapshot as a complete tree.
+ * This makes it usable with diff and grep directly.
+ */
+bool procHistSave(const string &nameFile)
+{
+	deque<ProcHistSnapshot>::const_iterator iter;
+	vector<string> lines;
+	string tree;
+	char bufTime[32];
+	struct tm tmLocal;
+	time_t t;
+	uint64_t seq;
+	FILE *pFile;
+	bool failed = false;
+
+	pFile = fopen(nameFile.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	Guard lock(mtxHist);
+
+	seq = seqFront;
+
+	iter = snapshots.begin();
+	for (; iter != snapshots.end(); ++iter, ++seq)
+	{
+		snapshotApply(*iter, lines);
+		linesJoin(lines, tree);
+
+		t = (time_t)(iter->tsMs / 1000);
+#if defined(_WIN32)
+		localtime_s(&tmLocal, &t);
+#else
+		localtime_r(&t, &tmLocal);
+#endif
+		strftime(bufTime, sizeof(bufTime), "%Y-%m-%d  %H:%M:%S", &tmLocal);
+
+		failed |= fprintf(pFile, "--- #%" PRIu64 "  %s.%03u%s\n",
+					seq, bufTime, (uint32_t)(iter->tsMs % 1000),
+					iter->keyframe ? "  (keyframe)" : "") < 0;
+		failed |= fwrite(tree.data(), 1, tree.size(), pFile) != tree.size();
+		failed |= fputc('\n', pFile) == EOF;
+	}
+
+	fclose(pFile);
+
+	return !failed;
+}
+
+static void cmdProcHistSave(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	if (!pArgs || !*pArgs)
+	{
+		dInfo("No file given");
+		return;
+	}
+
+	if (!procHistSave(pArgs))
+	{
+		dInfo("Could not write to %s", pArgs);
+		return;
+	}
+
+	dInfo("Process tree history written to %s", pArgs);
+}
+
+static void cmdProcHistInfo(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+
+	size_t cntKeyframes = 0;
+
+	Guard lock(mtxHist);
+
+	for (size_t i = 0; i < snapshots.size(); ++i)
+		cntKeyframes += snapshots[i].keyframe ? 1 : 0;
+
+	dInfo("Snapshots %zu, keyframes %zu, size %zu / %zu [kB]",
+			snapshots.size(), cntKeyframes,
+			sizeHist >> 10, procHistSizeMax >> 10);
+}
+
+static void cmdProcHistClear(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+
+	Guard lock(mtxHist);
+
+	seqFront += snapshots.size();
+	snapshots.clear();
+	linesLast.clear();
+	sizeHist = 0;
+	cntSinceKeyframe = 0;
+
+	dInfo("Process tree history cleared");
+}
+
+void procHistCommandsRegister()
+{
+	cmdReg("procHistSave",  cmdProcHistSave,  "", "Save process tree history to file", "Process History");
+	cmdReg("procHistInfo",  cmdProcHistInfo,  "", "Show process tree history usage",   "Process History");
+	cmdReg("procHistClear", cmdProcHistClear, "", "Clear process tree history",        "Process History");
+}
+
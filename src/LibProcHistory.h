@@ -0,0 +1,57 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_PROC_HISTORY_H
+#define LIB_PROC_HISTORY_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/*
+ * Process tree history
+ *
+ * Every received process tree is kept in a bounded history.
+ * Keyframes hold the complete tree, all other snapshots only
+ * the lines which changed since the previous one. Snapshots are
+ * addressed by a sequence number starting at 1, which stays
+ * valid until the snapshot is dropped. The oldest keyframe and
+ * its deltas are dropped first.
+ */
+
+extern size_t procHistSizeMax; // [bytes], 0: off
+
+void procHistAdd(const std::string &tree);
+bool procHistGet(uint64_t seq, std::string &tree, uint64_t &tsMs);
+void procHistRange(uint64_t &seqFirst, uint64_t &seqLast);
+uint64_t procHistSeqAt(uint64_t tsMs);
+bool procHistSave(const std::string &nameFile);
+void procHistCommandsRegister();
+
+// Lines are split at '\n' only. Joining with '\n' restores the tree
+void procTreeLinesSplit(const std::string &str, std::vector<std::string> &lines);
+
+#endif
+
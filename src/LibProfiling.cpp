@@ -0,0 +1,148 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <list>
+#include <mutex>
+
+#include "LibProfiling.h"
+#include "SystemDebugging.h"
+
+using namespace std;
+
+static list<ProfilingTick> entriesProf;
+static mutex mtxEntriesProf;
+
+static void profilingTickClear(ProfilingTick &prof)
+{
+	prof.cntCalls.store(0, memory_order_relaxed);
+	prof.sumNs.store(0, memory_order_relaxed);
+	prof.maxNs.store(0, memory_order_relaxed);
+
+	for (size_t i = 0; i < cNumBucketsTick; ++i)
+		prof.histogram[i].store(0, memory_order_relaxed);
+}
+
+ProfilingTick *profilingTickRegister(const string &path)
+{
+	Guard lock(mtxEntriesProf);
+
+	list<ProfilingTick>::iterator iter;
+
+	iter = entriesProf.begin();
+	for (; iter != entriesProf.end(); ++iter)
+	{
+		if (iter->path == path)
+			return &(*iter);
+	}
+
+	// Atomics can't be copied. Constructed in place
+	entriesProf.emplace_back();
+
+	ProfilingTick &prof = entriesProf.back();
+
+	prof.path = path;
+	profilingTickClear(prof);
+
+	return &prof;
+}
+
+void profilingTickAdd(ProfilingTick *pProf, uint64_t durationNs)
+{
+	uint64_t durationUs = durationNs / 1000;
+	uint64_t maxNs = pProf->maxNs.load(memory_order_relaxed);
+	size_t idxBucket = 0;
+
+	pProf->cntCalls.fetch_add(1, memory_order_relaxed);
+	pProf->sumNs.fetch_add(durationNs, memory_order_relaxed);
+
+	while (durationNs > maxNs &&
+			!pProf->maxNs.compare_exchange_weak(maxNs, durationNs, memory_order_relaxed))
+		;
+
+	while (durationUs && idxBucket < cNumBucketsTick - 1)
+	{
+		durationUs >>= 1;
+		++idxBucket;
+	}
+
+	pProf->histogram[idxBucket].fetch_add(1, memory_order_relaxed);
+}
+
+void profilingTickInfo(char * &pBuf, char *pBufEnd, const ProfilingTick *pProf)
+{
+	if (!pProf)
+		return;
+
+	uint32_t cntCalls = pProf->cntCalls.load(memory_order_relaxed);
+	uint64_t sumNs = pProf->sumNs.load(memory_order_relaxed);
+	uint64_t avgNs = cntCalls ? sumNs / cntCalls : 0;
+
+	dInfo("Ticks\t\t\t%u\n", cntCalls);
+	dInfo("Tick time\t\t%" PRIu64 " [us]\n", sumNs / 1000);
+	dInfo("Tick avg/max\t\t%" PRIu64 " / %" PRIu64 " [ns]\n",
+			avgNs, pProf->maxNs.load(memory_order_relaxed));
+
+	dInfo("Tick histogram\t\t");
+	for (size_t i = 0; i < cNumBucketsTick; ++i)
+		dInfo("%u%s", pProf->histogram[i].load(memory_order_relaxed),
+				i < cNumBucketsTick - 1 ? " " : "\n");
+}
+
+static void cmdProfilingDump(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+
+	Guard lock(mtxEntriesProf);
+
+	list<ProfilingTick>::const_iterator iter;
+
+	// Folded stacks: <path> <self time in us>
+	iter = entriesProf.begin();
+	for (; iter != entriesProf.end(); ++iter)
+		dInfo("%s %" PRIu64 "\n", iter->path.c_str(),
+				iter->sumNs.load(memory_order_relaxed) / 1000);
+}
+
+static void cmdProfilingReset(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+
+	Guard lock(mtxEntriesProf);
+
+	list<ProfilingTick>::iterator iter;
+
+	iter = entriesProf.begin();
+	for (; iter != entriesProf.end(); ++iter)
+		profilingTickClear(*iter);
+
+	dInfo("Tick profile cleared");
+}
+
+void profilingCommandsRegister()
+{
+	cmdReg("profilingDump",  cmdProfilingDump,  "", "Tick profile as folded stacks", "Profiling");
+	cmdReg("profilingReset", cmdProfilingReset, "", "Clear tick profile",            "Profiling");
+}
+
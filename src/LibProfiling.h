@@ -0,0 +1,94 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_PROFILING_H
+#define LIB_PROFILING_H
+
+#include <cinttypes>
+#include <string>
+#include <chrono>
+#include <atomic>
+
+/*
+ * Tick profiling
+ *
+ * Every process() invocation of an instrumented process
+ * is measured and accounted to its position in the tree.
+ * Instances with the same path share one entry.
+ * Only processes driven by the main thread are instrumented.
+ * The counters are relaxed atomics. They are updated without
+ * a lock while commands read or clear them.
+ */
+
+const size_t cNumBucketsTick = 16;
+
+struct ProfilingTick
+{
+	std::string path;
+	std::atomic<uint32_t> cntCalls;
+	std::atomic<uint64_t> sumNs;
+	std::atomic<uint64_t> maxNs;
+	std::atomic<uint32_t> histogram[cNumBucketsTick]; // [0]: < 1us, [i]: < 2^i us
+};
+
+ProfilingTick *profilingTickRegister(const std::string &path);
+void profilingTickAdd(ProfilingTick *pProf, uint64_t durationNs);
+void profilingTickInfo(char * &pBuf, char *pBufEnd, const ProfilingTick *pProf);
+void profilingCommandsRegister();
+
+class ProfilingTickScope
+{
+
+public:
+
+	ProfilingTickScope(ProfilingTick *pProf)
+		: mpProf(pProf)
+		, mStart(std::chrono::steady_clock::now())
+	{}
+
+	~ProfilingTickScope()
+	{
+		if (!mpProf)
+			return;
+
+		std::chrono::steady_clock::duration d =
+				std::chrono::steady_clock::now() - mStart;
+
+		profilingTickAdd(mpProf, (uint64_t)
+			std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+	}
+
+private:
+
+	ProfilingTickScope(const ProfilingTickScope &) = delete;
+	ProfilingTickScope &operator=(const ProfilingTickScope &) = delete;
+
+	ProfilingTick *mpProf;
+	std::chrono::steady_clock::time_point mStart;
+
+};
+
+#endif
+
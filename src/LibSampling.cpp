@@ -0,0 +1,645 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <chrono>
+
+#include "LibSampling.h"
+#include "LibBulkTransfer.h"
+
+using namespace std;
+using namespace chrono;
+
+typedef lock_guard<mutex> Guard;
+
+size_t sampleRingSizeMax = 1 << 20;
+string sampleDirSpill = "";
+
+// requested by clients
+static uint32_t verConfig = 0;
+static uint32_t periodUsConfig = 0;
+static vector<string> symbolsConfig;
+
+// active set
+static bool active = false;
+static uint8_t idSetActive = 0;
+static uint32_t periodUsActive = 0;
+static vector<string> channels;
+static string statusSet = "idle";
+static uint32_t seqNext = 0;
+
+// target time mapping
+static bool timeSynced = false;
+static uint32_t tsTargetLast = 0;
+static uint64_t tsTarget64 = 0;
+static int64_t offsetHostUs = 0;
+static uint64_t tsLastUs = 0;
+
+// ring, one column per channel
+static vector<uint64_t> colTime;
+static vector<vector<int32_t> > colsVal;
+static size_t idxRingFront = 0;
+static size_t cntRing = 0;
+
+// spill
+static FILE *pFileTime = NULL;
+static vector<FILE *> filesVal;
+static size_t cntSpilled = 0;
+
+// statistics
+static size_t cntFrames = 0;
+static size_t cntFramesLost = 0;
+static size_t cntFramesErr = 0;
+static size_t cntSamples = 0;
+static size_t cntSamplesDropped = 0;
+
+static mutex mtxSample;
+
+const size_t cLenFrameHdr = 11;
+const size_t cNumEvictBlock = 4096;
+const size_t cNumReadBlock = 1024;
+const uint32_t cPeriodUsMin = 100;
+const int64_t cDriftMaxUs = 100000;
+
+static uint32_t u32Get(const string &str, size_t idx)
+{
+	uint32_t val = 0;
+
+	for (size_t i = 0; i < 4; ++i)
+		val |= (uint32_t)(uint8_t)str[idx + i] << (8 * i);
+
+	return val;
+}
+
+static string nameFileSpill(uint64_t startMs, const string &nameCol)
+{
+	string str = sampleDirSpill + "/samples_" + to_string(startMs) + "_";
+
+	for (size_t i = 0; i < nameCol.size(); ++i)
+	{
+		char ch = nameCol[i];
+
+		if (ch == '/' || ch == '\\' || ch == ' ')
+			ch = '_';
+
+		str.push_back(ch);
+	}
+
+	return str + ".bin";
+}
+
+static void spillClose()
+{
+	if (pFileTime)
+		fclose(pFileTime);
+	pFileTime = NULL;
+
+	for (size_t i = 0; i < filesVal.size(); ++i)
+	{
+		if (filesVal[i])
+			fclose(filesVal[i]);
+	}
+
+	filesVal.clear();
+	cntSpilled = 0;
+}
+
+static void spillOpen()
+{
+	uint64_t startMs = sampleNowUs() / 1000;
+	FILE *pFile;
+
+	spillClose();
+
+	if (!sampleDirSpill.size())
+		return;
+
+	pFileTime = fopen(nameFileSpill(startMs, "time").c_str(), "w+b");
+	if (!pFileTime)
+		return;
+
+	for (size_t i = 0; i < channels.size(); ++i)
+	{
+		pFile = fopen(nameFileSpill(startMs, "ch_" + channels[i]).c_str(), "w+b");
+		filesVal.push_back(pFile);
+
+		if (pFile)
+			continue;
+
+		spillClose();
+		return;
+	}
+}
+
+static size_t idxRing(size_t idx)
+{
+	return (idxRingFront + idx) % sampleRingSizeMax;
+}
+
+// Oldest samples go to disk. Without spill they are lost
+static void ringEvict()
+{
+	size_t cnt = cntRing < cNumEvictBlock ? cntRing : cNumEvictBlock;
+	vector<uint64_t> bufTime;
+	vector<int32_t> bufVal;
+	bool failed = false;
+
+	if (!pFileTime)
+	{
+		cntSamplesDropped += cnt;
+
+		idxRingFront = idxRing(cnt);
+		cntRing -= cnt;
+
+		return;
+	}
+
+	bufTime.reserve(cnt);
+	for (size_t i = 0; i < cnt; ++i)
+		bufTime.push_back(colTime[idxRing(i)]);
+
+	// Reads in between leave the position somewhere else
+	failed |= fseek(pFileTime, 0, SEEK_END) != 0;
+	failed |= fwrite(bufTime.data(), sizeof(uint64_t), cnt, pFileTime) != cnt;
+
+	for (size_t k = 0; k < filesVal.size(); ++k)
+	{
+		bufVal.clear();
+		for (size_t i = 0; i < cnt; ++i)
+			bufVal.push_back(colsVal[k][idxRing(i)]);
+
+		failed |= fseek(filesVal[k], 0, SEEK_END) != 0;
+		failed |= fwrite(bufVal.data(), sizeof(int32_t), cnt, filesVal[k]) != cnt;
+	}
+
+	idxRingFront = idxRing(cnt);
+	cntRing -= cnt;
+
+	if (!failed)
+	{
+		cntSpilled += cnt;
+		return;
+	}
+
+	// Spill files are inconsistent now
+	spillClose();
+	cntSamplesDropped += cnt;
+}
+
+static void sampleAppend(uint64_t tsUs, const int32_t *pVals)
+{
+	size_t idx;
+
+	if (cntRing >= sampleRingSizeMax)
+		ringEvict();
+
+	idx = idxRing(cntRing);
+
+	if (idx == colTime.size())
+	{
+		colTime.push_back(tsUs);
+
+		for (size_t k = 0; k < colsVal.size(); ++k)
+			colsVal[k].push_back(pVals[k]);
+	}
+	else
+	{
+		colTime[idx] = tsUs;
+
+		for (size_t k = 0; k < colsVal.size(); ++k)
+			colsVal[k][idx] = pVals[k];
+	}
+
+	++cntRing;
+	++cntSamples;
+}
+
+static void ringClear()
+{
+	colTime.clear();
+	colsVal.clear();
+	idxRingFront = 0;
+	cntRing = 0;
+}
+
+/* clients */
+
+bool sampleConfigSet(uint32_t periodUs, const vector<string> &symbols)
+{
+	if (symbols.size() > cNumChannelsSampleMax)
+		return false;
+
+	if (symbols.size() && periodUs < cPeriodUsMin)
+		return false;
+
+	Guard lock(mtxSample);
+
+	periodUsConfig = periodUs;
+	symbolsConfig = symbols;
+	++verConfig;
+
+	statusSet = symbols.size() ? "requested" : "stop requested";
+
+	return true;
+}
+
+struct BucketAccu
+{
+	uint64_t fromUs;
+	uint64_t widthUs;
+	uint64_t idx;
+	bool valid;
+	SampleBucket bucket;
+	vector<SampleBucket> *pBuckets;
+};
+
+static void bucketAdd(BucketAccu &accu, uint64_t tsUs, int32_t val)
+{
+	uint64_t idx = (tsUs - accu.fromUs) / accu.widthUs;
+
+	if (accu.valid && idx == accu.idx)
+	{
+		if (val < accu.bucket.min)
+			accu.bucket.min = val;
+
+		if (val > accu.bucket.max)
+			accu.bucket.max = val;
+
+		return;
+	}
+
+	if (accu.valid)
+		accu.pBuckets->push_back(accu.bucket);
+
+	accu.idx = idx;
+	accu.valid = true;
+
+	accu.bucket.tsUs = accu.fromUs + idx * accu.widthUs;
+	accu.bucket.min = val;
+	accu.bucket.max = val;
+}
+
+static bool spillTimeAt(size_t idx, uint64_t &tsUs)
+{
+	if (fseek(pFileTime, (long)(idx * sizeof(uint64_t)), SEEK_SET))
+		return false;
+
+	return fread(&tsUs, sizeof(tsUs), 1, pFileTime) == 1;
+}
+
+static void spillRangeRead(size_t idxCol, uint64_t toUs, BucketAccu &accu)
+{
+	FILE *pFileVal = filesVal[idxCol];
+	uint64_t bufTime[cNumReadBlock];
+	int32_t bufVal[cNumReadBlock];
+	size_t idxLow = 0, idxHigh = cntSpilled, idxMid;
+	size_t cnt, cntRead;
+	uint64_t tsUs;
+
+	if (!cntSpilled || fflush(pFileTime) || fflush(pFileVal))
+		return;
+
+	// First sample not before start of range
+	while (idxLow < idxHigh)
+	{
+		idxMid = (idxLow + idxHigh) >> 1;
+
+		if (!spillTimeAt(idxMid, tsUs))
+			return;
+
+		if (tsUs < accu.fromUs)
+			idxLow = idxMid + 1;
+		else
+			idxHigh = idxMid;
+	}
+
+	if (fseek(pFileTime, (long)(idxLow * sizeof(uint64_t)), SEEK_SET) ||
+			fseek(pFileVal, (long)(idxLow * sizeof(int32_t)), SEEK_SET))
+		return;
+
+	while (idxLow < cntSpilled)
+	{
+		cnt = cntSpilled - idxLow;
+		if (cnt > cNumReadBlock)
+			cnt = cNumReadBlock;
+
+		cntRead = fread(bufTime, sizeof(uint64_t), cnt, pFileTime);
+		if (cntRead != cnt)
+			return;
+
+		cntRead = fread(bufVal, sizeof(int32_t), cnt, pFileVal);
+		if (cntRead != cnt)
+			return;
+
+		for (size_t i = 0; i < cnt; ++i)
+		{
+			if (bufTime[i] > toUs)
+				return;
+
+			bucketAdd(accu, bufTime[i], bufVal[i]);
+		}
+
+		idxLow += cnt;
+	}
+}
+
+/*
+ * Range is divided into buckets of equal width. Each bucket
+ * holds the minimum and maximum of its samples, so peaks
+ * survive decimation. Empty buckets are skipped.
+ */
+bool sampleRange(const string &channel,
+			uint64_t fromUs, uint64_t toUs, size_t numBuckets,
+			vector<SampleBucket> &buckets, string &strErr)
+{
+	size_t idxCol, idxLow, idxHigh, idxMid;
+	BucketAccu accu;
+
+	buckets.clear();
+
+	if (toUs < fromUs || !numBuckets)
+	{
+		strErr = "invalid range";
+		return false;
+	}
+
+	Guard lock(mtxSample);
+
+	for (idxCol = 0; idxCol < channels.size(); ++idxCol)
+	{
+		if (channels[idxCol] == channel)
+			break;
+	}
+
+	if (idxCol >= channels.size())
+	{
+		strErr = "unknown channel";
+		return false;
+	}
+
+	accu.fromUs = fromUs;
+	accu.widthUs = (toUs - fromUs) / numBuckets + 1;
+	accu.idx = 0;
+	accu.valid = false;
+	accu.pBuckets = &buckets;
+
+	if (pFileTime && (!cntRing || fromUs < colTime[idxRing(0)]))
+		spillRangeRead(idxCol, toUs, accu);
+
+	idxLow = 0;
+	idxHigh = cntRing;
+
+	while (idxLow < idxHigh)
+	{
+		idxMid = (idxLow + idxHigh) >> 1;
+
+		if (colTime[idxRing(idxMid)] < fromUs)
+			idxLow = idxMid + 1;
+		else
+			idxHigh = idxMid;
+	}
+
+	for (; idxLow < cntRing; ++idxLow)
+	{
+		size_t idx = idxRing(idxLow);
+
+		if (colTime[idx] > toUs)
+			break;
+
+		bucketAdd(accu, colTime[idx], colsVal[idxCol][idx]);
+	}
+
+	if (accu.valid)
+		buckets.push_back(accu.bucket);
+
+	return true;
+}
+
+void sampleInfoGet(string &str)
+{
+	Guard lock(mtxSample);
+
+	str = "Status: " + statusSet + "\n";
+
+	if (channels.size())
+	{
+		str += "Period: " + to_string(periodUsActive) + " us\n";
+		str += "Channels:";
+
+		for (size_t i = 0; i < channels.size(); ++i)
+			str += " " + channels[i];
+
+		str += "\n";
+	}
+
+	str += "Samples stored: " + to_string(cntRing) + " / " +
+				to_string(sampleRingSizeMax) + "\n";
+
+	if (cntRing)
+	{
+		str += "Stored from/to: " + to_string(colTime[idxRing(0)] / 1000) + " / " +
+				to_string(colTime[idxRing(cntRing - 1)] / 1000) + " ms\n";
+	}
+
+	str += "Samples spilled: " + to_string(cntSpilled) +
+				(pFileTime ? "" : " (spill off)") + "\n";
+	str += "Samples received: " + to_string(cntSamples) + "\n";
+	str += "Samples dropped: " + to_string(cntSamplesDropped) + "\n";
+	str += "Frames received/lost/corrupt: " + to_string(cntFrames) + " / " +
+				to_string(cntFramesLost) + " / " + to_string(cntFramesErr) + "\n";
+}
+
+uint64_t sampleTimeParse(const string &str, bool &ok)
+{
+	uint64_t nowUs = sampleNowUs();
+	char *pEnd = NULL;
+	uint64_t valUs;
+	double valSec;
+
+	ok = false;
+
+	if (!str.size())
+		return 0;
+
+	if (str == "now")
+	{
+		ok = true;
+		return nowUs;
+	}
+
+	if (str[0] == '-')
+	{
+		valSec = strtod(str.c_str() + 1, &pEnd);
+		ok = !*pEnd && valSec >= 0;
+
+		valUs = (uint64_t)(valSec * 1e6);
+
+		return valUs < nowUs ? nowUs - valUs : 0;
+	}
+
+	valUs = strtoull(str.c_str(), &pEnd, 10) * 1000;
+	ok = !*pEnd;
+
+	return valUs;
+}
+
+/* scheduler */
+
+uint32_t sampleConfigGet(uint32_t &periodUs, vector<string> &symbols)
+{
+	Guard lock(mtxSample);
+
+	periodUs = periodUsConfig;
+	symbols = symbolsConfig;
+
+	return verConfig;
+}
+
+void sampleSetStart(uint8_t idSet, uint32_t periodUs, const vector<string> &chans)
+{
+	Guard lock(mtxSample);
+
+	active = sampleRingSizeMax > 0;
+	idSetActive = idSet;
+	periodUsActive = periodUs;
+	channels = chans;
+	statusSet = active ? "active" : "storage disabled";
+	seqNext = 0;
+
+	timeSynced = false;
+	tsLastUs = 0;
+
+	ringClear();
+	colsVal.resize(channels.size());
+
+	spillOpen();
+}
+
+void sampleSetStop(const string &reason)
+{
+	Guard lock(mtxSample);
+
+	// Data stays available until the next start
+	active = false;
+	statusSet = reason.size() ? reason : "stopped";
+}
+
+bool sampleActive()
+{
+	Guard lock(mtxSample);
+	return active;
+}
+
+void sampleFrameAdd(const string &frame, uint64_t nowUs)
+{
+	int32_t vals[cNumChannelsSampleMax];
+	uint32_t seq, tsTarget, cnt;
+	size_t numCh, idx, lenValues;
+	int64_t driftUs;
+	uint64_t tsUs;
+	string raw;
+	bool ok;
+
+	ok = bulkUnescape(frame, raw);
+
+	Guard lock(mtxSample);
+
+	if (!active)
+		return;
+
+	numCh = channels.size();
+
+	if (!ok || raw.size() < cLenFrameHdr + 4)
+	{
+		++cntFramesErr;
+		return;
+	}
+
+	cnt = (uint8_t)raw[9] | (uint32_t)(uint8_t)raw[10] << 8;
+	lenValues = (size_t)cnt * numCh * 4;
+
+	if (raw.size() != cLenFrameHdr + lenValues + 4 ||
+			crc32Calc(raw.data(), cLenFrameHdr + lenValues) !=
+				u32Get(raw, cLenFrameHdr + lenValues))
+	{
+		++cntFramesErr;
+		return;
+	}
+
+	if ((uint8_t)raw[0] != idSetActive || !cnt)
+		return;
+
+	seq = u32Get(raw, 1);
+	tsTarget = u32Get(raw, 5);
+
+	if (timeSynced && seq != seqNext)
+		cntFramesLost += seq - seqNext;
+	seqNext = seq + 1;
+
+	++cntFrames;
+
+	if (!timeSynced)
+	{
+		tsTarget64 = tsTarget;
+		timeSynced = true;
+	}
+	else
+		tsTarget64 += tsTarget - tsTargetLast; // wrap safe
+
+	tsTargetLast = tsTarget;
+
+	// Last sample of the frame is assumed to be fresh
+	tsUs = tsTarget64 + (uint64_t)(cnt - 1) * periodUsActive;
+	driftUs = (int64_t)(nowUs - tsUs) - offsetHostUs;
+
+	if (cntFrames == 1 || driftUs > cDriftMaxUs || driftUs < -cDriftMaxUs)
+		offsetHostUs = (int64_t)(nowUs - tsUs);
+
+	idx = cLenFrameHdr;
+
+	for (uint32_t i = 0; i < cnt; ++i)
+	{
+		for (size_t k = 0; k < numCh; ++k, idx += 4)
+			vals[k] = (int32_t)u32Get(raw, idx);
+
+		tsUs = (uint64_t)((int64_t)(tsTarget64 + (uint64_t)i * periodUsActive) + offsetHostUs);
+
+		// Time column must stay sorted after resync
+		if (tsUs <= tsLastUs)
+			tsUs = tsLastUs + 1;
+		tsLastUs = tsUs;
+
+		sampleAppend(tsUs, vals);
+	}
+}
+
+uint64_t sampleNowUs()
+{
+	return (uint64_t)duration_cast<microseconds>(
+				system_clock::now().time_since_epoch()).count();
+}
+
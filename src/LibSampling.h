@@ -0,0 +1,93 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_SAMPLING_H
+#define LIB_SAMPLING_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/*
+ * Variable sampling
+ *
+ * Clients request a set of target symbols and a sample period.
+ * The scheduler negotiates it with the target
+ *
+ *   sampleStart <id> <period us> <symbol> ..
+ *     -> 'Sample <id> <num channels> <period us>'
+ *   sampleStop
+ *     -> 'Sample stopped'
+ *
+ * While active, the target answers data requests with frames
+ *
+ *   IdContentTaToScSample <escaped frame> IdContentEnd
+ *   Frame: id(1) seq(4) tsUs(4) cnt(2) values(cnt * channels * 4) crc32(4)
+ *
+ * Values are signed 32 bit and little endian, grouped by sample.
+ * tsUs is the target time of the first sample. Lost frames show
+ * up as gaps. Escaping is the same as for the bulk channel.
+ *
+ * Samples are stored column-wise in a ring. The time column
+ * holds host time in us since epoch. When the ring is full, the
+ * oldest samples are dropped or, if a spill directory is set,
+ * appended to one file per column. Ranges are served from both.
+ */
+
+const uint8_t IdContentTaToScSample = 0x19;
+
+const size_t cNumChannelsSampleMax = 16;
+
+extern size_t sampleRingSizeMax; // [samples], 0: off
+extern std::string sampleDirSpill;
+
+struct SampleBucket
+{
+	uint64_t tsUs;
+	int32_t min;
+	int32_t max;
+};
+
+// Clients
+bool sampleConfigSet(uint32_t periodUs, const std::vector<std::string> &symbols);
+bool sampleRange(const std::string &channel,
+			uint64_t fromUs, uint64_t toUs, size_t numBuckets,
+			std::vector<SampleBucket> &buckets, std::string &strErr);
+void sampleInfoGet(std::string &str);
+
+// 'now', ms since epoch or a leading '-' and seconds before now
+uint64_t sampleTimeParse(const std::string &str, bool &ok);
+
+// Scheduler
+uint32_t sampleConfigGet(uint32_t &periodUs, std::vector<std::string> &symbols);
+void sampleSetStart(uint8_t idSet, uint32_t periodUs, const std::vector<std::string> &channels);
+void sampleSetStop(const std::string &reason);
+bool sampleActive();
+void sampleFrameAdd(const std::string &frame, uint64_t nowUs);
+
+uint64_t sampleNowUs();
+
+#endif
+
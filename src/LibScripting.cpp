@@ -0,0 +1,313 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cctype>
+#include <map>
+#include <mutex>
+
+#include "LibScripting.h"
+#include "SystemDebugging.h"
+
+#include "env.h"
+
+using namespace std;
+
+const size_t cSizeNameScriptMax = 32;
+
+static map<string, vector<ScriptStmt> > scripts;
+static mutex mtxScripts;
+
+static string strTrim(const string &str)
+{
+	size_t idxStart, idxEnd;
+
+	idxStart = str.find_first_not_of(" \t\r");
+	if (idxStart == string::npos)
+		return "";
+
+	idxEnd = str.find_last_not_of(" \t\r");
+
+	return str.substr(idxStart, idxEnd - idxStart + 1);
+}
+
+static bool numParse(const string &str, uint32_t &val)
+{
+	char *pEnd = NULL;
+
+	if (!str.size())
+		return false;
+
+	val = (uint32_t)strtoul(str.c_str(), &pEnd, 10);
+
+	return !*pEnd;
+}
+
+static bool nameValid(const string &name)
+{
+	if (!name.size() || name.size() > cSizeNameScriptMax)
+		return false;
+
+	for (size_t i = 0; i < name.size(); ++i)
+	{
+		char ch = name[i];
+
+		if (isalnum((uint8_t)ch) || ch == '_' || ch == '-')
+			continue;
+
+		return false;
+	}
+
+	return true;
+}
+
+bool scriptParse(const string &src, vector<ScriptStmt> &stmts, string &strErr)
+{
+	vector<size_t> idxRepeats;
+	size_t idxStart = 0, idxEnd, idxSpace;
+	string line, word, arg;
+	ScriptStmt stmt;
+
+	stmts.clear();
+
+	if (src.size() > cSizeSrcScriptMax)
+	{
+		strErr = "script too large";
+		return false;
+	}
+
+	while (idxStart < src.size())
+	{
+		idxEnd = src.find_first_of("\n;", idxStart);
+		if (idxEnd == string::npos)
+			idxEnd = src.size();
+
+		line = strTrim(src.substr(idxStart, idxEnd - idxStart));
+		idxStart = idxEnd + 1;
+
+		if (!line.size() || line[0] == '#')
+			continue;
+
+		idxSpace = line.find(' ');
+		word = line.substr(0, idxSpace);
+		arg = idxSpace == string::npos ? "" : strTrim(line.substr(idxSpace));
+
+		stmt.op = ScriptOpCmd;
+		stmt.cmd = "";
+		stmt.text = "";
+		stmt.val = 0;
+		stmt.idxJump = 0;
+
+		if (word == "repeat")
+		{
+			if (!numParse(arg, stmt.val))
+			{
+				strErr = "repeat: count expected";
+				return false;
+			}
+
+			if (idxRepeats.size() >= cDepthRepeatMax)
+			{
+				strErr = "repeat: nested too deep";
+				return false;
+			}
+
+			stmt.op = ScriptOpRepeat;
+			idxRepeats.push_back(stmts.size());
+		}
+		else
+		if (word == "end")
+		{
+			if (!idxRepeats.size())
+			{
+				strErr = "end: no matching repeat";
+				return false;
+			}
+
+			stmt.op = ScriptOpEnd;
+			stmt.idxJump = idxRepeats.back();
+			stmts[idxRepeats.back()].idxJump = stmts.size();
+
+			idxRepeats.pop_back();
+		}
+		else
+		if (word == "wait")
+		{
+			if (!numParse(arg, stmt.val))
+			{
+				strErr = "wait: delay in ms expected";
+				return false;
+			}
+
+			stmt.op = ScriptOpWait;
+		}
+		else
+		if (word == "expect")
+		{
+			if (!arg.size())
+			{
+				strErr = "expect: text expected";
+				return false;
+			}
+
+			stmt.op = ScriptOpExpect;
+			stmt.text = arg;
+		}
+		else
+		if (word == "until")
+		{
+			idxSpace = arg.find(' ');
+			if (idxSpace == string::npos)
+			{
+				strErr = "until: text and command expected";
+				return false;
+			}
+
+			stmt.op = ScriptOpUntil;
+			stmt.text = arg.substr(0, idxSpace);
+			stmt.cmd = strTrim(arg.substr(idxSpace));
+		}
+		else
+			stmt.cmd = line;
+
+		if (stmts.size() >= cNumStmtsScriptMax)
+		{
+			strErr = "too many statements";
+			return false;
+		}
+
+		stmts.push_back(stmt);
+	}
+
+	if (idxRepeats.size())
+	{
+		strErr = "repeat: missing end";
+		return false;
+	}
+
+	if (!stmts.size())
+	{
+		strErr = "script empty";
+		return false;
+	}
+
+	return true;
+}
+
+bool scriptDefine(const string &name, const string &src, string &strErr)
+{
+	vector<ScriptStmt> stmts;
+
+	if (!nameValid(name))
+	{
+		strErr = "invalid script name";
+		return false;
+	}
+
+	if (!scriptParse(src, stmts, strErr))
+		return false;
+
+	Guard lock(mtxScripts);
+
+	scripts[name] = stmts;
+
+	return true;
+}
+
+bool scriptGet(const string &name, vector<ScriptStmt> &stmts, string &strErr)
+{
+	if (!nameValid(name))
+	{
+		strErr = "invalid script name";
+		return false;
+	}
+
+	{
+		Guard lock(mtxScripts);
+
+		map<string, vector<ScriptStmt> >::const_iterator iter;
+
+		iter = scripts.find(name);
+		if (iter != scripts.end())
+		{
+			stmts = iter->second;
+			return true;
+		}
+	}
+
+	if (!env.dirScripts.size())
+	{
+		strErr = "script not defined";
+		return false;
+	}
+
+	string nameFile = env.dirScripts + "/" + name + ".txt";
+	string src;
+	char buf[256];
+	size_t lenDone;
+	FILE *pFile;
+
+	pFile = fopen(nameFile.c_str(), "r");
+	if (!pFile)
+	{
+		strErr = "script not found";
+		return false;
+	}
+
+	while (src.size() <= cSizeSrcScriptMax)
+	{
+		lenDone = fread(buf, 1, sizeof(buf), pFile);
+		if (!lenDone)
+			break;
+
+		src.append(buf, lenDone);
+	}
+
+	fclose(pFile);
+
+	// Files are read on every run. Changes take effect immediately
+	return scriptParse(src, stmts, strErr);
+}
+
+bool scriptDelete(const string &name)
+{
+	Guard lock(mtxScripts);
+
+	return scripts.erase(name) > 0;
+}
+
+void scriptsList(list<string> &names)
+{
+	map<string, vector<ScriptStmt> >::const_iterator iter;
+
+	names.clear();
+
+	Guard lock(mtxScripts);
+
+	iter = scripts.begin();
+	for (; iter != scripts.end(); ++iter)
+		names.push_back(iter->first);
+}
+
@@ -0,0 +1,81 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_SCRIPTING_H
+#define LIB_SCRIPTING_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <list>
+
+/*
+ * Command scripts
+ *
+ * A script is a sequence of statements separated by
+ * newlines or ';'. Leading and trailing blanks are ignored.
+ *
+ *   <command>               Send command to target
+ *   repeat <n> .. end       Execute block n times
+ *   wait <ms>               Delay
+ *   expect <text>           Abort unless last response contains text
+ *   until <text> <command>  Repeat command until response contains text
+ *   # ..                    Comment
+ *
+ * Scripts are defined at runtime or loaded from
+ * <dirScripts>/<name>.txt when not defined.
+ */
+
+enum ScriptOp
+{
+	ScriptOpCmd = 0,
+	ScriptOpRepeat,
+	ScriptOpEnd,
+	ScriptOpWait,
+	ScriptOpExpect,
+	ScriptOpUntil,
+};
+
+struct ScriptStmt
+{
+	ScriptOp op;
+	std::string cmd;
+	std::string text;
+	uint32_t val;
+	size_t idxJump; // repeat: matching end. end: matching repeat
+};
+
+const size_t cSizeSrcScriptMax = 8192;
+const size_t cNumStmtsScriptMax = 256;
+const size_t cDepthRepeatMax = 8;
+
+bool scriptParse(const std::string &src, std::vector<ScriptStmt> &stmts, std::string &strErr);
+bool scriptDefine(const std::string &name, const std::string &src, std::string &strErr);
+bool scriptGet(const std::string &name, std::vector<ScriptStmt> &stmts, std::string &strErr);
+bool scriptDelete(const std::string &name);
+void scriptsList(std::list<std::string> &names);
+
+#endif
+
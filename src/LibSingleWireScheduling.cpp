@@ -25,6 +25,8 @@
 
 #include "SingleWireScheduling.h"
 #include "SystemDebugging.h"
+#include "LibTargetSim.h"
+#include "LibTracing.h"
 #include "LibDspc.h"
 
 #include "env.h"
@@ -65,6 +67,43 @@ void SingleWireScheduling::fragmentAppend(uint8_t ch)
 		return;
 
 	uint8_t idContent = mResp.idContent;
+
+	// Tag precedes the response
+	if (mTagRespPending && idContent == IdContentTaToScCmd)
+	{
+		string &strTag = mFragments[idContent];
+
+		if (ch != ' ' && strTag.size() < cLenTagMax)
+		{
+			strTag.push_back((char)ch);
+			return;
+		}
+
+		cmdRespTagged(strTag);
+		strTag.clear();
+
+		mRespStreamed = !mResp.unsolicited && mRespCmdMatched &&
+					mStreamedCurrent;
+
+		return;
+	}
+
+	// No size limit. Full chunks are passed on immediately
+	if (mRespStreamed)
+	{
+		string &strChunk = mFragments[idContent];
+
+		strChunk.push_back((char)ch);
+
+		if (strChunk.size() < cSizeChunkCmd)
+			return;
+
+		cmdChunkCommit(strChunk, false);
+		strChunk.clear();
+
+		return;
+	}
+
 	bool fragmentFound =
 			mFragments.find(idContent) != mFragments.end();
 
@@ -95,6 +134,13 @@ void SingleWireScheduling::fragmentFinish()
 
 	mResp.content = mFragments[idContent];
 	mFragments.erase(idContent);
+
+	if (mRespStreamed || mResp.content.size() <= cSizeFragmentMax)
+		return;
+
+	++mCntRespTruncated;
+	procWrnLog("content 0x%02X truncated to %zu bytes",
+				idContent, mResp.content.size());
 }
 
 void SingleWireScheduling::fragmentDelete()
@@ -144,7 +190,23 @@ void SingleWireScheduling::requestsCmdPrint(char * &pBuf, char *pBufEnd)
 	uint32_t curTimeMs = millis();
 	uint32_t diffMs;
 
-	for (size_t i = 0; i < 3; ++i)
+	dInfo("In flight\n");
+
+	if (!cmdsInFlight.size())
+		dInfo("  <none>\n");
+
+	iter = cmdsInFlight.begin();
+	for (; iter != cmdsInFlight.end(); ++iter)
+	{
+		diffMs = curTimeMs - iter->sentMs;
+
+		dInfo("  Req %u, tag %u: %s (%u)%s\n",
+				iter->idReq, iter->tag,
+				iter->str.c_str(), diffMs,
+				iter->cancelled ? ", cancelled" : "");
+	}
+
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
 	{
 		pList = &requestsCmd[i];
 
@@ -196,7 +258,8 @@ void SingleWireScheduling::responsesCmdPrint(char * &pBuf, char *pBufEnd)
 	}
 }
 
-bool SingleWireScheduling::commandSend(const string &cmd, uint32_t &idReq, PrioCmd prio)
+// Streamed responses are fetched with commandChunkGet()
+bool SingleWireScheduling::commandSend(const string &cmd, uint32_t &idReq, PrioCmd prio, bool streamed)
 {
 	{
 		Guard lock(mtxResponses);
@@ -215,13 +278,43 @@ bool SingleWireScheduling::commandSend(const string &cmd, uint32_t &idReq, PrioC
 	idReq = idReqCmdNext;
 	++idReqCmdNext;
 
-	pList->emplace_back(cmd, idReq, millis());
+	pList->emplace_back(cmd, idReq, millis(), streamed);
+
+	cmdTraceStart(idReq, cmd);
 
-	dbgLog("command queued: %s", cmd.c_str());
+	dbgLog("command queued%s: %s", streamed ? " (streamed)" : "", cmd.c_str());
 
 	return true;
 }
 
+bool SingleWireScheduling::commandChunkGet(uint32_t idReq, string &chunk, bool &last, bool &truncated)
+{
+	Guard lock(mtxResponses);
+
+	list<ChunkResp>::iterator iter;
+
+	iter = chunksCmd.begin();
+	for (; iter != chunksCmd.end(); ++iter)
+	{
+		if (iter->idReq != idReq)
+			continue;
+
+		chunk.swap(iter->data);
+		last = iter->last;
+		truncated = iter->truncated;
+
+		sizeChunksCmd -= chunk.size();
+		chunksCmd.erase(iter);
+
+		if (last)
+			cmdTraceMark(idReq, CmdTracePickup);
+
+		return true;
+	}
+
+	return false;
+}
+
 bool SingleWireScheduling::commandResponseGet(uint32_t idReq, string &resp)
 {
 	Guard lock(mtxResponses);
@@ -240,12 +333,151 @@ bool SingleWireScheduling::commandResponseGet(uint32_t idReq, string &resp)
 		resp = iter->str;
 		iter = responsesCmd.erase(iter);
 
+		cmdTraceMark(idReq, CmdTracePickup);
+
 		return true;
 	}
 
 	return false;
 }
 
+void SingleWireScheduling::commandCancel(uint32_t idReq)
+{
+	list<CommandReqResp>::iterator iter;
+
+	cmdTraceCancel(idReq);
+
+	{
+		Guard lock(mtxRequests);
+
+		for (size_t i = 0; i < cNumPrioCmd; ++i)
+		{
+			list<CommandReqResp> *pList = &requestsCmd[i];
+
+			if (!pList->size())
+				continue;
+
+			iter = pList->begin();
+			for (; iter != pList->end(); ++iter)
+			{
+				if (iter->idReq != idReq)
+					continue;
+
+				pList->erase(iter);
+				return;
+			}
+		}
+
+		// Response is dropped when it arrives. Keeps the tag in use
+		iter = cmdsInFlight.begin();
+		for (; iter != cmdsInFlight.end(); ++iter)
+		{
+			if (iter->idReq != idReq)
+				continue;
+
+			iter->cancelled = true;
+			break;
+		}
+	}
+
+	Guard lock(mtxResponses);
+
+	list<ChunkResp>::iterator iterChunk;
+
+	iterChunk = chunksCmd.begin();
+	while (iterChunk != chunksCmd.end())
+	{
+		if (iterChunk->idReq != idReq)
+		{
+			++iterChunk;
+			continue;
+		}
+
+		sizeChunksCmd -= iterChunk->data.size();
+		iterChunk = chunksCmd.erase(iterChunk);
+	}
+
+	iter = responsesCmd.begin();
+	for (; iter != responsesCmd.end(); ++iter)
+	{
+		if (iter->idReq != idReq)
+			continue;
+
+		responsesCmd.erase(iter);
+		return;
+	}
+}
+
+/*
+ * Only one bulk transfer at a time. The ID must be sent
+ * to the target with the start command after opening.
+ */
+bool SingleWireScheduling::bulkOpen(uint8_t &idXfer)
+{
+	Guard lock(mtxResponses);
+
+	if (!windowBulk || xferBulk.active)
+		return false;
+
+	idXfer = idXferBulkNext++;
+	if (!idXferBulkNext)
+		idXferBulkNext = 1;
+
+	xferBulk.idXfer = idXfer;
+	xferBulk.active = true;
+	xferBulk.seqNext = 0;
+	xferBulk.seqAcked = 0;
+	xferBulk.resendReq = false;
+	xferBulk.resendSent = false;
+	xferBulk.cntStale = 0;
+	xferBulk.lastRcvdMs = millis();
+	xferBulk.lastAckMs = xferBulk.lastRcvdMs;
+	xferBulk.chunks.clear();
+	xferBulk.sizeQueued = 0;
+	xferBulk.cntBytes = 0;
+	xferBulk.cntErrCrc = 0;
+	xferBulk.cntGaps = 0;
+	xferBulk.cntResends = 0;
+
+	return true;
+}
+
+Success SingleWireScheduling::bulkDataGet(uint8_t idXfer, string &data)
+{
+	Guard lock(mtxResponses);
+
+	if (!xferBulk.active || xferBulk.idXfer != idXfer)
+		return -1;
+
+	if (!xferBulk.chunks.size())
+		return Pending;
+
+	data = move(xferBulk.chunks.front());
+	xferBulk.chunks.pop_front();
+
+	xferBulk.sizeQueued -= data.size();
+
+	return Positive;
+}
+
+void SingleWireScheduling::bulkClose(uint8_t idXfer)
+{
+	Guard lock(mtxResponses);
+
+	if (xferBulk.idXfer != idXfer)
+		return;
+
+	xferBulk.active = false;
+	xferBulk.chunks.clear();
+	xferBulk.sizeQueued = 0;
+}
+
+bool SingleWireScheduling::bulkActive()
+{
+	Guard lock(mtxResponses);
+	return xferBulk.active;
+}
+
 bool SingleWireScheduling::isCtrl(char ch)
 {
 	if (ch == FlowSchedToTarget || ch == FlowTargetToSched)
@@ -262,6 +494,10 @@ bool SingleWireScheduling::isCtrl(char ch)
 		ch == IdContentEnd)
 		return true;
 
+	if (ch == IdContentTaToScBulk || ch == IdContentScToTaBulk ||
+		ch == IdContentTaToScSample)
+		return true;
+
 	return false;
 }
 
@@ -278,6 +514,13 @@ void SingleWireScheduling::commandsRegister()
 	cmdReg("timeoutToggle",    cmdTimeoutUartVirtToggle, "t", "Enable/Disable virtual UART timeout", "Virtual UART");
 	cmdReg("dataUartRcv",      cmdDataUartRcv,           "",  "Receive byte stream",                 "Virtual UART");
 	cmdReg("strUartRcv",       cmdStrUartRcv,            "",  "Receive string",                      "Virtual UART");
+	cmdReg("uartVirtSizeSet",  cmdSizeUartVirtSet,       "",  "Set buffer size of virtual UART",     "Virtual UART");
+	cmdReg("simProcsSet",      cmdProcsSimSet,           "",  "Number of simulated processes",       "Target Simulation");
+	cmdReg("simLogRateSet",    cmdRateLogSimSet,         "",  "Simulated log entries per second",    "Target Simulation");
+	cmdReg("simLatencySet",    cmdLatencySimSet,         "",  "Simulated command latency [ms]",      "Target Simulation");
+	cmdReg("refreshRateSet",   cmdRateRefreshSet,        "",  "Refresh rate of process tree [ms]",   "Scheduling");
+	cmdReg("budgetSet",        cmdBudgetSet,             "",  "Link shares: proc:0-20,log:60-100",   "Scheduling");
+	cmdReg("statsToggle",      cmdStatsDetailedToggle,   "",  "Show link and command statistics",    "Scheduling");
 }
 
 void SingleWireScheduling::cmdMonitoringToggle(char *pArgs, char *pBuf, char *pBufEnd)
@@ -352,10 +595,17 @@ void SingleWireScheduling::cmdDataUartRead(char *pArgs, char *pBuf, char *pBufEn
 
 void SingleWireScheduling::cmdModeUartVirtSet(char *pArgs, char *pBuf, char *pBufEnd)
 {
+	if (pArgs && !strcmp(pArgs, "sim"))
+	{
+		uartSimStart();
+		dInfo("Virtual UART mode: sim");
+		return;
+	}
+
 	if (pArgs && *pArgs == 'u')
-		uartVirtualMode = 1;
+		uartVirtualMode = UartVirtModeUart;
 	else
-		uartVirtualMode = 0;
+		uartVirtualMode = UartVirtModeSwart;
 
 	dInfo("Virtual UART mode: %s", uartVirtualMode ? "uart" : "swart");
 }
@@ -394,6 +644,77 @@ void SingleWireScheduling::cmdStrUartRcv(char *pArgs, char *pBuf, char *pBufEnd)
 	strUartSend(pArgs, pBuf, pBufEnd, uartVirtRcv);
 }
 
+void SingleWireScheduling::cmdSizeUartVirtSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	size_t sizeBuf = pArgs ? strtoul(pArgs, NULL, 10) : 0;
+
+	if (!uartVirtSizeSet(sizeBuf))
+	{
+		dInfo("Invalid size");
+		return;
+	}
+
+	dInfo("Virtual UART buffer size: %zu", sizeBuf);
+}
+
+void SingleWireScheduling::cmdProcsSimSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	if (pArgs)
+		targetSimConf.numProcs = (uint32_t)strtoul(pArgs, NULL, 10);
+
+	dInfo("Simulated processes: %u", targetSimConf.numProcs);
+}
+
+void SingleWireScheduling::cmdRateLogSimSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	if (pArgs)
+		targetSimConf.rateLogPerSec = (uint32_t)strtoul(pArgs, NULL, 10);
+
+	dInfo("Simulated log rate: %u [1/s]", targetSimConf.rateLogPerSec);
+}
+
+void SingleWireScheduling::cmdLatencySimSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	if (pArgs)
+		targetSimConf.latencyCmdMs = (uint32_t)strtoul(pArgs, NULL, 10);
+
+	dInfo("Simulated command latency: %u [ms]", targetSimConf.latencyCmdMs);
+}
+
+void SingleWireScheduling::cmdRateRefreshSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	uint32_t rateMs = pArgs ? (uint32_t)strtoul(pArgs, NULL, 10) : 0;
+
+	if (rateMs >= (uint32_t)cRateRefreshMinMs &&
+			rateMs <= (uint32_t)cRateRefreshMaxMs)
+		env.rateRefreshMs = rateMs;
+
+	dInfo("Refresh rate: %u [ms]", env.rateRefreshMs);
+}
+
+void SingleWireScheduling::cmdBudgetSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	string spec = pArgs ? pArgs : "";
+
+	if (!budgetParse(spec, NULL, NULL))
+	{
+		dInfo("Invalid budget: %s", spec.c_str());
+		return;
+	}
+
+	env.budget = spec;
+
+	dInfo("Budget: %s", env.budget.size() ? env.budget.c_str() : "No limits");
+}
+
+void SingleWireScheduling::cmdStatsDetailedToggle(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+
+	statsDetailed ^= 1;
+	dInfo("Detailed statistics %sabled", statsDetailed ? "en" : "dis");
+}
+
 void SingleWireScheduling::dataUartSend(char *pArgs, char *pBuf, char *pBufEnd, FuncUartSend pFctSend)
 {
 	if (!pArgs)
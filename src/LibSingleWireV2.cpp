@@ -0,0 +1,110 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LibSingleWireV2.h"
+#include "LibBulkTransfer.h"
+
+using namespace std;
+
+// CRC-16/CCITT-FALSE
+uint16_t crc16Calc(const void *pData, size_t len, uint16_t crc)
+{
+	const uint8_t *pSrc = (const uint8_t *)pData;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		crc ^= (uint16_t)(pSrc[i] << 8);
+
+		for (size_t k = 0; k < 8; ++k)
+			crc = (uint16_t)(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+	}
+
+	return crc;
+}
+
+void frameV2Encode(const FrameHdrV2 &hdr, const string &payload, string &frame)
+{
+	uint32_t crc;
+	uint16_t crcHdr;
+	size_t len = payload.size();
+
+	frame.clear();
+	frame.reserve(cLenFrameV2Hdr + len + cLenFrameV2Crc);
+
+	frame.push_back((char)cSofV2);
+	frame.push_back((char)hdr.type);
+	frame.push_back((char)hdr.flags);
+	frame.push_back((char)hdr.seq);
+	frame.push_back((char)(uint8_t)len);
+	frame.push_back((char)(uint8_t)(len >> 8));
+
+	crcHdr = crc16Calc(frame.data() + 1, 5);
+
+	frame.push_back((char)(uint8_t)crcHdr);
+	frame.push_back((char)(uint8_t)(crcHdr >> 8));
+
+	frame += payload;
+
+	crc = crc32Calc(payload.data(), len);
+
+	for (size_t i = 0; i < 4; ++i)
+		frame.push_back((char)(uint8_t)(crc >> (8 * i)));
+}
+
+// pHdr points to the start of frame byte
+bool frameV2HdrDecode(const uint8_t *pHdr, FrameHdrV2 &hdr)
+{
+	uint16_t crcHdr = pHdr[6] | (uint16_t)(pHdr[7] << 8);
+
+	if (pHdr[0] != cSofV2)
+		return false;
+
+	if (crc16Calc(pHdr + 1, 5) != crcHdr)
+		return false;
+
+	hdr.type = pHdr[1];
+	hdr.flags = pHdr[2];
+	hdr.seq = pHdr[3];
+	hdr.len = (uint16_t)(pHdr[4] | pHdr[5] << 8);
+
+	return true;
+}
+
+bool frameV2PayloadCheck(const string &payloadWithCrc)
+{
+	size_t len = payloadWithCrc.size();
+	uint32_t crc = 0;
+
+	if (len < cLenFrameV2Crc)
+		return false;
+
+	len -= cLenFrameV2Crc;
+
+	for (size_t i = 0; i < 4; ++i)
+		crc |= (uint32_t)(uint8_t)payloadWithCrc[len + i] << (8 * i);
+
+	return crc32Calc(payloadWithCrc.data(), len) == crc;
+}
+
@@ -0,0 +1,92 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_SINGLE_WIRE_V2_H
+#define LIB_SINGLE_WIRE_V2_H
+
+#include <cinttypes>
+#include <string>
+
+/*
+ * SingleWire v2
+ *
+ * Negotiated during target init. Targets supporting v2 answer
+ * the init code with 'Debug mode 2'. The scheduler then sends
+ * the system command 'protoSet 2', still v1 framed. After the
+ * answer 'Proto 2' both sides use v2 frames. Targets answering
+ * 'Debug mode 1' stay on v1. The init code, always v1 framed,
+ * resets the target to v1.
+ *
+ * Frame, little endian
+ *   sof(1) type(1) flags(1) seq(1) len(2) crc16(2) payload(len) crc32(4)
+ *
+ * crc16 (CCITT) covers type to len, crc32 the payload. Frame
+ * types are the SingleWire flow and content IDs. Payloads may
+ * contain any byte and are never scanned for delimiters.
+ *
+ * Scheduler -> Target
+ *   FlowTargetToSched     Data request. Empty
+ *   IdContentScToTaCmd    Command
+ *   IdContentScToTaBulk   Bulk ack
+ *   IdFrameResend         Send frame <seq> again. Payload: seq(1)
+ *
+ * Target -> Scheduler
+ *   IdContentTaToSc*      Content. One frame per data request
+ *
+ * seq counts the frames sent by the target. The target keeps
+ * its last 16 frames. Frames missing in seq or with a bad
+ * payload are requested one by one. A resend request for a
+ * frame not sent yet is handled like a data request.
+ */
+
+const uint8_t cSofV2 = 0xA5;
+const uint8_t IdFrameResend = 0x0D;
+const uint32_t cVersionProto = 2;
+
+const size_t cLenFrameV2Hdr = 8;
+const size_t cLenFrameV2Crc = 4;
+const size_t cLenFrameV2PayloadMax = 65535;
+
+enum FrameFlagV2
+{
+	FlagFrameUnsolicited = 1,
+};
+
+struct FrameHdrV2
+{
+	uint8_t type;
+	uint8_t flags;
+	uint8_t seq;
+	uint16_t len;
+};
+
+uint16_t crc16Calc(const void *pData, size_t len, uint16_t crc = 0xFFFF);
+
+void frameV2Encode(const FrameHdrV2 &hdr, const std::string &payload, std::string &frame);
+bool frameV2HdrDecode(const uint8_t *pHdr, FrameHdrV2 &hdr);
+bool frameV2PayloadCheck(const std::string &payloadWithCrc);
+
+#endif
+
@@ -0,0 +1,148 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LibStreaming.h"
+
+using namespace std;
+
+static const char *cHexDigits = "0123456789abcdef";
+
+void jsonEscapeAppend(const string &str, string &msg)
+{
+	uint8_t ch;
+
+	msg.push_back('"');
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		ch = (uint8_t)str[i];
+
+		if (ch == '"' || ch == '\\')
+		{
+			msg.push_back('\\');
+			msg.push_back((char)ch);
+			continue;
+		}
+
+		if (ch >= 0x20)
+		{
+			msg.push_back((char)ch);
+			continue;
+		}
+
+		if (ch == '\n')
+		{
+			msg += "\\n";
+			continue;
+		}
+
+		if (ch == '\r')
+		{
+			msg += "\\r";
+			continue;
+		}
+
+		if (ch == '\t')
+		{
+			msg += "\\t";
+			continue;
+		}
+
+		msg += "\\u00";
+		msg.push_back(cHexDigits[ch >> 4]);
+		msg.push_back(cHexDigits[ch & 0x0F]);
+	}
+
+	msg.push_back('"');
+}
+
+void streamHelloEncode(string &msg)
+{
+	msg = "{\"type\":\"hello\",\"version\":";
+	msg += to_string(cVersionStream);
+	msg += "}\n";
+}
+
+// Without previous lines a keyframe is encoded
+void streamProcEncode(uint64_t tsMs,
+			const vector<string> &lines,
+			const vector<string> *pLinesLast,
+			string &msg)
+{
+	bool first = true;
+
+	msg = "{\"type\":\"proc\",\"ts\":";
+	msg += to_string(tsMs);
+	msg += ",\"key\":";
+	msg += pLinesLast ? "false" : "true";
+	msg += ",\"lines\":";
+	msg += to_string(lines.size());
+	msg += ",\"chg\":[";
+
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		if (pLinesLast && i < pLinesLast->size() && lines[i] == (*pLinesLast)[i])
+			continue;
+
+		if (!first)
+			msg.push_back(',');
+		first = false;
+
+		msg.push_back('[');
+		msg += to_string(i);
+		msg.push_back(',');
+		jsonEscapeAppend(lines[i], msg);
+		msg.push_back(']');
+	}
+
+	msg += "]}\n";
+}
+
+void streamLogEncode(uint64_t tsMs, const string &entry, string &msg)
+{
+	msg = "{\"type\":\"log\",\"ts\":";
+	msg += to_string(tsMs);
+	msg += ",\"msg\":";
+	jsonEscapeAppend(entry, msg);
+	msg += "}\n";
+}
+
+void streamCmdEncode(uint64_t tsMs, uint32_t idReq,
+			const string &cmd, const string &resp,
+			uint32_t durationMs, string &msg)
+{
+	msg = "{\"type\":\"cmd\",\"ts\":";
+	msg += to_string(tsMs);
+	msg += ",\"id\":";
+	msg += to_string(idReq);
+	msg += ",\"cmd\":";
+	jsonEscapeAppend(cmd, msg);
+	msg += ",\"resp\":";
+	jsonEscapeAppend(resp, msg);
+	msg += ",\"durMs\":";
+	msg += to_string(durationMs);
+	msg += "}\n";
+}
+
@@ -0,0 +1,65 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_STREAMING_H
+#define LIB_STREAMING_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/*
+ * Stream port
+ *
+ * Machine-readable variant of the target ports. One JSON object
+ * per line. All timestamps are host time in ms since epoch.
+ *
+ *   {"type":"hello","version":1}
+ *   {"type":"proc","ts":..,"key":true,"lines":N,"chg":[[idx,"line"],..]}
+ *   {"type":"log","ts":..,"msg":".."}
+ *   {"type":"cmd","ts":..,"id":N,"cmd":"..","resp":"..","durMs":N}
+ *
+ * Process trees are sent as line deltas. A keyframe contains
+ * all lines and is sent when a client connects. For a delta,
+ * 'lines' is the new line count and 'chg' the changed lines.
+ * Messages are encoded once and shared by all clients.
+ */
+
+const uint32_t cVersionStream = 1;
+
+void jsonEscapeAppend(const std::string &str, std::string &msg);
+
+void streamHelloEncode(std::string &msg);
+void streamProcEncode(uint64_t tsMs,
+			const std::vector<std::string> &lines,
+			const std::vector<std::string> *pLinesLast,
+			std::string &msg);
+void streamLogEncode(uint64_t tsMs, const std::string &entry, std::string &msg);
+void streamCmdEncode(uint64_t tsMs, uint32_t idReq,
+			const std::string &cmd, const std::string &resp,
+			uint32_t durationMs, std::string &msg);
+
+#endif
+
@@ -0,0 +1,1113 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <list>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+#include "LibTargetSim.h"
+#include "LibBulkTransfer.h"
+#include "LibSampling.h"
+#include "LibSingleWireV2.h"
+#include "SingleWire.h"
+
+using namespace std;
+
+enum SimRcvState
+{
+	SimRcvWait = 0,
+	SimRcvCmdId,
+	SimRcvCmd,
+	SimRcvEndWait,
+	SimRcvBulkAck,
+	SimRcvV2Hdr,
+	SimRcvV2Payload,
+};
+
+struct SimResponseCmd
+{
+	string str;
+	uint32_t readyMs;
+	bool protoSwitch;
+};
+
+struct SimTransferBulk
+{
+	bool active;
+	uint8_t idXfer;
+	string data;
+	uint32_t numChunks;
+	uint32_t seqSent;
+	uint32_t seqAcked;
+};
+
+enum SimSymbol
+{
+	SimSymSin = 0,
+	SimSymSaw,
+	SimSymSquare,
+	SimSymNoise,
+	SimSymTicks,
+};
+
+struct SimSampling
+{
+	bool active;
+	uint8_t idSet;
+	uint32_t periodUs;
+	vector<SimSymbol> symbols;
+	uint64_t nextUs;
+	uint32_t seq;
+};
+
+const size_t cNumLogsPendingMax = 256;
+const size_t cLenCmdMax = 1023;
+const uint32_t cWindowBulk = 8;
+const uint32_t cSizeChunkBulk = 256;
+const size_t cSizeTraceDefault = 256 << 10;
+const size_t cSizeTraceMax = 16 << 20;
+const size_t cNumFramesV2Kept = 16;
+const uint32_t cNumCmdsTaggedMax = 8;
+const size_t cNumLogsPushMax = 8;
+
+TargetSimConfig targetSimConf =
+{
+	"aaaaa",	// codeInit
+	20,			// numProcs
+	10,			// rateLogPerSec
+	5,			// latencyCmdMs
+	30,			// numCmds
+	100,		// periodProcMs
+	0,			// ratioUnsolicitedPct
+	0,			// ratioCutPct
+	0,			// ratioDropPermille
+	0,			// ratioCorruptPermille
+	0,			// protoV2
+	0,			// extensions
+	0,			// throughputBps
+	0,			// jitterMs
+};
+
+static FuncTargetSimSend pFctSimSend = NULL;
+static uint32_t stateRcv = SimRcvWait;
+static string cmdRcv;
+static list<SimResponseCmd> responsesCmd;
+static list<string> logsPending;
+static uint32_t lastLogMs = 0;
+static uint32_t rateLogBytes = 0;
+static uint32_t creditLogBytes = 0;
+static uint32_t lastCreditLogMs = 0;
+static uint32_t lastProcMs = 0;
+static uint32_t cntLogs = 0;
+static uint32_t cntProcTrees = 0;
+static uint32_t idxHelp = 0;
+static bool debugMode = false;
+static uint32_t levelLog = 5;
+static size_t cntBytesDropped = 0;
+static size_t cntBytesCorrupted = 0;
+static SimTransferBulk xferBulk;
+static SimSampling sampling;
+static bool protoV2 = false;
+static bool pushMode = false;
+static uint8_t seqTxV2 = 0;
+static list<string> framesV2;
+static FrameHdrV2 hdrRcvV2;
+
+static bool chanceHit(uint32_t ratioPct)
+{
+	if (!ratioPct)
+		return false;
+
+	return (uint32_t)(rand() % 100) < ratioPct;
+}
+
+// Fault injection on byte level
+static void dataSend(const void *pData, size_t len)
+{
+	if (!targetSimConf.ratioDropPermille && !targetSimConf.ratioCorruptPermille)
+	{
+		pFctSimSend(pData, len);
+		return;
+	}
+
+	const uint8_t *pSrc = (const uint8_t *)pData;
+	uint8_t ch;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		ch = pSrc[i];
+
+		if ((uint32_t)(rand() % 1000) < targetSimConf.ratioDropPermille)
+		{
+			++cntBytesDropped;
+			continue;
+		}
+
+		if ((uint32_t)(rand() % 1000) < targetSimConf.ratioCorruptPermille)
+		{
+			ch ^= (uint8_t)(1 << (rand() % 8));
+			++cntBytesCorrupted;
+		}
+
+		pFctSimSend(&ch, 1);
+	}
+}
+
+// Frames are kept for resend requests. Cuts send a partial frame
+static void frameV2Send(uint8_t type, const string &payload, bool unsolicited)
+{
+	FrameHdrV2 hdr;
+	string frame;
+
+	hdr.type = type;
+	hdr.flags = unsolicited ? FlagFrameUnsolicited : 0;
+	hdr.seq = seqTxV2++;
+	hdr.len = (uint16_t)payload.size();
+
+	frameV2Encode(hdr, payload, frame);
+
+	framesV2.push_back(frame);
+	if (framesV2.size() > cNumFramesV2Kept)
+		framesV2.pop_front();
+
+	if (payload.size() > 1 && chanceHit(targetSimConf.ratioCutPct))
+	{
+		dataSend(frame.data(), frame.size() >> 1);
+		return;
+	}
+
+	dataSend(frame.data(), frame.size());
+}
+
+static void contentSend(uint8_t idContent, const string &str, bool unsolicited = false)
+{
+	uint8_t idEnd = IdContentEnd;
+
+	if (protoV2)
+	{
+		frameV2Send(idContent, str, unsolicited);
+		return;
+	}
+
+	if (unsolicited)
+	{
+		uint8_t idUnsol = IdContentUnsolicited;
+		dataSend(&idUnsol, 1);
+	}
+
+	dataSend(&idContent, 1);
+
+	if (str.size() > 1 && chanceHit(targetSimConf.ratioCutPct))
+	{
+		dataSend(str.data(), str.size() >> 1);
+
+		idEnd = IdContentCut;
+		dataSend(&idEnd, 1);
+
+		return;
+	}
+
+	if (str.size())
+		dataSend(str.data(), str.size());
+
+	dataSend(&idEnd, 1);
+}
+
+static void noneSend()
+{
+	uint8_t idContent = IdContentTaToScNone;
+
+	if (protoV2)
+	{
+		frameV2Send(idContent, "", false);
+		return;
+	}
+
+	dataSend(&idContent, 1);
+}
+
+/*
+ * Bulk sources
+ *
+ *   trace [size]   Deterministic pattern covering all byte values
+ */
+static string bulkStart(const string &args)
+{
+	unsigned int idXfer;
+	char source[16];
+	unsigned long size = cSizeTraceDefault;
+	int res;
+
+	res = sscanf(args.c_str(), "%u %15s %lu", &idXfer, source, &size);
+	if (res < 2 || idXfer > 0xFF)
+		return "Bulk error: invalid arguments";
+
+	if (string(source) != "trace")
+		return "Bulk error: unknown source";
+
+	if (size > cSizeTraceMax)
+		size = cSizeTraceMax;
+
+	xferBulk.active = true;
+	xferBulk.idXfer = (uint8_t)idXfer;
+	xferBulk.data.resize(size);
+	xferBulk.numChunks = (uint32_t)((size + cSizeChunkBulk - 1) / cSizeChunkBulk);
+	xferBulk.seqSent = 0;
+	xferBulk.seqAcked = 0;
+
+	for (size_t i = 0; i < size; ++i)
+		xferBulk.data[i] = (char)(uint8_t)(i ^ (i >> 8));
+
+	return "Bulk " + to_string(idXfer) + " " + to_string(size);
+}
+
+static void bulkAckReceived()
+{
+	BulkAck ack;
+	bool ok;
+
+	ok = bulkAckDecode(cmdRcv, ack);
+	if (!ok || !xferBulk.active || ack.idXfer != xferBulk.idXfer)
+		return;
+
+	if (ack.seqNext > xferBulk.seqSent)
+		return;
+
+	xferBulk.seqAcked = ack.seqNext;
+
+	// Go-back-N
+	if (ack.flags & BulkAckResend)
+		xferBulk.seqSent = ack.seqNext;
+
+	if (xferBulk.seqAcked < xferBulk.numChunks)
+		return;
+
+	xferBulk.active = false;
+	xferBulk.data.clear();
+}
+
+static bool bulkChunkSend()
+{
+	BulkChunk chunk;
+	string frame;
+	size_t idx;
+
+	if (!xferBulk.active)
+		return false;
+
+	if (xferBulk.seqSent >= xferBulk.numChunks)
+		return false;
+
+	if (xferBulk.seqSent - xferBulk.seqAcked >= cWindowBulk)
+		return false;
+
+	idx = (size_t)xferBulk.seqSent * cSizeChunkBulk;
+
+	chunk.idXfer = xferBulk.idXfer;
+	chunk.seq = xferBulk.seqSent;
+	chunk.data = xferBulk.data.substr(idx, cSizeChunkBulk);
+
+	bulkChunkEncode(chunk, frame);
+	contentSend(IdContentTaToScBulk, frame);
+
+	++xferBulk.seqSent;
+
+	return true;
+}
+
+/*
+ * Sampled symbols
+ *
+ *   sin     1 Hz, amplitude 1000
+ *   saw     Period 1000 samples
+ *   square  2 Hz, 0 / 1000
+ *   noise   Random, 0 .. 999
+ *   ticks   Target time in ms
+ */
+static string samplingStart(const string &args)
+{
+	const char *names[] = { "sin", "saw", "square", "noise", "ticks" };
+	const size_t numNames = sizeof(names) / sizeof(*names);
+	unsigned int idSet, periodUs;
+	char *pEnd = NULL;
+	string name;
+	size_t idx;
+
+	idSet = (unsigned int)strtoul(args.c_str(), &pEnd, 10);
+	periodUs = (unsigned int)strtoul(pEnd, &pEnd, 10);
+
+	if (idSet > 0xFF || periodUs < 100)
+		return "Sample error: invalid arguments";
+
+	sampling.symbols.clear();
+
+	while (*pEnd)
+	{
+		while (*pEnd == ' ')
+			++pEnd;
+
+		name.clear();
+		while (*pEnd && *pEnd != ' ')
+			name.push_back(*pEnd++);
+
+		if (!name.size())
+			break;
+
+		for (idx = 0; idx < numNames; ++idx)
+		{
+			if (name == names[idx])
+				break;
+		}
+
+		if (idx >= numNames)
+			return "Sample error: unknown symbol " + name;
+
+		sampling.symbols.push_back((SimSymbol)idx);
+	}
+
+	if (!sampling.symbols.size() || sampling.symbols.size() > cNumChannelsSampleMax)
+		return "Sample error: invalid number of symbols";
+
+	sampling.active = true;
+	sampling.idSet = (uint8_t)idSet;
+	sampling.periodUs = periodUs;
+	sampling.nextUs = 0;
+	sampling.seq = 0;
+
+	return "Sample " + to_string(idSet) + " " +
+			to_string(sampling.symbols.size()) + " " + to_string(periodUs);
+}
+
+static int32_t symbolValue(SimSymbol sym, uint64_t tUs, uint64_t idxSample)
+{
+	switch (sym)
+	{
+	case SimSymSin:
+		return (int32_t)(1000 * sin(2 * M_PI * (double)(tUs % 1000000) / 1e6));
+	case SimSymSaw:
+		return (int32_t)(idxSample % 1000);
+	case SimSymSquare:
+		return (tUs % 500000) < 250000 ? 1000 : 0;
+	case SimSymNoise:
+		return rand() % 1000;
+	case SimSymTicks:
+		return (int32_t)(tUs / 1000);
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static void u32Append(uint32_t val, string &str)
+{
+	for (size_t i = 0; i < 4; ++i)
+		str.push_back((char)(uint8_t)(val >> (8 * i)));
+}
+
+// All samples due are sent at once, limited by the frame size
+static bool samplesSend(uint32_t curTimeMs)
+{
+	uint64_t nowUs = (uint64_t)curTimeMs * 1000;
+	size_t numCh = sampling.symbols.size();
+	size_t cntMax, cnt = 0;
+	uint64_t idxSample;
+	string raw, frame;
+
+	if (!sampling.active)
+		return false;
+
+	if (!sampling.nextUs)
+		sampling.nextUs = nowUs;
+
+	if (nowUs < sampling.nextUs)
+		return false;
+
+	cntMax = cLenBulkChunkMax / (numCh * 4);
+
+	raw.push_back((char)sampling.idSet);
+	u32Append(sampling.seq, raw);
+	u32Append((uint32_t)sampling.nextUs, raw);
+	raw.append(2, 0); // count
+
+	for (; cnt < cntMax && sampling.nextUs <= nowUs; ++cnt)
+	{
+		idxSample = sampling.nextUs / sampling.periodUs;
+
+		for (size_t k = 0; k < numCh; ++k)
+			u32Append((uint32_t)symbolValue(sampling.symbols[k], sampling.nextUs, idxSample), raw);
+
+		sampling.nextUs += sampling.periodUs;
+	}
+
+	// Target can't keep up. Skip instead of lagging behind
+	if (sampling.nextUs <= nowUs)
+		sampling.nextUs = nowUs + sampling.periodUs;
+
+	raw[9] = (char)(uint8_t)cnt;
+	raw[10] = (char)(uint8_t)(cnt >> 8);
+
+	u32Append(crc32Calc(raw.data(), raw.size()), raw);
+
+	bulkEscape(raw, frame);
+	contentSend(IdContentTaToScSample, frame);
+
+	++sampling.seq;
+
+	return true;
+}
+
+static string helpEntryNext()
+{
+	uint32_t numEntries = targetSimConf.numCmds + 2;
+	uint32_t idx = idxHelp % numEntries;
+	string str;
+
+	idxHelp = (idxHelp + 1) % numEntries;
+
+	if (!idx)
+		return "infoHelp|||";
+
+	if (idx == 1)
+		return "levelLogSys|||";
+
+	str = "simCmd" + to_string(idx - 2);
+	str += "||Simulated command ";
+	str += to_string(idx - 2);
+	str += "|Simulation";
+
+	return str;
+}
+
+/*
+ * Tagged commands: @<tag> <command>
+ * The tag is echoed in front of the response.
+ */
+// Like real firmware, the simulator doesn't know these by default
+static bool cmdExtension()
+{
+	const char *cmds[] =
+	{
+		"pushSet", "cmdTagCaps", "infoFirmware", "procRateSet",
+		"logRateSet", "bulkCaps", "bulkRead", "sampleStart", "sampleStop",
+	};
+	size_t len;
+
+	for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); ++i)
+	{
+		len = strlen(cmds[i]);
+
+		if (!cmdRcv.compare(0, len, cmds[i]) &&
+				(cmdRcv.size() == len || cmdRcv[len] == ' '))
+			return true;
+	}
+
+	return false;
+}
+
+static void commandReceived(uint32_t curTimeMs)
+{
+	SimResponseCmd resp;
+	string tag;
+	size_t idx;
+
+	if (cmdRcv.size() && cmdRcv[0] == '@')
+	{
+		idx = cmdRcv.find(' ');
+		if (idx != string::npos)
+		{
+			tag = cmdRcv.substr(0, idx + 1);
+			cmdRcv.erase(0, idx + 1);
+		}
+	}
+
+	resp.readyMs = curTimeMs + targetSimConf.latencyCmdMs;
+	resp.protoSwitch = false;
+
+	if (cmdRcv == targetSimConf.codeInit)
+	{
+		debugMode = true;
+		idxHelp = 0;
+		xferBulk.active = false;
+		sampling.active = false;
+		protoV2 = false;
+		pushMode = false;
+
+		resp.str = targetSimConf.protoV2 ? "Debug mode 2" : "Debug mode 1";
+		resp.readyMs = curTimeMs;
+	}
+	else
+	if (!debugMode)
+		return;
+	else
+	if (cmdRcv == "protoSet 2" && targetSimConf.protoV2)
+	{
+		// Answer is still v1 framed
+		resp.str = "Proto 2";
+		resp.readyMs = curTimeMs;
+		resp.protoSwitch = true;
+	}
+	else
+	if (!targetSimConf.extensions && cmdExtension())
+		resp.str = "sim: " + cmdRcv;
+	else
+	if (cmdRcv == "pushSet on" || cmdRcv == "pushSet off")
+	{
+		pushMode = cmdRcv == "pushSet on";
+		resp.str = pushMode ? "Push on" : "Push off";
+	}
+	else
+	if (cmdRcv == "cmdTagCaps")
+		resp.str = "Tags 1 " + to_string(cNumCmdsTaggedMax);
+	else
+	if (!cmdRcv.compare(0, 8, "simSlow "))
+	{
+		resp.readyMs = curTimeMs + (uint32_t)strtoul(cmdRcv.c_str() + 8, NULL, 10);
+		resp.str = "Slow done";
+	}
+	else
+	if (cmdRcv == "infoHelp")
+		resp.str = helpEntryNext();
+	else
+	if (cmdRcv == "infoFirmware")
+		resp.str = "Firmware sim-" + to_string(targetSimConf.numCmds);
+	else
+	if (cmdRcv == "levelLogSys")
+		resp.str = "Log level " + to_string(levelLog);
+	else
+	if (!cmdRcv.compare(0, 12, "levelLogSys "))
+	{
+		levelLog = (uint32_t)strtoul(cmdRcv.c_str() + 12, NULL, 10);
+		resp.str = "";
+	}
+	else
+	if (!cmdRcv.compare(0, 12, "procRateSet "))
+	{
+		targetSimConf.periodProcMs = (uint32_t)strtoul(cmdRcv.c_str() + 12, NULL, 10);
+		resp.str = "Refresh rate " + to_string(targetSimConf.periodProcMs);
+	}
+	else
+	if (!cmdRcv.compare(0, 11, "logRateSet "))
+	{
+		rateLogBytes = (uint32_t)strtoul(cmdRcv.c_str() + 11, NULL, 10);
+		creditLogBytes = rateLogBytes;
+		resp.str = "Log rate " + to_string(rateLogBytes);
+	}
+	else
+	if (cmdRcv == "bulkCaps")
+	{
+		resp.str = "Bulk " + to_string(cVersionBulk) + " " +
+					to_string(cWindowBulk) + " " + to_string(cSizeChunkBulk);
+	}
+	else
+	if (!cmdRcv.compare(0, 9, "bulkRead "))
+		resp.str = bulkStart(cmdRcv.substr(9));
+	else
+	if (!cmdRcv.compare(0, 12, "sampleStart "))
+		resp.str = samplingStart(cmdRcv.substr(12));
+	else
+	if (cmdRcv == "sampleStop")
+	{
+		sampling.active = false;
+		resp.str = "Sample stopped";
+	}
+	else
+		resp.str = "sim: " + cmdRcv;
+
+	resp.str.insert(0, tag);
+
+	responsesCmd.push_back(resp);
+}
+
+static void logsGenerate(uint32_t curTimeMs)
+{
+	uint32_t diffMs = curTimeMs - lastLogMs;
+	uint32_t cntNew;
+	string str;
+
+	if (!targetSimConf.rateLogPerSec)
+	{
+		lastLogMs = curTimeMs;
+		return;
+	}
+
+	cntNew = (uint32_t)((uint64_t)diffMs * targetSimConf.rateLogPerSec / 1000);
+	if (!cntNew)
+		return;
+
+	lastLogMs = curTimeMs;
+
+	// Simulated entries are informational
+	if (levelLog < 3)
+		return;
+
+	for (uint32_t i = 0; i < cntNew; ++i)
+	{
+		if (logsPending.size() >= cNumLogsPendingMax)
+			break;
+
+		str = to_string(curTimeMs);
+		str += "  SimProc";
+		str += to_string(targetSimConf.numProcs ? cntLogs % targetSimConf.numProcs : 0);
+		str += "  INF: simulated log entry ";
+		str += to_string(cntLogs);
+
+		logsPending.push_back(str);
+		++cntLogs;
+	}
+}
+
+// Entries above the log rate stay in the buffer
+static bool logSendAllowed(uint32_t curTimeMs)
+{
+	uint32_t diffMs = curTimeMs - lastCreditLogMs;
+	uint64_t creditNew;
+	size_t lenEntry;
+
+	if (!logsPending.size())
+		return false;
+
+	if (!rateLogBytes)
+		return true;
+
+	// Keep fractions of a byte for the next call
+	creditNew = (uint64_t)diffMs * rateLogBytes / 1000;
+	if (creditNew)
+		lastCreditLogMs = curTimeMs;
+
+	creditNew += creditLogBytes;
+	if (creditNew > rateLogBytes)
+		creditNew = rateLogBytes;
+
+	creditLogBytes = (uint32_t)creditNew;
+
+	lenEntry = logsPending.front().size();
+
+	// Entries longer than the rate are sent with a full credit
+	if (creditLogBytes < lenEntry && creditLogBytes < rateLogBytes)
+		return false;
+
+	creditLogBytes = creditLogBytes > lenEntry ? creditLogBytes - (uint32_t)lenEntry : 0;
+
+	return true;
+}
+
+static string procTreeCreate()
+{
+	string str;
+
+	str = "SimRoot()\t\t\t\t\tTicks: " + to_string(cntProcTrees) + "\n";
+
+	for (uint32_t i = 0; i < targetSimConf.numProcs; ++i)
+	{
+		str += string((size_t)(1 + (i % 4)) * 2, ' ');
+		str += "SimProc" + to_string(i) + "()";
+		str += "\t\t\t\tState: " + to_string((cntProcTrees + i) % 7);
+		str += "\n";
+	}
+
+	++cntProcTrees;
+
+	return str;
+}
+
+// Responses are sent when ready. Slow commands are passed by others
+static void dataRequested(uint32_t curTimeMs)
+{
+	list<SimResponseCmd>::iterator iter;
+
+	iter = responsesCmd.begin();
+	for (; iter != responsesCmd.end(); ++iter)
+	{
+		if ((int32_t)(curTimeMs - iter->readyMs) < 0)
+			continue;
+
+		contentSend(IdContentTaToScCmd, iter->str);
+
+		if (iter->protoSwitch)
+		{
+			protoV2 = true;
+			seqTxV2 = 0;
+			framesV2.clear();
+		}
+
+		responsesCmd.erase(iter);
+		return;
+	}
+
+	if (!debugMode)
+	{
+		noneSend();
+		return;
+	}
+
+	if (bulkChunkSend())
+		return;
+
+	if (samplesSend(curTimeMs))
+		return;
+
+	// Pushed by targetSimProcess()
+	if (pushMode)
+	{
+		noneSend();
+		return;
+	}
+
+	logsGenerate(curTimeMs);
+
+	if (logsPending.size() > 1 && chanceHit(targetSimConf.ratioUnsolicitedPct) &&
+			logSendAllowed(curTimeMs))
+	{
+		contentSend(IdContentTaToScLog, logsPending.front(), true);
+		logsPending.pop_front();
+	}
+
+	if (logSendAllowed(curTimeMs))
+	{
+		contentSend(IdContentTaToScLog, logsPending.front());
+		logsPending.pop_front();
+		return;
+	}
+
+	if (curTimeMs - lastProcMs >= targetSimConf.periodProcMs)
+	{
+		lastProcMs = curTimeMs;
+
+		contentSend(IdContentTaToScProc, procTreeCreate());
+		return;
+	}
+
+	noneSend();
+}
+
+static void frameV2Resend(uint8_t seq, uint32_t curTimeMs)
+{
+	list<string>::const_iterator iter;
+
+	// Not sent yet. Request was lost
+	if (seq == seqTxV2)
+	{
+		dataRequested(curTimeMs);
+		return;
+	}
+
+	iter = framesV2.begin();
+	for (; iter != framesV2.end(); ++iter)
+	{
+		if ((uint8_t)(*iter)[3] != seq)
+			continue;
+
+		dataSend(iter->data(), iter->size());
+		return;
+	}
+}
+
+static void frameV2Received(uint32_t curTimeMs)
+{
+	if (hdrRcvV2.type == FlowTargetToSched)
+	{
+		dataRequested(curTimeMs);
+		return;
+	}
+
+	if (hdrRcvV2.type == IdFrameResend)
+	{
+		if (cmdRcv.size() == 1)
+			frameV2Resend((uint8_t)cmdRcv[0], curTimeMs);
+
+		return;
+	}
+
+	if (hdrRcvV2.type == IdContentScToTaBulk)
+	{
+		bulkAckReceived();
+		return;
+	}
+
+	if (hdrRcvV2.type != IdContentScToTaCmd)
+		return;
+
+	if (cmdRcv.size() > cLenCmdMax)
+		cmdRcv.resize(cLenCmdMax);
+
+	commandReceived(curTimeMs);
+}
+
+/*
+ * Push mode: Logs and process trees are sent unsolicited
+ * as soon as they are created.
+ */
+void targetSimProcess(uint32_t curTimeMs)
+{
+	if (!pFctSimSend || !pushMode || !debugMode)
+		return;
+
+	logsGenerate(curTimeMs);
+
+	for (size_t i = 0; i < cNumLogsPushMax && logSendAllowed(curTimeMs); ++i)
+	{
+		contentSend(IdContentTaToScLog, logsPending.front(), true);
+		logsPending.pop_front();
+	}
+
+	if (curTimeMs - lastProcMs < targetSimConf.periodProcMs)
+		return;
+
+	lastProcMs = curTimeMs;
+
+	contentSend(IdContentTaToScProc, procTreeCreate(), true);
+}
+
+void targetSimStatsGet(size_t &cntDropped, size_t &cntCorrupted)
+{
+	cntDropped = cntBytesDropped;
+	cntCorrupted = cntBytesCorrupted;
+}
+
+void targetSimInit(FuncTargetSimSend pFctSend)
+{
+	pFctSimSend = pFctSend;
+
+	stateRcv = SimRcvWait;
+	cmdRcv.clear();
+	responsesCmd.clear();
+	logsPending.clear();
+	rateLogBytes = 0;
+	creditLogBytes = 0;
+	debugMode = false;
+	idxHelp = 0;
+	xferBulk.active = false;
+	xferBulk.data.clear();
+	sampling.active = false;
+	protoV2 = false;
+	seqTxV2 = 0;
+	framesV2.clear();
+	pushMode = false;
+}
+
+void targetSimByteProcess(uint8_t ch, uint32_t curTimeMs)
+{
+	if (!pFctSimSend)
+		return;
+
+	switch (stateRcv)
+	{
+	case SimRcvWait:
+
+		if (protoV2 && ch == cSofV2)
+		{
+			cmdRcv.assign(1, (char)ch);
+			stateRcv = SimRcvV2Hdr;
+			break;
+		}
+
+		if (ch == FlowTargetToSched)
+		{
+			dataRequested(curTimeMs);
+			break;
+		}
+
+		if (ch == FlowSchedToTarget)
+			stateRcv = SimRcvCmdId;
+
+		break;
+	case SimRcvCmdId:
+
+		cmdRcv.clear();
+
+		if (ch == IdContentScToTaBulk)
+		{
+			stateRcv = SimRcvBulkAck;
+			break;
+		}
+
+		stateRcv = ch == IdContentScToTaCmd ? SimRcvCmd : SimRcvWait;
+
+		break;
+	case SimRcvCmd:
+
+		if (!ch)
+		{
+			stateRcv = SimRcvEndWait;
+			break;
+		}
+
+		if (cmdRcv.size() < cLenCmdMax)
+			cmdRcv.push_back((char)ch);
+
+		break;
+	case SimRcvEndWait:
+
+		if (ch == IdContentEnd)
+			commandReceived(curTimeMs);
+
+		stateRcv = SimRcvWait;
+
+		break;
+	case SimRcvBulkAck:
+
+		if (ch == IdContentEnd)
+		{
+			bulkAckReceived();
+			stateRcv = SimRcvWait;
+			break;
+		}
+
+		if (cmdRcv.size() < cLenCmdMax)
+			cmdRcv.push_back((char)ch);
+
+		break;
+	case SimRcvV2Hdr:
+
+		cmdRcv.push_back((char)ch);
+
+		if (cmdRcv.size() < cLenFrameV2Hdr)
+			break;
+
+		if (!frameV2HdrDecode((const uint8_t *)cmdRcv.data(), hdrRcvV2))
+		{
+			stateRcv = SimRcvWait;
+			break;
+		}
+
+		cmdRcv.clear();
+		stateRcv = SimRcvV2Payload;
+
+		break;
+	case SimRcvV2Payload:
+
+		cmdRcv.push_back((char)ch);
+
+		if (cmdRcv.size() < hdrRcvV2.len + cLenFrameV2Crc)
+			break;
+
+		stateRcv = SimRcvWait;
+
+		if (!frameV2PayloadCheck(cmdRcv))
+			break;
+
+		cmdRcv.resize(hdrRcvV2.len);
+		frameV2Received(curTimeMs);
+
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Scenario file
+ *
+ * One setting per line: <key> <value>
+ * Lines starting with '#' are ignored.
+ * Unknown keys are reported to the caller.
+ *
+ * By default the simulator behaves like current firmware:
+ * SingleWire v1 and no gateway extensions. Scenarios opt in
+ * with 'proto-v2 1' and 'extensions 1'.
+ */
+bool targetSimConfigLoad(const string &nameFile, string &strErr)
+{
+	char line[256], key[64], val[128];
+	FILE *pFile;
+	uint32_t num;
+	int res;
+
+	pFile = fopen(nameFile.c_str(), "r");
+	if (!pFile)
+	{
+		strErr = "could not open scenario file";
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), pFile))
+	{
+		if (*line == '#')
+			continue;
+
+		res = sscanf(line, "%63s %127s", key, val);
+		if (res != 2)
+			continue;
+
+		num = (uint32_t)strtoul(val, NULL, 10);
+
+		if (!strcmp(key, "code"))
+			targetSimConf.codeInit = val;
+		else
+		if (!strcmp(key, "procs"))
+			targetSimConf.numProcs = num;
+		else
+		if (!strcmp(key, "log-rate"))
+			targetSimConf.rateLogPerSec = num;
+		else
+		if (!strcmp(key, "latency"))
+			targetSimConf.latencyCmdMs = num;
+		else
+		if (!strcmp(key, "cmds"))
+			targetSimConf.numCmds = num;
+		else
+		if (!strcmp(key, "period-proc"))
+			targetSimConf.periodProcMs = num;
+		else
+		if (!strcmp(key, "unsolicited"))
+			targetSimConf.ratioUnsolicitedPct = num;
+		else
+		if (!strcmp(key, "cut"))
+			targetSimConf.ratioCutPct = num;
+		else
+		if (!strcmp(key, "drop-permille"))
+			targetSimConf.ratioDropPermille = num;
+		else
+		if (!strcmp(key, "corrupt-permille"))
+			targetSimConf.ratioCorruptPermille = num;
+		else
+		if (!strcmp(key, "proto-v2"))
+			targetSimConf.protoV2 = num;
+		else
+		if (!strcmp(key, "extensions"))
+			targetSimConf.extensions = num;
+		else
+		if (!strcmp(key, "throughput"))
+			targetSimConf.throughputBps = num;
+		else
+		if (!strcmp(key, "jitter"))
+			targetSimConf.jitterMs = num;
+		else
+		{
+			strErr = key;
+			fclose(pFile);
+			return false;
+		}
+	}
+
+	fclose(pFile);
+
+	return true;
+}
+
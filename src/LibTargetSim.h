@@ -0,0 +1,70 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_TARGET_SIM_H
+#define LIB_TARGET_SIM_H
+
+#include <cinttypes>
+#include <string>
+
+/*
+ * Target simulator
+ *
+ * Implements the target side of SingleWire. Bytes sent by
+ * the scheduler are fed into targetSimByteProcess() and the
+ * answers are handed to the send function given on init.
+ * In push mode targetSimProcess() must be called regularly.
+ */
+
+struct TargetSimConfig
+{
+	std::string codeInit;
+	uint32_t numProcs;
+	uint32_t rateLogPerSec;
+	uint32_t latencyCmdMs;
+	uint32_t numCmds;
+	uint32_t periodProcMs;
+	uint32_t ratioUnsolicitedPct;
+	uint32_t ratioCutPct;
+	uint32_t ratioDropPermille;
+	uint32_t ratioCorruptPermille;
+	uint32_t protoV2;
+	uint32_t extensions;	// gateway extensions: push, tags, rates, bulk, sampling
+	uint32_t throughputBps;	// used by the emulator only
+	uint32_t jitterMs;		// used by the emulator only
+};
+
+typedef void (*FuncTargetSimSend)(const void *pData, size_t len);
+
+extern TargetSimConfig targetSimConf;
+
+void targetSimInit(FuncTargetSimSend pFctSend);
+void targetSimByteProcess(uint8_t ch, uint32_t curTimeMs);
+void targetSimProcess(uint32_t curTimeMs);
+void targetSimStatsGet(size_t &cntDropped, size_t &cntCorrupted);
+bool targetSimConfigLoad(const std::string &nameFile, std::string &strErr);
+
+#endif
+
@@ -0,0 +1,311 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+
+#include "LibTracing.h"
+#include "SystemDebugging.h"
+
+using namespace std;
+using namespace chrono;
+
+struct CmdTrace
+{
+	uint32_t idReq;
+	string cmd;
+	uint64_t tsNs[CmdTracePointCount];
+};
+
+atomic<uint32_t> cmdTraceSampleRate(0);
+string cmdTraceFile = "";
+
+static map<uint32_t, CmdTrace> tracesActive;
+static deque<CmdTrace> tracesDone;
+static uint32_t cntCmdsSeen = 0;
+static mutex mtxTraces;
+
+const size_t cNumTracesActiveMax = 64;
+const size_t cNumTracesDoneMax = 4096;
+const size_t cNumTracesDoneSearch = 16;
+
+static const char *namesSpan[CmdTracePointCount] =
+{
+	"",
+	"queue",
+	"uart+firmware",
+	"response",
+	"dequeue",
+	"reply",
+	"",
+};
+
+static void traceDone(const CmdTrace &trace)
+{
+	tracesDone.push_back(trace);
+
+	if (tracesDone.size() > cNumTracesDoneMax)
+		tracesDone.pop_front();
+}
+
+uint64_t cmdTraceNowNs()
+{
+	return (uint64_t)duration_cast<nanoseconds>(
+				steady_clock::now().time_since_epoch()).count();
+}
+
+void cmdTraceStart(uint32_t idReq, const string &cmd)
+{
+	// May be changed by traceSampleSet meanwhile
+	uint32_t rate = cmdTraceSampleRate;
+
+	if (!rate)
+		return;
+
+	Guard lock(mtxTraces);
+
+	if (cntCmdsSeen++ % rate)
+		return;
+
+	if (tracesActive.size() >= cNumTracesActiveMax)
+	{
+		// Unfinished traces are kept for inspection
+		traceDone(tracesActive.begin()->second);
+		tracesActive.erase(tracesActive.begin());
+	}
+
+	CmdTrace &trace = tracesActive[idReq];
+
+	trace.idReq = idReq;
+	trace.cmd = cmd;
+
+	for (size_t i = 0; i < CmdTracePointCount; ++i)
+		trace.tsNs[i] = 0;
+
+	trace.tsNs[CmdTraceQueued] = cmdTraceNowNs();
+}
+
+void cmdTraceMark(uint32_t idReq, CmdTracePoint point, uint64_t tsNs)
+{
+	if (!cmdTraceSampleRate)
+		return;
+
+	if (!tsNs)
+		tsNs = cmdTraceNowNs();
+
+	Guard lock(mtxTraces);
+
+	map<uint32_t, CmdTrace>::iterator iter;
+
+	iter = tracesActive.find(idReq);
+	if (iter != tracesActive.end())
+	{
+		if (!iter->second.tsNs[point])
+			iter->second.tsNs[point] = tsNs;
+
+		if (point != CmdTracePickup)
+			return;
+
+		traceDone(iter->second);
+		tracesActive.erase(iter);
+
+		return;
+	}
+
+	// Reply is sent after pickup
+	if (point != CmdTraceReplied)
+		return;
+
+	deque<CmdTrace>::reverse_iterator iterDone;
+	size_t i = 0;
+
+	iterDone = tracesDone.rbegin();
+	for (; iterDone != tracesDone.rend() && i < cNumTracesDoneSearch; ++iterDone, ++i)
+	{
+		if (iterDone->idReq != idReq)
+			continue;
+
+		iterDone->tsNs[point] = tsNs;
+		return;
+	}
+}
+
+void cmdTraceCancel(uint32_t idReq)
+{
+	if (!cmdTraceSampleRate)
+		return;
+
+	Guard lock(mtxTraces);
+
+	tracesActive.erase(idReq);
+}
+
+static void eventWrite(FILE *pFile, bool &first, const char *pName,
+						uint32_t idReq, uint64_t startNs, uint64_t endNs)
+{
+	fprintf(pFile, "%s\n{\"name\": \"%s\", \"cat\": \"cmd\", \"ph\": \"X\", "
+				"\"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+				first ? "" : ",",
+				pName, idReq,
+				(double)startNs / 1000, (double)(endNs - startNs) / 1000);
+
+	first = false;
+}
+
+static void jsonEscape(const string &str, string &strEsc)
+{
+	strEsc.clear();
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		char ch = str[i];
+
+		if (ch == '"' || ch == '\\')
+			strEsc.push_back('\\');
+
+		if ((uint8_t)ch < 0x20)
+			continue;
+
+		strEsc.push_back(ch);
+	}
+}
+
+/*
+ * Literature
+ * - https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+bool cmdTraceSave(const string &nameFile)
+{
+	FILE *pFile;
+
+	pFile = fopen(nameFile.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	Guard lock(mtxTraces);
+
+	deque<CmdTrace>::const_iterator iter;
+	const uint64_t *pTs;
+	bool first = true;
+	uint64_t startNs, endNs;
+	size_t idxPrev;
+	string strEsc;
+
+	fprintf(pFile, "{\"traceEvents\": [");
+
+	iter = tracesDone.begin();
+	for (; iter != tracesDone.end(); ++iter)
+	{
+		pTs = iter->tsNs;
+
+		startNs = pTs[CmdTraceRcvd] ? pTs[CmdTraceRcvd] : pTs[CmdTraceQueued];
+		endNs = startNs;
+
+		for (size_t i = 0; i < CmdTracePointCount; ++i)
+		{
+			if (pTs[i] > endNs)
+				endNs = pTs[i];
+		}
+
+		jsonEscape(iter->cmd, strEsc);
+		eventWrite(pFile, first, strEsc.c_str(), iter->idReq, startNs, endNs);
+
+		idxPrev = CmdTraceQueued;
+
+		for (size_t i = CmdTraceUartSent; i < CmdTracePointCount; ++i)
+		{
+			if (!pTs[i])
+				continue;
+
+			eventWrite(pFile, first, namesSpan[idxPrev], iter->idReq, pTs[idxPrev], pTs[i]);
+			idxPrev = i;
+		}
+	}
+
+	fprintf(pFile, "\n], \"displayTimeUnit\": \"ms\"}\n");
+
+	fclose(pFile);
+
+	return true;
+}
+
+static void cmdTraceSampleSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	uint32_t rate;
+
+	if (pArgs && *pArgs)
+		cmdTraceSampleRate = (uint32_t)strtoul(pArgs, NULL, 10);
+
+	rate = cmdTraceSampleRate;
+
+	if (!rate)
+	{
+		dInfo("Command tracing disabled");
+		return;
+	}
+
+	dInfo("Tracing every %u. command", rate);
+}
+
+static void cmdTraceFileSave(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	string nameFile = pArgs && *pArgs ? string(pArgs) : cmdTraceFile;
+
+	if (!nameFile.size())
+	{
+		dInfo("No file given");
+		return;
+	}
+
+	if (!cmdTraceSave(nameFile))
+	{
+		dInfo("Could not write to %s", nameFile.c_str());
+		return;
+	}
+
+	dInfo("Traces written to %s", nameFile.c_str());
+}
+
+static void cmdTraceClear(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+
+	Guard lock(mtxTraces);
+
+	tracesActive.clear();
+	tracesDone.clear();
+
+	dInfo("Command traces cleared");
+}
+
+void cmdTraceCommandsRegister()
+{
+	cmdReg("traceSampleSet", cmdTraceSampleSet, "", "Trace every Nth command. 0: Off",  "Tracing");
+	cmdReg("traceSave",      cmdTraceFileSave,  "", "Save traces in Chrome trace format", "Tracing");
+	cmdReg("traceClear",     cmdTraceClear,     "", "Clear command traces",             "Tracing");
+}
+
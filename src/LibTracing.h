@@ -0,0 +1,65 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_TRACING_H
+#define LIB_TRACING_H
+
+#include <cinttypes>
+#include <string>
+#include <atomic>
+
+/*
+ * Command tracing
+ *
+ * Follows a command from TCP receipt to the TCP reply.
+ * The trace ID is the request ID of the scheduler.
+ * Sampled commands are exported in the Chrome trace event
+ * format and can be viewed with chrome://tracing or Perfetto.
+ */
+
+enum CmdTracePoint
+{
+	CmdTraceRcvd = 0,
+	CmdTraceQueued,
+	CmdTraceUartSent,
+	CmdTraceRespFirst,
+	CmdTraceRespEnd,
+	CmdTracePickup,
+	CmdTraceReplied,
+	CmdTracePointCount,
+};
+
+extern std::atomic<uint32_t> cmdTraceSampleRate; // 0: off, N: every Nth command
+extern std::string cmdTraceFile;
+
+uint64_t cmdTraceNowNs();
+void cmdTraceStart(uint32_t idReq, const std::string &cmd);
+void cmdTraceMark(uint32_t idReq, CmdTracePoint point, uint64_t tsNs = 0);
+void cmdTraceCancel(uint32_t idReq);
+bool cmdTraceSave(const std::string &nameFile);
+void cmdTraceCommandsRegister();
+
+#endif
+
@@ -31,17 +31,85 @@
 #include <termios.h>
 #endif
 
+#include <chrono>
+#include <vector>
+
 #include "LibUart.h"
+#include "LibCapture.h"
+#include "LibTargetSim.h"
+#include "LibTime.h"
 
 using namespace std;
+using namespace chrono;
 
-uint8_t uartVirtualMode = 0; // swart
+uint8_t uartVirtualMode = UartVirtModeSwart;
 uint8_t uartVirtual = 0;
 uint8_t uartVirtualMounted = 0;
 
-static uint8_t bufVirtual[31];
-static size_t lenWritten = 0;
-static uint8_t *pBufVirt = bufVirtual;
+const size_t cSizeBufVirtualDefault = 64 * 1024;
+
+static vector<uint8_t> bufVirtual(cSizeBufVirtualDefault);
+static size_t idxVirtWrite = 0;
+static size_t idxVirtRead = 0;
+static size_t cntVirtDropped = 0;
+
+// replay
+static FILE *pFileReplay = NULL;
+static bool replayRecorded = false;
+static bool replayRealtime = false;
+static bool replayDone = false;
+static size_t lenRecordReplay = 0;
+static uint64_t tsRecordReplayNs = 0;
+static uint64_t tsFirstReplayNs = 0;
+static bool tsFirstReplayValid = false;
+static size_t cntBytesReplay = 0;
+static steady_clock::time_point startReplay;
+
+// Ring buffer of the virtual UART. Bytes that don't fit are dropped
+static size_t virtWrite(const void *pData, size_t len)
+{
+	const uint8_t *pSrc = (const uint8_t *)pData;
+	size_t sizeBuf = bufVirtual.size();
+	size_t lenFree = sizeBuf - (idxVirtWrite - idxVirtRead);
+	size_t lenPlanned = PMIN(len, lenFree);
+	size_t offs, lenFirst;
+
+	cntVirtDropped += len - lenPlanned;
+
+	if (!lenPlanned)
+		return 0;
+
+	offs = idxVirtWrite % sizeBuf;
+	lenFirst = PMIN(lenPlanned, sizeBuf - offs);
+
+	memcpy(&bufVirtual[offs], pSrc, lenFirst);
+	memcpy(&bufVirtual[0], pSrc + lenFirst, lenPlanned - lenFirst);
+
+	idxVirtWrite += lenPlanned;
+
+	return lenPlanned;
+}
+
+static size_t virtRead(void *pData, size_t len)
+{
+	uint8_t *pDst = (uint8_t *)pData;
+	size_t sizeBuf = bufVirtual.size();
+	size_t lenPlanned = PMIN(len, idxVirtWrite - idxVirtRead);
+	size_t offs, lenFirst;
+
+	if (!lenPlanned)
+		return 0;
+
+	offs = idxVirtRead % sizeBuf;
+	lenFirst = PMIN(lenPlanned, sizeBuf - offs);
+
+	memcpy(pDst, &bufVirtual[offs], lenFirst);
+	memcpy(pDst + lenFirst, &bufVirtual[0], lenPlanned - lenFirst);
+
+	idxVirtRead += lenPlanned;
+
+	return lenPlanned;
+}
 
 /*
  * Literature
@@ -243,23 +311,27 @@ ssize_t uartSend(RefDeviceUart refUart, const void *pBuf, size_t lenReq)
 		if (!uartVirtualMounted)
 			return -1;
 
-		size_t lenPlanned = PMIN(lenReq, sizeof(bufVirtual));
-		*bufVirtual = 0;
+		if (uartVirtualMode == UartVirtModeSim)
+		{
+			const uint8_t *pData = (const uint8_t *)pBuf;
+			uint32_t curTimeMs = millis();
 
-		if (uartVirtualMode) // mode = uart: TX not connected to RX
-			return (ssize_t)lenPlanned;
+			for (size_t i = 0; i < lenReq; ++i)
+				targetSimByteProcess(pData[i], curTimeMs);
 
-		lenWritten = lenPlanned;
-		pBufVirt = bufVirtual;
+			return (ssize_t)lenReq;
+		}
 
-		memcpy(pBufVirt, pBuf, lenWritten);
+		if (uartVirtualMode != UartVirtModeSwart) // TX not connected to RX
+			return (ssize_t)lenReq;
 
-		return (ssize_t)lenWritten;
+		return (ssize_t)virtWrite(pBuf, lenReq);
 	}
 
 	if (refUart == RefDeviceUartInvalid)
 		return -1;
 
+	size_t lenWritten;
 #if defined(_WIN32)
 	DWORD lenWrittenWin;
 	BOOL ok;
@@ -283,6 +355,9 @@ ssize_t uartSend(RefDeviceUart refUart, const void *pBuf, size_t lenReq)
 
 	lenWritten = (size_t)lenDone;
 #endif
+	if (captureEnabled && lenWritten)
+		captureRecord(CaptureDirTx, pBuf, lenWritten);
+
 	return (ssize_t)lenWritten;
 }
 
@@ -291,6 +366,110 @@ ssize_t uartSend(RefDeviceUart refUart, uint8_t ch)
 	return uartSend(refUart, &ch, sizeof(ch));
 }
 
+static uint64_t leToU64(const uint8_t *pData, size_t len)
+{
+	uint64_t val = 0;
+
+	for (size_t i = len; i > 0; --i)
+		val = (val << 8) | pData[i - 1];
+
+	return val;
+}
+
+static void uartReplayFinish()
+{
+	uint32_t durationMs;
+
+	if (replayDone)
+		return;
+	replayDone = true;
+
+	durationMs = (uint32_t)duration_cast<milliseconds>(steady_clock::now() - startReplay).count();
+
+	fprintf(stdout, "\nReplay finished: %zu bytes in %u ms", cntBytesReplay, durationMs);
+	if (durationMs)
+		fprintf(stdout, " (%zu kB/s)", cntBytesReplay / durationMs);
+	fprintf(stdout, "\n");
+}
+
+static bool uartReplayRecordNext()
+{
+	uint8_t hdr[cLenCaptureRecordHdr];
+	size_t lenDone;
+
+	while (1)
+	{
+		lenDone = fread(hdr, 1, sizeof(hdr), pFileReplay);
+		if (lenDone != sizeof(hdr))
+			return false;
+
+		tsRecordReplayNs = leToU64(hdr, 8);
+		lenRecordReplay = (uint32_t)leToU64(hdr + 9, 4);
+
+		if (!tsFirstReplayValid)
+		{
+			tsFirstReplayNs = tsRecordReplayNs;
+			tsFirstReplayValid = true;
+		}
+
+		if (hdr[8] == CaptureDirRx)
+			return true;
+
+		// skip TX
+		if (fseek(pFileReplay, (long)lenRecordReplay, SEEK_CUR))
+			return false;
+
+		lenRecordReplay = 0;
+	}
+}
+
+static ssize_t uartReplayRead(void *pBuf, size_t lenReq)
+{
+	size_t lenPlanned, lenDone;
+
+	if (!pFileReplay || replayDone)
+		return 0;
+
+	if (!replayRecorded)
+	{
+		lenDone = fread(pBuf, 1, lenReq, pFileReplay);
+		cntBytesReplay += lenDone;
+
+		if (!lenDone)
+			uartReplayFinish();
+
+		return (ssize_t)lenDone;
+	}
+
+	if (!lenRecordReplay && !uartReplayRecordNext())
+	{
+		uartReplayFinish();
+		return 0;
+	}
+
+	if (replayRealtime)
+	{
+		uint64_t elapsedNs = (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - startReplay).count();
+
+		if (elapsedNs < tsRecordReplayNs - tsFirstReplayNs)
+			return 0;
+	}
+
+	lenPlanned = PMIN(lenReq, lenRecordReplay);
+
+	lenDone = fread(pBuf, 1, lenPlanned, pFileReplay);
+	if (lenDone != lenPlanned)
+	{
+		uartReplayFinish();
+		return 0;
+	}
+
+	lenRecordReplay -= lenDone;
+	cntBytesReplay += lenDone;
+
+	return (ssize_t)lenDone;
+}
+
 /*
  * Literature
  *
@@ -310,18 +489,13 @@ ssize_t uartRead(RefDeviceUart refUart, void *pBuf, size_t lenReq)
 		if (!uartVirtualMounted)
 			return -1;
 
-		size_t lenReadVirt;
-
-		lenReadVirt = PMIN(lenReq, lenWritten);
-		if (!lenReadVirt)
-			return 0;
-
-		memcpy(pBuf, pBufVirt, lenReadVirt);
+		if (uartVirtualMode == UartVirtModeReplay)
+			return uartReplayRead(pBuf, lenReq);
 
-		lenWritten -= lenReadVirt;
-		pBufVirt += lenReadVirt;
+		if (uartVirtualMode == UartVirtModeSim)
+			targetSimProcess(millis());
 
-		return (ssize_t)lenReadVirt;
+		return (ssize_t)virtRead(pBuf, lenReq);
 	}
 
 	if (refUart == RefDeviceUartInvalid)
@@ -364,6 +538,9 @@ ssize_t uartRead(RefDeviceUart refUart, void *pBuf, size_t lenReq)
 	if (!lenRead)
 		return -2;
 #endif
+	if (captureEnabled && lenRead > 0)
+		captureRecord(CaptureDirRx, pBuf, (size_t)lenRead);
+
 	return lenRead;
 }
 
@@ -374,11 +551,71 @@ ssize_t uartVirtRcv(RefDeviceUart refUart, const void *pBuf, size_t lenReq)
 	if (!uartVirtual)
 		return -1;
 
-	lenWritten = PMIN(lenReq, sizeof(bufVirtual));
-	pBufVirt = bufVirtual;
+	return (ssize_t)virtWrite(pBuf, lenReq);
+}
+
+bool uartVirtSizeSet(size_t sizeBuf)
+{
+	if (!sizeBuf)
+		return false;
 
-	memcpy(pBufVirt, pBuf, lenWritten);
+	bufVirtual.assign(sizeBuf, 0);
+	idxVirtWrite = 0;
+	idxVirtRead = 0;
 
-	return (ssize_t)lenWritten;
+	return true;
+}
+
+size_t uartVirtDropped()
+{
+	return cntVirtDropped;
+}
+
+static void simSend(const void *pData, size_t len)
+{
+	virtWrite(pData, len);
+}
+
+void uartSimStart()
+{
+	targetSimInit(simSend);
+
+	uartVirtualMode = UartVirtModeSim;
+	uartVirtualMounted = 1;
+	uartVirtual = 1;
+}
+
+bool uartReplayOpen(const string &nameFile, bool realtime)
+{
+	char magic[cLenCaptureMagic];
+	size_t lenDone;
+
+	pFileReplay = fopen(nameFile.c_str(), "rb");
+	if (!pFileReplay)
+		return false;
+
+	lenDone = fread(magic, 1, sizeof(magic), pFileReplay);
+
+	replayRecorded = lenDone == sizeof(magic) &&
+				!memcmp(magic, cCaptureMagic, sizeof(magic));
+
+	if (!replayRecorded)
+		rewind(pFileReplay);
+
+	replayRealtime = realtime && replayRecorded;
+	replayDone = false;
+	cntBytesReplay = 0;
+	startReplay = steady_clock::now();
+
+	uartVirtualMode = UartVirtModeReplay;
+	uartVirtualMounted = 1;
+	uartVirtual = 1;
+
+	return true;
+}
+
+bool uartReplayDone()
+{
+	return replayDone;
 }
 
@@ -43,6 +43,32 @@ typedef int RefDeviceUart;
 #define RefDeviceUartInvalid -1
 #endif
 
+enum UartVirtualMode
+{
+	UartVirtModeSwart = 0,	// TX connected to RX
+	UartVirtModeUart,		// TX not connected to RX
+	UartVirtModeReplay,	// RX fed from file, TX discarded
+	UartVirtModeSim,		// TX and RX connected to target simulator
+};
+
+/*
+ * Capture file format (little endian)
+ *
+ * Header  cCaptureMagic
+ * Record  uint64 timestamp [ns], uint8 direction, uint32 length, data
+ *
+ * Files without header are replayed as raw RX byte stream.
+ */
+const char cCaptureMagic[] = "CodeOrbCap1\n";
+const size_t cLenCaptureMagic = sizeof(cCaptureMagic) - 1;
+const size_t cLenCaptureRecordHdr = 13;
+
+enum CaptureDirection
+{
+	CaptureDirRx = 0,
+	CaptureDirTx,
+};
+
 extern uint8_t uartVirtualMode;
 extern uint8_t uartVirtual;
 extern uint8_t uartVirtualMounted;
@@ -55,5 +81,12 @@ ssize_t uartSend(RefDeviceUart refUart, uint8_t ch);
 ssize_t uartRead(RefDeviceUart refUart, void *pBuf, size_t lenReq);
 ssize_t uartVirtRcv(RefDeviceUart refUart, const void *pBuf, size_t lenReq);
 
+bool uartVirtSizeSet(size_t sizeBuf);
+size_t uartVirtDropped();
+void uartSimStart();
+
+bool uartReplayOpen(const std::string &nameFile, bool realtime);
+bool uartReplayDone();
+
 #endif
 
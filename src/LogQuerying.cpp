@@ -0,0 +1,690 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+
+#include "LogQuerying.h"
+#include "LibTime.h"
+
+#include "env.h"
+
+#define dForEach_ProcState(gen) \
+		gen(StStart) \
+		gen(StQueryWait) \
+		gen(StSegmentNext) \
+		gen(StBlocksSend) \
+		gen(StTailWait) \
+		gen(StSegmentsWait) \
+
+#define dGenProcStateEnum(s) s,
+dProcessStateEnum(ProcState);
+
+#if 1
+#define dGenProcStateString(s) #s,
+dProcessStateStr(ProcState);
+#endif
+
+using namespace std;
+
+const size_t cSizeBufInMax = 1024;
+const size_t cNumRecordsSkipPerTick = 256;
+const uint32_t cIntervalTailMs = 500;
+
+/*
+ * Query port
+ *
+ * One query per line. Times are ms since epoch or, with
+ * a leading '-', seconds before now.
+ *
+ *   range <from> <to>       Entries in the time range
+ *   tail <from>             Entries since <from>, then new ones
+ *   search <from> <terms>   Entries since <from> containing all terms
+ *
+ * The end of a finite query is marked with '<done: N entries>'.
+ */
+LogQuerying::LogQuerying(SOCKET fd)
+	: Processing("LogQuerying")
+	, mStartMs(0)
+	, mFdSocket(fd)
+	, mpTrans(NULL)
+	, mBufIn("")
+	, mBufOut("")
+	// query
+	, mFromMs(0)
+	, mToMs(0)
+	, mTail(false)
+	, mTerms()
+	// cursor
+	, mSegments()
+	, mIdxSeg(0)
+	, mRecords()
+	, mIdxRec(0)
+	, mSizeTermsRead(0)
+	, mCntTermsMatched()
+	// statistics
+	, mCntEntriesSent(0)
+	, mCntBlocksRead(0)
+{
+	mState = StStart;
+}
+
+/* member functions */
+
+Success LogQuerying::process()
+{
+	uint32_t curTimeMs = millis();
+	uint32_t diffMs = curTimeMs - mStartMs;
+	Success success;
+	vector<string>::iterator iter;
+	string line, strErr, nameSeg;
+	bool ok;
+#if 0
+	dStateTrace;
+#endif
+	if (mpTrans && mpTrans->success() != Pending)
+		return Positive;
+
+	switch (mState)
+	{
+	case StStart:
+
+		mpTrans = TcpTransfering::create(mFdSocket);
+		if (!mpTrans)
+			return procErrLog(-1, "could not create process");
+
+		mpTrans->procTreeDisplaySet(false);
+		start(mpTrans);
+
+		mState = StQueryWait;
+
+		break;
+	case StQueryWait:
+
+		ok = lineRead(line);
+		if (!ok)
+			break;
+
+		ok = queryParse(line, strErr);
+		if (!ok)
+		{
+			msgSend("<" + strErr + ">\r\n");
+			break;
+		}
+
+		logStoreSegmentsList(env.dirLogStore, mSegments);
+
+		mCntEntriesSent = 0;
+		mIdxSeg = 0;
+
+		mState = StSegmentNext;
+
+		break;
+	case StSegmentNext:
+
+		// Store still empty. Tail waits for the first segment
+		if (mTail && !mSegments.size())
+		{
+			mStartMs = curTimeMs;
+			mState = StSegmentsWait;
+			break;
+		}
+
+		if (mIdxSeg >= mSegments.size())
+		{
+			msgSend("<done: " + to_string(mCntEntriesSent) + " entries>\r\n");
+			mState = StQueryWait;
+			break;
+		}
+
+		ok = segmentLoad();
+		if (!ok)
+		{
+			++mIdxSeg;
+			break;
+		}
+
+		mState = StBlocksSend;
+
+		break;
+	case StBlocksSend:
+
+		success = outputFlush();
+		if (success == Pending)
+			break;
+
+		if (success != Positive)
+			return procErrLog(-1, "could not send result");
+
+		// New query interrupts the current one
+		if (lineRead(line))
+		{
+			mBufIn = line + "\n" + mBufIn;
+			mState = StQueryWait;
+			break;
+		}
+
+		for (size_t i = 0; i < cNumRecordsSkipPerTick; ++i)
+		{
+			if (mIdxRec >= mRecords.size())
+				break;
+
+			const LogStoreIdxRecord &rec = mRecords[mIdxRec];
+
+			++mIdxRec;
+
+			if (!recordSelected(rec))
+				continue;
+
+			ok = blockSend(rec);
+			if (!ok)
+				procWrnLog("could not read block");
+
+			break;
+		}
+
+		if (mIdxRec < mRecords.size())
+			break;
+
+		if (mRecords.size() && mRecords.back().tsFirstMs > mToMs)
+		{
+			mIdxSeg = mSegments.size();
+			mState = StSegmentNext;
+			break;
+		}
+
+		if (mTail && mIdxSeg + 1 >= mSegments.size())
+		{
+			mStartMs = curTimeMs;
+			mState = StTailWait;
+			break;
+		}
+
+		++mIdxSeg;
+		mState = StSegmentNext;
+
+		break;
+	case StTailWait:
+
+		if (lineRead(line))
+		{
+			mBufIn = line + "\n" + mBufIn;
+			mState = StQueryWait;
+			break;
+		}
+
+		if (diffMs < cIntervalTailMs)
+			break;
+		mStartMs = curTimeMs;
+
+		// Current segment grown?
+		recordsLoad();
+		termsLoad();
+
+		if (mIdxRec < mRecords.size())
+		{
+			mState = StBlocksSend;
+			break;
+		}
+
+		nameSeg = mSegments[mIdxSeg];
+		logStoreSegmentsList(env.dirLogStore, mSegments);
+
+		// Retention may have removed older segments
+		iter = find(mSegments.begin(), mSegments.end(), nameSeg);
+		if (iter == mSegments.end())
+		{
+			mIdxSeg = 0;
+			mState = StSegmentNext;
+			break;
+		}
+
+		mIdxSeg = iter - mSegments.begin();
+
+		if (mIdxSeg + 1 >= mSegments.size())
+			break;
+
+		++mIdxSeg;
+		mState = StSegmentNext;
+
+		break;
+	case StSegmentsWait:
+
+		if (lineRead(line))
+		{
+			mBufIn = line + "\n" + mBufIn;
+			mState = StQueryWait;
+			break;
+		}
+
+		if (diffMs < cIntervalTailMs)
+			break;
+		mStartMs = curTimeMs;
+
+		logStoreSegmentsList(env.dirLogStore, mSegments);
+		if (!mSegments.size())
+			break;
+
+		mIdxSeg = 0;
+		mState = StSegmentNext;
+
+		break;
+	default:
+		break;
+	}
+
+	return Pending;
+}
+
+bool LogQuerying::lineRead(string &line)
+{
+	char buf[256];
+	ssize_t lenDone;
+	size_t idxEnd;
+
+	lenDone = mpTrans->read(buf, sizeof(buf));
+	if (lenDone > 0)
+		mBufIn.append(buf, (size_t)lenDone);
+
+	if (mBufIn.size() > cSizeBufInMax)
+		mBufIn.clear();
+
+	idxEnd = mBufIn.find('\n');
+	if (idxEnd == string::npos)
+		return false;
+
+	line = mBufIn.substr(0, idxEnd);
+	mBufIn.erase(0, idxEnd + 1);
+
+	if (line.size() && line.back() == '\r')
+		line.pop_back();
+
+	return line.size() > 0;
+}
+
+bool LogQuerying::queryParse(const string &line, string &strErr)
+{
+	vector<string> parts;
+	size_t idxStart = 0, idxEnd;
+	string type;
+	bool ok;
+
+	while (idxStart < line.size())
+	{
+		idxEnd = line.find(' ', idxStart);
+		if (idxEnd == string::npos)
+			idxEnd = line.size();
+
+		if (idxEnd > idxStart)
+			parts.push_back(line.substr(idxStart, idxEnd - idxStart));
+
+		idxStart = idxEnd + 1;
+	}
+
+	if (!parts.size())
+	{
+		strErr = "empty query";
+		return false;
+	}
+
+	type = parts[0];
+
+	mToMs = UINT64_MAX;
+	mTail = false;
+	mTerms.clear();
+
+	if (type == "range" && parts.size() == 3)
+	{
+		mFromMs = timeParse(parts[1], ok);
+		if (ok)
+			mToMs = timeParse(parts[2], ok);
+	}
+	else
+	if (type == "tail" && parts.size() == 2)
+	{
+		mFromMs = timeParse(parts[1], ok);
+		mTail = true;
+	}
+	else
+	if (type == "search" && parts.size() >= 3)
+	{
+		unordered_set<string> terms;
+
+		mFromMs = timeParse(parts[1], ok);
+
+		for (size_t i = 2; i < parts.size(); ++i)
+			logStoreTermsExtract(parts[i], terms);
+
+		mTerms.assign(terms.begin(), terms.end());
+
+		if (ok && !mTerms.size())
+		{
+			strErr = "no searchable term. Minimum length is 3";
+			return false;
+		}
+	}
+	else
+	{
+		strErr = "usage: range <from> <to> | tail <from> | search <from> <terms>";
+		return false;
+	}
+
+	if (!ok)
+	{
+		strErr = "invalid time";
+		return false;
+	}
+
+	return true;
+}
+
+bool LogQuerying::segmentLoad()
+{
+	uint64_t startNextMs;
+	const string &nameBase = mSegments[mIdxSeg];
+
+	// Segment ends where the next one starts
+	if (mIdxSeg + 1 < mSegments.size())
+	{
+		const string &nameNext = mSegments[mIdxSeg + 1];
+
+		startNextMs = strtoull(nameNext.c_str() + nameNext.size() - 13, NULL, 10);
+		if (startNextMs < mFromMs)
+			return false;
+	}
+
+	if (strtoull(nameBase.c_str() + nameBase.size() - 13, NULL, 10) > mToMs)
+		return false;
+
+	mRecords.clear();
+	mIdxRec = 0;
+	mSizeTermsRead = 0;
+	mCntTermsMatched.clear();
+
+	if (!recordsLoad())
+		return false;
+
+	termsLoad();
+
+	return true;
+}
+
+// Only the index is read completely. It is small
+bool LogQuerying::recordsLoad()
+{
+	uint8_t buf[cLenLogStoreIdxRecord];
+	LogStoreIdxRecord rec;
+	FILE *pFile;
+	long offset;
+
+	pFile = fopen((mSegments[mIdxSeg] + ".idx").c_str(), "rb");
+	if (!pFile)
+		return false;
+
+	offset = (long)(mRecords.size() * cLenLogStoreIdxRecord);
+	fseek(pFile, offset, SEEK_SET);
+
+	while (fread(buf, 1, sizeof(buf), pFile) == sizeof(buf))
+	{
+		logStoreIdxRecordRead(buf, rec);
+		mRecords.push_back(rec);
+	}
+
+	fclose(pFile);
+
+	return true;
+}
+
+/*
+ * Inverted index of the segment: For every block the number
+ * of query terms it contains. Only blocks containing all terms
+ * are read. New term records are read incrementally.
+ */
+void LogQuerying::termsLoad()
+{
+	unordered_set<string> termsQuery(mTerms.begin(), mTerms.end());
+	uint8_t bufHdr[12];
+	uint8_t lenTerm;
+	char bufTerm[256];
+	uint64_t offsetBlock;
+	uint32_t cntTerms;
+	size_t cntMatched;
+	FILE *pFile;
+	bool ok;
+
+	if (!mTerms.size())
+		return;
+
+	pFile = fopen((mSegments[mIdxSeg] + ".trm").c_str(), "rb");
+	if (!pFile)
+		return;
+
+	fseek(pFile, (long)mSizeTermsRead, SEEK_SET);
+
+	while (fread(bufHdr, 1, sizeof(bufHdr), pFile) == sizeof(bufHdr))
+	{
+		offsetBlock = 0;
+		for (size_t i = 0; i < 8; ++i)
+			offsetBlock |= (uint64_t)bufHdr[i] << (8 * i);
+
+		cntTerms = 0;
+		for (size_t i = 0; i < 4; ++i)
+			cntTerms |= (uint32_t)bufHdr[8 + i] << (8 * i);
+
+		cntMatched = 0;
+		ok = true;
+
+		for (uint32_t i = 0; i < cntTerms && ok; ++i)
+		{
+			ok = fread(&lenTerm, 1, 1, pFile) == 1;
+			ok = ok && fread(bufTerm, 1, lenTerm, pFile) == lenTerm;
+
+			if (ok && termsQuery.count(string(bufTerm, lenTerm)))
+				++cntMatched;
+		}
+
+		// Incomplete record: Writer not done yet
+		if (!ok)
+			break;
+
+		mSizeTermsRead = (size_t)ftell(pFile);
+		mCntTermsMatched[offsetBlock] = cntMatched;
+	}
+
+	fclose(pFile);
+}
+
+bool LogQuerying::recordSelected(const LogStoreIdxRecord &rec)
+{
+	unordered_map<uint64_t, size_t>::const_iterator iter;
+
+	if (rec.tsLastMs < mFromMs || rec.tsFirstMs > mToMs)
+		return false;
+
+	if (!mTerms.size())
+		return true;
+
+	iter = mCntTermsMatched.find(rec.offset);
+	if (iter == mCntTermsMatched.end())
+		return false;
+
+	return iter->second == mTerms.size();
+}
+
+// Only one block is held in memory at a time
+bool LogQuerying::blockSend(const LogStoreIdxRecord &rec)
+{
+	uint8_t bufHdr[cLenLogStoreBlockHdr];
+	vector<uint8_t> bufStored, bufRaw;
+	vector<LogStoreEntry> entries;
+	LogStoreBlockHdr hdr;
+	FILE *pFile;
+	bool ok;
+
+	pFile = fopen((mSegments[mIdxSeg] + ".dat").c_str(), "rb");
+	if (!pFile)
+		return false;
+
+	ok = !fseek(pFile, (long)rec.offset, SEEK_SET);
+	ok = ok && fread(bufHdr, 1, sizeof(bufHdr), pFile) == sizeof(bufHdr);
+	ok = ok && logStoreBlockHdrRead(bufHdr, hdr);
+
+	if (ok)
+	{
+		bufStored.resize(hdr.lenStored);
+		ok = fread(bufStored.data(), 1, hdr.lenStored, pFile) == hdr.lenStored;
+	}
+
+	fclose(pFile);
+
+	if (!ok)
+		return false;
+
+	++mCntBlocksRead;
+
+	if (hdr.method == LogStoreMethodLz)
+		ok = blockDecompress(bufStored.data(), bufStored.size(), hdr.lenRaw, bufRaw);
+	else
+		bufRaw.swap(bufStored);
+
+	ok = ok && logStoreEntriesDecode(bufRaw, entries);
+	if (!ok)
+		return false;
+
+	vector<LogStoreEntry>::const_iterator iter;
+	unordered_set<string> termsEntry;
+	char bufTime[32];
+	time_t t;
+	struct tm tmLocal;
+
+	iter = entries.begin();
+	for (; iter != entries.end(); ++iter)
+	{
+		if (iter->tsMs < mFromMs || iter->tsMs > mToMs)
+			continue;
+
+		// Whole words like the term index
+		if (mTerms.size())
+		{
+			termsEntry.clear();
+			logStoreTermsExtract(iter->str, termsEntry);
+
+			size_t i = 0;
+			for (; i < mTerms.size(); ++i)
+			{
+				if (!termsEntry.count(mTerms[i]))
+					break;
+			}
+
+			if (i < mTerms.size())
+				continue;
+		}
+
+		t = (time_t)(iter->tsMs / 1000);
+#if defined(_WIN32)
+		localtime_s(&tmLocal, &t);
+#else
+		localtime_r(&t, &tmLocal);
+#endif
+		strftime(bufTime, sizeof(bufTime), "%Y-%m-%d  %H:%M:%S", &tmLocal);
+
+		mBufOut += bufTime;
+		mBufOut += "." + to_string(1000 + iter->tsMs % 1000).substr(1);
+		mBufOut += "   ";
+		mBufOut += iter->str;
+		mBufOut += "\r\n";
+
+		++mCntEntriesSent;
+	}
+
+	return true;
+}
+
+Success LogQuerying::outputFlush()
+{
+	ssize_t lenDone;
+
+	if (!mBufOut.size())
+		return Positive;
+
+	if (!mpTrans->mSendReady)
+		return Pending;
+
+	lenDone = mpTrans->send(mBufOut.data(), mBufOut.size());
+	if (lenDone < 0)
+		return -1;
+
+	mBufOut.erase(0, (size_t)lenDone);
+
+	return mBufOut.size() ? Pending : Positive;
+}
+
+void LogQuerying::msgSend(const string &msg)
+{
+	mBufOut += msg;
+	outputFlush();
+}
+
+void LogQuerying::processInfo(char *pBuf, char *pBufEnd)
+{
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("Segment\t\t\t%zu / %zu\n", mIdxSeg, mSegments.size());
+	dInfo("Block\t\t\t%zu / %zu\n", mIdxRec, mRecords.size());
+	dInfo("Blocks read\t\t%zu\n", mCntBlocksRead);
+	dInfo("Entries sent\t\t%zu\n", mCntEntriesSent);
+}
+
+/* static functions */
+
+uint64_t LogQuerying::timeParse(const string &str, bool &ok)
+{
+	char *pEnd = NULL;
+	uint64_t val;
+
+	ok = false;
+
+	if (!str.size())
+		return 0;
+
+	if (str[0] == '-')
+	{
+		val = strtoull(str.c_str() + 1, &pEnd, 10);
+		ok = !*pEnd;
+
+		uint64_t nowMs = logStoreNowMs();
+		val *= 1000;
+
+		return val < nowMs ? nowMs - val : 0;
+	}
+
+	val = strtoull(str.c_str(), &pEnd, 10);
+	ok = !*pEnd;
+
+	return val;
+}
+
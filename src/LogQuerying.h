@@ -0,0 +1,112 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOG_QUERYING_H
+#define LOG_QUERYING_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Processing.h"
+#include "TcpTransfering.h"
+#include "LibLogStore.h"
+
+class LogQuerying : public Processing
+{
+
+public:
+
+	static LogQuerying *create(SOCKET fd)
+	{
+		return new dNoThrow LogQuerying(fd);
+	}
+
+protected:
+
+	LogQuerying(SOCKET fd);
+	virtual ~LogQuerying() {}
+
+private:
+
+	LogQuerying() = delete;
+	LogQuerying(const LogQuerying &) = delete;
+	LogQuerying &operator=(const LogQuerying &) = delete;
+
+	/*
+	 * Naming of functions:  objectVerb()
+	 * Example:              peerAdd()
+	 */
+
+	/* member functions */
+	Success process();
+	void processInfo(char *pBuf, char *pBufEnd);
+
+	bool lineRead(std::string &line);
+	bool queryParse(const std::string &line, std::string &strErr);
+	bool segmentLoad();
+	bool recordsLoad();
+	void termsLoad();
+	bool recordSelected(const LogStoreIdxRecord &rec);
+	bool blockSend(const LogStoreIdxRecord &rec);
+	Success outputFlush();
+	void msgSend(const std::string &msg);
+
+	/* member variables */
+	uint32_t mStartMs;
+	SOCKET mFdSocket;
+	TcpTransfering *mpTrans;
+	std::string mBufIn;
+	std::string mBufOut;
+
+	// query
+	uint64_t mFromMs;
+	uint64_t mToMs;
+	bool mTail;
+	std::vector<std::string> mTerms;
+
+	// cursor
+	std::vector<std::string> mSegments;
+	size_t mIdxSeg;
+	std::vector<LogStoreIdxRecord> mRecords;
+	size_t mIdxRec;
+	size_t mSizeTermsRead;
+	std::unordered_map<uint64_t, size_t> mCntTermsMatched;
+
+	// statistics
+	size_t mCntEntriesSent;
+	size_t mCntBlocksRead;
+
+	/* static functions */
+	static uint64_t timeParse(const std::string &str, bool &ok);
+
+	/* static variables */
+
+	/* constants */
+
+};
+
+#endif
+
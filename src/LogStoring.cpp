@@ -0,0 +1,441 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "LogStoring.h"
+#include "LibTime.h"
+
+#define dForEach_ProcState(gen) \
+		gen(StStart) \
+		gen(StMain) \
+
+#define dGenProcStateEnum(s) s,
+dProcessStateEnum(ProcState);
+
+#if 1
+#define dGenProcStateString(s) #s,
+dProcessStateStr(ProcState);
+#endif
+
+using namespace std;
+
+const size_t cSizeBlockRawMax = 64 * 1024;
+const uint32_t cIntervalBlockMs = 1000;
+const uint32_t cIntervalSyncMs = 1000;
+
+LogStoring::LogStoring()
+	: Processing("LogStoring")
+	, mStartMs(0)
+	, mLastSyncMs(0)
+	, mDir("")
+	, mFsync(LogStoreFsyncInterval)
+	, mSizeSegmentMax(64 * 1024 * 1024)
+	, mAgeSegmentMaxSec(3600)
+	, mSizeStoreMax((uint64_t)1024 * 1024 * 1024)
+	, mEntries()
+	, mBlockRaw()
+	, mBlockStored()
+	, mHdrBlock()
+	, mTermsBlock()
+	, mRecTerms()
+	, mStartBlockMs(0)
+	, mpFileData(NULL)
+	, mpFileIdx(NULL)
+	, mpFileTerms(NULL)
+	, mStartSegmentMs(0)
+	, mSizeSegment(0)
+	, mCntEntriesWritten(0)
+	, mCntBlocksWritten(0)
+	, mCntBytesRaw(0)
+	, mCntBytesStored(0)
+	, mCntSegments(0)
+{
+	mState = StStart;
+}
+
+/* member functions */
+
+void LogStoring::dirSet(const string &dir)
+{
+	mDir = dir;
+}
+
+void LogStoring::fsyncSet(LogStoreFsync fsync)
+{
+	mFsync = fsync;
+}
+
+void LogStoring::sizeSegmentMaxSet(size_t sizeMax)
+{
+	mSizeSegmentMax = sizeMax;
+}
+
+void LogStoring::ageSegmentMaxSet(uint32_t ageMaxSec)
+{
+	mAgeSegmentMaxSec = ageMaxSec;
+}
+
+void LogStoring::sizeStoreMaxSet(uint64_t sizeMax)
+{
+	mSizeStoreMax = sizeMax;
+}
+
+Success LogStoring::process()
+{
+	uint32_t curTimeMs = millis();
+	bool ok;
+#if 0
+	dStateTrace;
+#endif
+	switch (mState)
+	{
+	case StStart:
+
+		if (!mDir.size())
+			return procErrLog(-1, "log store directory not set");
+
+		mBlockRaw.reserve(cSizeBlockRawMax + 4096);
+
+		mLastSyncMs = curTimeMs;
+		logStoreEnabled = 1;
+
+		mState = StMain;
+
+		break;
+	case StMain:
+
+		logStoreFetch(mEntries);
+
+		ok = entriesProcess(false);
+		if (!ok)
+		{
+			logStoreEnabled = 0;
+			return procErrLog(-1, "could not write log store");
+		}
+
+		if (mFsync != LogStoreFsyncInterval)
+			break;
+
+		if (curTimeMs - mLastSyncMs < cIntervalSyncMs)
+			break;
+		mLastSyncMs = curTimeMs;
+
+		filesSync();
+
+		break;
+	default:
+		break;
+	}
+
+	return Pending;
+}
+
+Success LogStoring::shutdown()
+{
+	logStoreEnabled = 0;
+
+	logStoreFetch(mEntries);
+	entriesProcess(true);
+
+	filesSync();
+	segmentClose();
+
+	return Positive;
+}
+
+/*
+ * Entries are collected in a raw block. A block is written
+ * when it is full or when it has been open for a while.
+ */
+bool LogStoring::entriesProcess(bool force)
+{
+	uint32_t curTimeMs = millis();
+	bool ok;
+
+	while (mEntries.size())
+	{
+		const LogStoreEntry &entry = mEntries.front();
+
+		if (!mHdrBlock.cntEntries)
+		{
+			ok = segmentRotateCheck(entry.tsMs);
+			if (!ok)
+				return false;
+
+			mHdrBlock.tsFirstMs = entry.tsMs;
+			mStartBlockMs = curTimeMs;
+		}
+
+		logStoreEntryEncode(entry, mBlockRaw);
+		logStoreTermsExtract(entry.str, mTermsBlock);
+
+		mHdrBlock.tsLastMs = entry.tsMs;
+		++mHdrBlock.cntEntries;
+
+		mEntries.pop_front();
+
+		if (mBlockRaw.size() < cSizeBlockRawMax)
+			continue;
+
+		ok = blockWrite();
+		if (!ok)
+			return false;
+	}
+
+	if (!mHdrBlock.cntEntries)
+		return true;
+
+	if (!force && curTimeMs - mStartBlockMs < cIntervalBlockMs)
+		return true;
+
+	return blockWrite();
+}
+
+bool LogStoring::blockWrite()
+{
+	uint8_t bufHdr[cLenLogStoreBlockHdr];
+	uint8_t bufIdx[cLenLogStoreIdxRecord];
+	LogStoreIdxRecord rec;
+	const uint8_t *pData;
+	size_t lenDone;
+
+	blockCompress(mBlockRaw.data(), mBlockRaw.size(), mBlockStored);
+
+	mHdrBlock.lenRaw = (uint32_t)mBlockRaw.size();
+
+	if (mBlockStored.size() < mBlockRaw.size())
+	{
+		mHdrBlock.method = LogStoreMethodLz;
+		mHdrBlock.lenStored = (uint32_t)mBlockStored.size();
+		pData = mBlockStored.data();
+	}
+	else
+	{
+		mHdrBlock.method = LogStoreMethodRaw;
+		mHdrBlock.lenStored = mHdrBlock.lenRaw;
+		pData = mBlockRaw.data();
+	}
+
+	logStoreBlockHdrWrite(mHdrBlock, bufHdr);
+
+	rec.tsFirstMs = mHdrBlock.tsFirstMs;
+	rec.tsLastMs = mHdrBlock.tsLastMs;
+	rec.offset = mSizeSegment;
+	rec.cntEntries = mHdrBlock.cntEntries;
+
+	logStoreIdxRecordWrite(rec, bufIdx);
+
+	lenDone = fwrite(bufHdr, 1, sizeof(bufHdr), mpFileData);
+	if (lenDone != sizeof(bufHdr))
+		return false;
+
+	lenDone = fwrite(pData, 1, mHdrBlock.lenStored, mpFileData);
+	if (lenDone != mHdrBlock.lenStored)
+		return false;
+
+	logStoreTermRecordEncode(mSizeSegment, mTermsBlock, mRecTerms);
+
+	lenDone = fwrite(mRecTerms.data(), 1, mRecTerms.size(), mpFileTerms);
+	if (lenDone != mRecTerms.size())
+		return false;
+
+	// Index last: A record always points to a complete block
+	fflush(mpFileData);
+	fflush(mpFileTerms);
+
+	lenDone = fwrite(bufIdx, 1, sizeof(bufIdx), mpFileIdx);
+	if (lenDone != sizeof(bufIdx))
+		return false;
+
+	fflush(mpFileIdx);
+
+	mSizeSegment += sizeof(bufHdr) + mHdrBlock.lenStored;
+
+	mCntEntriesWritten += mHdrBlock.cntEntries;
+	++mCntBlocksWritten;
+	mCntBytesRaw += mHdrBlock.lenRaw;
+	mCntBytesStored += sizeof(bufHdr) + mHdrBlock.lenStored;
+
+	mBlockRaw.clear();
+	mHdrBlock = LogStoreBlockHdr();
+	mTermsBlock.clear();
+
+	if (mFsync == LogStoreFsyncBlock)
+		filesSync();
+
+	return true;
+}
+
+bool LogStoring::segmentOpen(uint64_t tsStartMs)
+{
+	string nameBase = logStoreSegmentName(mDir, tsStartMs);
+
+	mpFileData = fopen((nameBase + ".dat").c_str(), "ab");
+	if (!mpFileData)
+		return false;
+
+	mpFileIdx = fopen((nameBase + ".idx").c_str(), "ab");
+	mpFileTerms = fopen((nameBase + ".trm").c_str(), "ab");
+
+	if (!mpFileIdx || !mpFileTerms)
+	{
+		segmentClose();
+		return false;
+	}
+
+	fseek(mpFileData, 0, SEEK_END);
+	mSizeSegment = (uint64_t)ftell(mpFileData);
+
+	mStartSegmentMs = tsStartMs;
+	++mCntSegments;
+
+	procDbgLog("log segment opened: %s", nameBase.c_str());
+
+	return true;
+}
+
+void LogStoring::segmentClose()
+{
+	if (mpFileTerms)
+	{
+		fclose(mpFileTerms);
+		mpFileTerms = NULL;
+	}
+
+	if (mpFileIdx)
+	{
+		fclose(mpFileIdx);
+		mpFileIdx = NULL;
+	}
+
+	if (mpFileData)
+	{
+		fclose(mpFileData);
+		mpFileData = NULL;
+	}
+}
+
+bool LogStoring::segmentRotateCheck(uint64_t tsMs)
+{
+	bool rotate;
+
+	if (!mpFileData)
+	{
+		retentionApply();
+		return segmentOpen(tsMs);
+	}
+
+	rotate = mSizeSegment >= mSizeSegmentMax;
+	rotate |= tsMs - mStartSegmentMs >= (uint64_t)mAgeSegmentMaxSec * 1000;
+
+	if (!rotate)
+		return true;
+
+	filesSync();
+	segmentClose();
+
+	retentionApply();
+
+	return segmentOpen(tsMs);
+}
+
+// Oldest segments are deleted first
+void LogStoring::retentionApply()
+{
+	vector<string> namesBase;
+	vector<uint64_t> sizes;
+	uint64_t sizeTotal = 0;
+	FILE *pFile;
+	long sz;
+
+	logStoreSegmentsList(mDir, namesBase);
+
+	for (size_t i = 0; i < namesBase.size(); ++i)
+	{
+		sz = 0;
+
+		pFile = fopen((namesBase[i] + ".dat").c_str(), "rb");
+		if (pFile)
+		{
+			fseek(pFile, 0, SEEK_END);
+			sz = ftell(pFile);
+			fclose(pFile);
+		}
+
+		sizes.push_back(sz > 0 ? (uint64_t)sz : 0);
+		sizeTotal += sizes.back();
+	}
+
+	for (size_t i = 0; i < namesBase.size() && sizeTotal > mSizeStoreMax; ++i)
+	{
+		procDbgLog("removing log segment: %s", namesBase[i].c_str());
+
+		remove((namesBase[i] + ".dat").c_str());
+		remove((namesBase[i] + ".idx").c_str());
+		remove((namesBase[i] + ".trm").c_str());
+
+		sizeTotal -= sizes[i];
+	}
+}
+
+void LogStoring::filesSync()
+{
+	FILE *files[] = { mpFileData, mpFileTerms, mpFileIdx };
+
+	for (size_t i = 0; i < sizeof(files) / sizeof(*files); ++i)
+	{
+		if (!files[i])
+			continue;
+
+		fflush(files[i]);
+#if defined(_WIN32)
+		_commit(_fileno(files[i]));
+#else
+		fsync(fileno(files[i]));
+#endif
+	}
+}
+
+void LogStoring::processInfo(char *pBuf, char *pBufEnd)
+{
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("Directory\t\t%s\n", mDir.c_str());
+	dInfo("Segments opened\t\t%zu\n", mCntSegments);
+	dInfo("Entries written\t\t%zu\n", mCntEntriesWritten);
+	dInfo("Entries dropped\t\t%zu\n", logStoreDropped());
+	dInfo("Blocks written\t\t%zu\n", mCntBlocksWritten);
+	dInfo("Bytes raw/stored\t%" PRIu64 " / %" PRIu64 "\n",
+			mCntBytesRaw, mCntBytesStored);
+}
+
+/* static functions */
+
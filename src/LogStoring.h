@@ -0,0 +1,115 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOG_STORING_H
+#define LOG_STORING_H
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include "Processing.h"
+#include "LibLogStore.h"
+
+class LogStoring : public Processing
+{
+
+public:
+
+	static LogStoring *create()
+	{
+		return new dNoThrow LogStoring;
+	}
+
+	void dirSet(const std::string &dir);
+	void fsyncSet(LogStoreFsync fsync);
+	void sizeSegmentMaxSet(size_t sizeMax);
+	void ageSegmentMaxSet(uint32_t ageMaxSec);
+	void sizeStoreMaxSet(uint64_t sizeMax);
+
+protected:
+
+	LogStoring();
+	virtual ~LogStoring() {}
+
+private:
+
+	LogStoring(const LogStoring &) = delete;
+	LogStoring &operator=(const LogStoring &) = delete;
+
+	/*
+	 * Naming of functions:  objectVerb()
+	 * Example:              peerAdd()
+	 */
+
+	/* member functions */
+	Success process();
+	Success shutdown();
+	void processInfo(char *pBuf, char *pBufEnd);
+
+	bool entriesProcess(bool force);
+	bool blockWrite();
+	bool segmentOpen(uint64_t tsStartMs);
+	void segmentClose();
+	bool segmentRotateCheck(uint64_t tsMs);
+	void retentionApply();
+	void filesSync();
+
+	/* member variables */
+	uint32_t mStartMs;
+	uint32_t mLastSyncMs;
+	std::string mDir;
+	LogStoreFsync mFsync;
+	size_t mSizeSegmentMax;
+	uint32_t mAgeSegmentMaxSec;
+	uint64_t mSizeStoreMax;
+	std::deque<LogStoreEntry> mEntries;
+	std::vector<uint8_t> mBlockRaw;
+	std::vector<uint8_t> mBlockStored;
+	LogStoreBlockHdr mHdrBlock;
+	std::unordered_set<std::string> mTermsBlock;
+	std::vector<uint8_t> mRecTerms;
+	uint32_t mStartBlockMs;
+	FILE *mpFileData;
+	FILE *mpFileIdx;
+	FILE *mpFileTerms;
+	uint64_t mStartSegmentMs;
+	uint64_t mSizeSegment;
+	size_t mCntEntriesWritten;
+	size_t mCntBlocksWritten;
+	uint64_t mCntBytesRaw;
+	uint64_t mCntBytesStored;
+	size_t mCntSegments;
+
+	/* static functions */
+
+	/* static variables */
+
+	/* constants */
+
+};
+
+#endif
+
@@ -27,6 +27,7 @@
 
 #include "RemoteCommanding.h"
 #include "SingleWireScheduling.h"
+#include "LibTracing.h"
 #include "LibTime.h"
 
 #define dForEach_ProcState(gen) \
@@ -35,11 +36,14 @@
 		gen(StTransSendReadyWait) \
 		gen(StCmdAutoReceiveWait) \
 		gen(StCmdAutoDoneWait) \
+		gen(StMuxMain) \
 		gen(StFiltCreate) \
 		gen(StFiltSendReadyWait) \
 		gen(StWelcomeSend) \
 		gen(StMain) \
 		gen(StResponseRcvdWait) \
+		gen(StScriptDoneWait) \
+		gen(StBulkDoneWait) \
 
 #define dGenProcStateEnum(s) s,
 dProcessStateEnum(ProcState);
@@ -66,6 +70,10 @@ const string cWelcomeMsg = "\r\n" dPackageName "\r\n" \
 const string cInternalCmdCls = "dbg";
 const size_t cSizeColCmdMax = 22;
 const uint32_t cTmoCmdAuto = 200;
+const size_t cNumMuxInFlightMax = 16;
+const size_t cSizeBufMuxMax = 4096;
+const size_t cSizeBufMuxOutMax = 64 * 1024;
+const char *cCmdScriptExec = "scriptExec";
 
 list<EntryHelp> RemoteCommanding::cmds;
 
@@ -80,6 +88,20 @@ RemoteCommanding::RemoteCommanding(SOCKET fd)
 	, mTxtPrompt()
 	, mIdReq(0)
 	, mTimestamps(1)
+	, mCntBytesResp(0)
+	, mCntChunksResp(0)
+	// multiplexed auto mode
+	, mModeMux(false)
+	, mBufMux("")
+	, mBufMuxOut("")
+	, mRequestsMux()
+	, mStartMuxMs(0)
+	, mCntMuxDone(0)
+	// scripts
+	, mpExec(NULL)
+	, mDoneAuto(false)
+	// bulk transfers
+	, mpBulk(NULL)
 	// target online check
 	, mTargetIsOnline(false)
 	// command response measurement
@@ -92,6 +114,8 @@ RemoteCommanding::RemoteCommanding(SOCKET fd)
 	, mLastKeyWasTab(false)
 	, mCursorEditLow(0)
 	, mStrEdit(U"")
+	// profiling
+	, mpProfTick(profilingTickRegister("GwSupervising;GwMsgDispatching;RemoteCommanding"))
 {
 	mBufOut[0] = 0;
 	miEntryHist = mHistory.end();
@@ -103,11 +127,13 @@ RemoteCommanding::RemoteCommanding(SOCKET fd)
 
 Success RemoteCommanding::process()
 {
+	ProfilingTickScope profTick(mpProfTick);
 	uint32_t curTimeMs = millis();
 	uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
 	PipeEntry<KeyUser> entKey;
 	KeyUser key;
+	string strResult;
 #if 0
 	dStateTrace;
 #endif
@@ -171,6 +197,28 @@ Success RemoteCommanding::process()
 		if (success != Positive)
 			return procErrLog(-1, "could not process auto command");
 
+		if (mModeMux)
+		{
+			mStartMuxMs = curTimeMs;
+			mState = StMuxMain;
+			break;
+		}
+
+		if (mpExec)
+		{
+			mState = StScriptDoneWait;
+			break;
+		}
+
+		if (mpBulk)
+		{
+			mState = StBulkDoneWait;
+			break;
+		}
+
+		if (mDoneAuto)
+			return Positive;
+
 		mStartMs = curTimeMs;
 		mState = StCmdAutoDoneWait;
 
@@ -192,6 +240,17 @@ Success RemoteCommanding::process()
 
 		return Positive;
 
+		break;
+	case StMuxMain:
+
+		success = muxProcess(curTimeMs);
+		if (success == Pending)
+			break;
+
+		muxRequestsCancel();
+
+		return success;
+
 		break;
 	case StFiltCreate:
 
@@ -317,6 +376,58 @@ Success RemoteCommanding::process()
 
 		mState = StMain;
 
+		break;
+	case StScriptDoneWait:
+
+		if (mpTrans && mpTrans->success() != Pending)
+			return Positive;
+
+		success = mpExec->success();
+		if (success == Pending)
+			break;
+
+		scriptResultGet(strResult);
+
+		repel(mpExec);
+		mpExec = NULL;
+
+		if (mModeAuto)
+		{
+			mpTrans->send(strResult.c_str(), strResult.size());
+			return Positive;
+		}
+
+		mpFilt->send(strResult.c_str(), strResult.size());
+		promptSend();
+
+		mState = StMain;
+
+		break;
+	case StBulkDoneWait:
+
+		if (mpTrans && mpTrans->success() != Pending)
+			return Positive;
+
+		success = mpBulk->success();
+		if (success == Pending)
+			break;
+
+		bulkResultGet(strResult);
+
+		repel(mpBulk);
+		mpBulk = NULL;
+
+		if (mModeAuto)
+		{
+			mpTrans->send(strResult.c_str(), strResult.size());
+			return Positive;
+		}
+
+		mpFilt->send(strResult.c_str(), strResult.size());
+		promptSend();
+
+		mState = StMain;
+
 		break;
 	default:
 		break;
@@ -330,8 +441,8 @@ Success RemoteCommanding::autoCommandProcess()
 	size_t lenReq;
 	ssize_t lenDone;
 	char *pBufIn = mBufOut;
+	uint64_t rcvdNs;
 	string str;
-	bool ok;
 
 	lenReq = sizeof(mBufOut) - 1;
 
@@ -339,6 +450,8 @@ Success RemoteCommanding::autoCommandProcess()
 	if (!lenDone)
 		return Pending;
 
+	rcvdNs = cmdTraceNowNs();
+
 	if (lenDone < 0)
 	{
 		str = "<could not receive command>\r\n";
@@ -348,6 +461,67 @@ Success RemoteCommanding::autoCommandProcess()
 
 	pBufIn[lenDone] = 0;
 
+	if (!mBufScript.size() && pBufIn[0] == '@')
+	{
+		mBufMux.assign(pBufIn, (size_t)lenDone);
+		mModeMux = true;
+
+		return Positive;
+	}
+
+	if (mBufScript.size() || !strncmp(pBufIn, cCmdScriptExec, strlen(cCmdScriptExec)))
+		return autoScriptReceive(pBufIn, (size_t)lenDone);
+
+	if ((size_t)lenDone >= lenReq)
+	{
+		str = "<command too long>\r\n";
+		mpTrans->send(str.c_str(), str.size());
+		return procErrLog(-1, "command too long");
+	}
+
+	return autoCommandExecute(pBufIn, lenDone, rcvdNs);
+}
+
+/*
+ * Scripts sent with scriptExec may span several lines and
+ * TCP segments. They end with an empty line.
+ */
+Success RemoteCommanding::autoScriptReceive(const char *pData, size_t len)
+{
+	string str;
+	size_t idxEnd, lenScript;
+
+	mBufScript.append(pData, len);
+
+	idxEnd = mBufScript.find("\n\n");
+	if (idxEnd == string::npos)
+		idxEnd = mBufScript.find("\n\r\n");
+
+	lenScript = idxEnd == string::npos ? mBufScript.size() : idxEnd;
+
+	if (lenScript > strlen(cCmdScriptExec) + 1 + cSizeSrcScriptMax)
+	{
+		mBufScript.clear();
+
+		str = "<script too large>\r\n";
+		mpTrans->send(str.c_str(), str.size());
+		return procErrLog(-1, "script too large");
+	}
+
+	if (idxEnd == string::npos)
+		return Pending;
+
+	mBufScript.resize(idxEnd + 1);
+	str.swap(mBufScript);
+
+	return autoCommandExecute(&str[0], (ssize_t)str.size(), cmdTraceNowNs());
+}
+
+Success RemoteCommanding::autoCommandExecute(char *pBufIn, ssize_t lenDone, uint64_t rcvdNs)
+{
+	string str, msg;
+	bool ok;
+
 	// remove newline
 
 	if (pBufIn[lenDone - 1] == '\n')
@@ -356,7 +530,8 @@ Success RemoteCommanding::autoCommandProcess()
 	if (pBufIn[lenDone - 1] == '\r')
 		pBufIn[--lenDone] = 0;
 
-	for (ssize_t i = 0; i < lenDone; ++i)
+	// v2 frames are length prefixed. Any byte is allowed
+	for (ssize_t i = 0; !SingleWireScheduling::protoV2Active && i < lenDone; ++i)
 	{
 		if (!SingleWireScheduling::isCtrl(pBufIn[i]))
 			continue;
@@ -374,7 +549,21 @@ Success RemoteCommanding::autoCommandProcess()
 #endif
 	str = string(pBufIn);
 
-	ok = SingleWireScheduling::commandSend(str, mIdReq);
+	if (scriptCommandProcess(str, msg) || bulkCommandProcess(str, msg) ||
+			sampleCommandProcess(str, msg))
+	{
+		if (msg.size())
+		{
+			lfToCrLf(msg.c_str(), str);
+			mpTrans->send(str.c_str(), str.size());
+		}
+
+		mDoneAuto = true;
+
+		return Positive;
+	}
+
+	ok = SingleWireScheduling::commandSend(str, mIdReq, PrioUser, true);
 	if (!ok)
 	{
 		str = "<could not send command>\r\n";
@@ -382,9 +571,601 @@ Success RemoteCommanding::autoCommandProcess()
 		return procErrLog(-1, "could not send command");
 	}
 
+	cmdTraceMark(mIdReq, CmdTraceRcvd, rcvdNs);
+
 	return Positive;
 }
 
+/*
+ * Multiplexed auto mode
+ *
+ * Selected when the first command starts with '@'. The
+ * connection stays open and every line is a tagged command.
+ *
+ *   Request   @<tag> <command>\n
+ *   Response  @<tag> <len>\n<response with len bytes>\n
+ *   Chunk     @<tag> +<len>\n<part of response>\n
+ *   Error     @<tag> !<reason>\n
+ *
+ * Large responses are sent as chunks, followed by
+ * the last part as a regular response. If chunks had to
+ * be dropped, the last part is an error instead.
+ *
+ * Many commands may be sent in one write. Responses are sent
+ * as soon as they arrive and are matched by their tag. With
+ * cNumMuxInFlightMax commands in flight or while responses
+ * wait to be sent, the socket is not read anymore, which
+ * throttles the client via TCP.
+ */
+Success RemoteCommanding::muxProcess(uint32_t curTimeMs)
+{
+	Success success;
+
+	success = muxOutputFlush();
+	if (success != Pending && success != Positive)
+		return procErrLog(-1, "could not send response");
+
+	// Client doesn't read. Responses stay in the scheduler
+	if (mBufMuxOut.size() > cSizeBufMuxOutMax)
+	{
+		mStartMuxMs = curTimeMs;
+		return Pending;
+	}
+
+	muxResponsesSend(curTimeMs);
+
+	success = muxRequestsReceive();
+	if (success != Pending)
+	{
+		muxOutputFlush();
+		return success;
+	}
+
+	if (!mRequestsMux.size())
+		mStartMuxMs = curTimeMs;
+
+	return Pending;
+}
+
+Success RemoteCommanding::muxRequestsReceive()
+{
+	char *pBufIn = mBufOut;
+	size_t idxEnd, idxSpace;
+	RequestMux req;
+	ssize_t lenDone;
+	string line, cmd;
+	bool ok;
+
+	while (mRequestsMux.size() < cNumMuxInFlightMax && !mBufMuxOut.size())
+	{
+		idxEnd = mBufMux.find('\n');
+		if (idxEnd == string::npos)
+		{
+			if (mBufMux.size() > cSizeBufMuxMax)
+			{
+				muxReply("", "line too long", true);
+				return procErrLog(-1, "multiplexed line too long");
+			}
+
+			lenDone = mpTrans->read(pBufIn, sizeof(mBufOut));
+			if (!lenDone)
+				break;
+
+			if (lenDone < 0)
+				return Positive; // client done
+
+			mBufMux.append(pBufIn, (size_t)lenDone);
+			continue;
+		}
+
+		line = mBufMux.substr(0, idxEnd);
+
+		if (line.size() && line.back() == '\r')
+			line.pop_back();
+
+		if (!line.size())
+		{
+			mBufMux.erase(0, idxEnd + 1);
+			continue;
+		}
+
+		idxSpace = line.find(' ');
+
+		if (line[0] != '@' || idxSpace == string::npos || idxSpace == 1)
+		{
+			mBufMux.erase(0, idxEnd + 1);
+			muxReply("", "expected '@<tag> <command>'", true);
+			continue;
+		}
+
+		req.tag = line.substr(1, idxSpace - 1);
+		cmd = line.substr(idxSpace + 1);
+
+		ok = true;
+		for (size_t i = 0; !SingleWireScheduling::protoV2Active && i < cmd.size() && ok; ++i)
+			ok = !SingleWireScheduling::isCtrl(cmd[i]);
+
+		if (!ok)
+		{
+			mBufMux.erase(0, idxEnd + 1);
+			muxReply(req.tag, "command contains protocol control byte", true);
+			continue;
+		}
+
+		// Scheduler queue full: Retry later
+		ok = SingleWireScheduling::commandSend(cmd, req.idReq, PrioUser, true);
+		if (!ok)
+			break;
+
+		cmdTraceMark(req.idReq, CmdTraceRcvd);
+
+		mBufMux.erase(0, idxEnd + 1);
+		mRequestsMux.push_back(req);
+	}
+
+	return Pending;
+}
+
+/*
+ * Only the oldest request of the connection is checked for a
+ * timeout. Its clock starts when the previous one completed,
+ * so queueing behind own requests doesn't count. Responses to
+ * younger requests don't restart it. Otherwise a command
+ * dropped by the target would never time out.
+ */
+void RemoteCommanding::muxResponsesSend(uint32_t curTimeMs)
+{
+	list<RequestMux>::iterator iter;
+	string resp;
+	bool last, truncated, ok;
+
+	iter = mRequestsMux.begin();
+	while (iter != mRequestsMux.end())
+	{
+		ok = SingleWireScheduling::commandChunkGet(iter->idReq, resp, last, truncated);
+		if (!ok)
+		{
+			++iter;
+			continue;
+		}
+
+		if (iter == mRequestsMux.begin())
+			mStartMuxMs = curTimeMs;
+
+		if (!last)
+		{
+			muxReply(iter->tag, resp, false, true);
+			continue;
+		}
+
+		if (truncated)
+			muxReply(iter->tag, "response truncated", true);
+		else
+			muxReply(iter->tag, resp);
+
+		cmdTraceMark(iter->idReq, CmdTraceReplied);
+
+		++mCntMuxDone;
+
+		iter = mRequestsMux.erase(iter);
+	}
+
+	if (!mRequestsMux.size())
+		return;
+
+	if (curTimeMs - mStartMuxMs <= cTimeoutCommandResponseMs)
+		return;
+
+	const RequestMux &req = mRequestsMux.front();
+
+	SingleWireScheduling::commandCancel(req.idReq);
+	muxReply(req.tag, "command response timeout", true);
+
+	mRequestsMux.pop_front();
+	mStartMuxMs = curTimeMs;
+}
+
+void RemoteCommanding::muxReply(const string &tag, const string &resp, bool isErr, bool partial)
+{
+	string msg;
+
+	msg.reserve(tag.size() + resp.size() + 16);
+
+	msg += "@";
+	msg += tag;
+	msg += " ";
+
+	if (isErr)
+		msg += "!";
+	else
+	{
+		if (partial)
+			msg += "+";
+
+		msg += to_string(resp.size());
+		msg += "\n";
+	}
+
+	msg += resp;
+	msg += "\n";
+
+	mBufMuxOut += msg;
+	muxOutputFlush();
+}
+
+// Partial sends must not break the framing of later responses
+Success RemoteCommanding::muxOutputFlush()
+{
+	ssize_t lenDone;
+
+	if (!mBufMuxOut.size())
+		return Positive;
+
+	if (!mpTrans->mSendReady)
+		return Pending;
+
+	lenDone = mpTrans->send(mBufMuxOut.data(), mBufMuxOut.size());
+	if (lenDone < 0)
+		return -1;
+
+	mBufMuxOut.erase(0, (size_t)lenDone);
+
+	return mBufMuxOut.size() ? Pending : Positive;
+}
+
+void RemoteCommanding::muxRequestsCancel()
+{
+	list<RequestMux>::iterator iter;
+
+	iter = mRequestsMux.begin();
+	for (; iter != mRequestsMux.end(); ++iter)
+		SingleWireScheduling::commandCancel(iter->idReq);
+
+	mRequestsMux.clear();
+}
+
+/*
+ * Scripts are executed on the gateway. The client
+ * gets all responses at once when the script is done.
+ *
+ *   scriptDef <name> <script>
+ *   scriptRun <name>
+ *   scriptExec <script>
+ *   scriptList
+ *   scriptDel <name>
+ *
+ * Returns false if the string is not a script command.
+ */
+bool RemoteCommanding::scriptCommandProcess(const string &str, string &msg)
+{
+	vector<ScriptStmt> stmts;
+	list<string> names;
+	list<string>::const_iterator iter;
+	string word, arg, name, strErr;
+	size_t idxSep;
+	bool ok;
+
+	idxSep = str.find_first_of(" \n");
+	word = str.substr(0, idxSep);
+
+	if (word.compare(0, 6, "script"))
+		return false;
+
+	if (idxSep != string::npos)
+		arg = str.substr(idxSep + 1);
+
+	idxSep = arg.find_first_of(" \n");
+	name = arg.substr(0, idxSep);
+
+	msg = "";
+
+	if (word == "scriptList")
+	{
+		scriptsList(names);
+
+		iter = names.begin();
+		for (; iter != names.end(); ++iter)
+			msg += *iter + "\n";
+
+		msg += "<" + to_string(names.size()) + " scripts defined>\n";
+	}
+	else
+	if (word == "scriptDef")
+	{
+		if (idxSep == string::npos)
+			idxSep = arg.size();
+
+		ok = scriptDefine(name, arg.substr(idxSep), strErr);
+		if (ok)
+			msg = "<script '" + name + "' defined>\n";
+		else
+			msg = "<error: " + strErr + ">\n";
+	}
+	else
+	if (word == "scriptDel")
+	{
+		if (scriptDelete(name))
+			msg = "<script '" + name + "' deleted>\n";
+		else
+			msg = "<error: script not defined>\n";
+	}
+	else
+	if (word == "scriptRun")
+	{
+		ok = scriptGet(name, stmts, strErr);
+		if (!ok)
+			msg = "<error: " + strErr + ">\n";
+		else
+		if (!scriptStart(stmts))
+			msg = "<error: could not start script>\n";
+	}
+	else
+	if (word == "scriptExec")
+	{
+		ok = scriptParse(arg, stmts, strErr);
+		if (!ok)
+			msg = "<error: " + strErr + ">\n";
+		else
+		if (!scriptStart(stmts))
+			msg = "<error: could not start script>\n";
+	}
+	else
+		return false;
+
+	return true;
+}
+
+bool RemoteCommanding::scriptStart(const vector<ScriptStmt> &stmts)
+{
+	mpExec = ScriptExecuting::create();
+	if (!mpExec)
+	{
+		procErrLog(-1, "could not create process");
+		return false;
+	}
+
+	mpExec->mStmts = stmts;
+
+	start(mpExec);
+
+	return true;
+}
+
+void RemoteCommanding::scriptResultGet(string &msg)
+{
+	string strStatus, str;
+
+	if (mpExec->success() != Positive)
+		strStatus = "<error: script failed>";
+	else
+	if (mpExec->mErr.size())
+		strStatus = "<error: " + mpExec->mErr + ">";
+	else
+		strStatus = "<done: " + to_string(mpExec->mCntCmds) +
+				" commands in " + to_string(mpExec->mDurationMs) + " ms>";
+
+	lfToCrLf(mpExec->mResult.c_str(), msg);
+
+	if (!mModeAuto)
+	{
+		str = dColorGrey;
+		str += strStatus;
+		str += dColorClear;
+
+		strStatus = str;
+	}
+
+	msg += strStatus;
+	msg += "\r\n";
+}
+
+/*
+ * Binary reads from the target using the bulk channel.
+ * Data is streamed directly to the destination.
+ *
+ *   bulkRead <file> <source>   Store on gateway
+ *   bulkGet <source>           Raw bytes to client. Automatic port only
+ *
+ * With bulkGet the connection is closed after the last byte.
+ * Errors are reported only if no data has been sent yet.
+ *
+ * Returns false if the string is not a bulk command.
+ */
+bool RemoteCommanding::bulkCommandProcess(const string &str, string &msg)
+{
+	string word, arg, nameFile;
+	size_t idxSep;
+
+	idxSep = str.find(' ');
+	word = str.substr(0, idxSep);
+
+	if (word != "bulkRead" && word != "bulkGet")
+		return false;
+
+	if (idxSep != string::npos)
+		arg = str.substr(idxSep + 1);
+
+	msg = "";
+
+	if (word == "bulkRead")
+	{
+		idxSep = arg.find(' ');
+		if (idxSep == string::npos)
+		{
+			msg = "<error: usage: bulkRead <file> <source>>\n";
+			return true;
+		}
+
+		nameFile = arg.substr(0, idxSep);
+		arg.erase(0, idxSep + 1);
+	}
+	else
+	if (!mModeAuto)
+	{
+		msg = "<error: bulkGet is available on the automatic port only>\n";
+		return true;
+	}
+
+	if (!arg.size())
+	{
+		msg = "<error: no source given>\n";
+		return true;
+	}
+
+	mpBulk = BulkReceiving::create();
+	if (!mpBulk)
+	{
+		procErrLog(-1, "could not create process");
+		msg = "<error: could not start transfer>\n";
+		return true;
+	}
+
+	mpBulk->mSource = arg;
+	mpBulk->mNameFile = nameFile;
+
+	if (!nameFile.size())
+		mpBulk->mpTrans = mpTrans;
+
+	start(mpBulk);
+
+	return true;
+}
+
+void RemoteCommanding::bulkResultGet(string &msg)
+{
+	string strStatus, str;
+
+	msg = "";
+
+	if (mpBulk->mpTrans && mpBulk->mCntBytes)
+		return;
+
+	if (mpBulk->success() != Positive)
+		strStatus = "<error: transfer failed>";
+	else
+	if (mpBulk->mErr.size())
+		strStatus = "<error: " + mpBulk->mErr + ">";
+	else
+	if (mpBulk->mpTrans)
+		return;
+	else
+		strStatus = "<done: " + to_string(mpBulk->mCntBytes) +
+				" bytes in " + to_string(mpBulk->mDurationMs) + " ms>";
+
+	if (!mModeAuto)
+	{
+		str = dColorGrey;
+		str += strStatus;
+		str += dColorClear;
+
+		strStatus = str;
+	}
+
+	msg += strStatus;
+	msg += "\r\n";
+}
+
+/*
+ * Variable sampling. Samples are stored on the gateway and
+ * fetched decimated to min/max buckets for plotting.
+ *
+ *   sampleStart <rate Hz> <symbol> ..
+ *   sampleStop
+ *   sampleInfo
+ *   sampleGet <symbol> <from> [<to> [<points>]]
+ *
+ * Times are 'now', ms since epoch or '-<sec>' before now.
+ * sampleGet answers one line per bucket: <us since epoch> <min> <max>
+ *
+ * Returns false if the string is not a sample command.
+ */
+bool RemoteCommanding::sampleCommandProcess(const string &str, string &msg)
+{
+	vector<string> parts = split(str, ' ');
+	vector<SampleBucket> buckets;
+	vector<string> symbols;
+	uint64_t fromUs, toUs;
+	unsigned long val;
+	size_t numPoints = 500;
+	string strErr;
+	bool ok = true;
+
+	if (!parts.size() || parts[0].compare(0, 6, "sample"))
+		return false;
+
+	for (size_t i = parts.size(); i > 0; --i)
+	{
+		if (!parts[i - 1].size())
+			parts.erase(parts.begin() + (i - 1));
+	}
+
+	msg = "";
+
+	if (parts[0] == "sampleInfo")
+		sampleInfoGet(msg);
+	else
+	if (parts[0] == "sampleStop")
+	{
+		sampleConfigSet(0, symbols);
+		msg = "<sampling stop requested>\n";
+	}
+	else
+	if (parts[0] == "sampleStart")
+	{
+		val = parts.size() > 2 ? strtoul(parts[1].c_str(), NULL, 10) : 0;
+
+		symbols.assign(parts.begin() + (parts.size() > 2 ? 2 : parts.size()), parts.end());
+
+		if (val)
+			ok = sampleConfigSet((uint32_t)(1000000 / val), symbols);
+
+		if (!val || !ok)
+			msg = "<error: usage: sampleStart <rate Hz> <symbol> .. (max. " +
+					to_string(cNumChannelsSampleMax) + " symbols)>\n";
+		else
+			msg = "<sampling requested. See sampleInfo>\n";
+	}
+	else
+	if (parts[0] == "sampleGet")
+	{
+		if (parts.size() < 3)
+		{
+			msg = "<error: usage: sampleGet <symbol> <from> [<to> [<points>]]>\n";
+			return true;
+		}
+
+		fromUs = sampleTimeParse(parts[2], ok);
+		toUs = parts.size() > 3 ? sampleTimeParse(parts[3], ok) : sampleNowUs();
+
+		if (parts.size() > 4)
+			numPoints = strtoul(parts[4].c_str(), NULL, 10);
+
+		if (ok)
+			ok = sampleRange(parts[1], fromUs, toUs, numPoints, buckets, strErr);
+		else
+			strErr = "invalid time";
+
+		if (!ok)
+		{
+			msg = "<error: " + strErr + ">\n";
+			return true;
+		}
+
+		for (size_t i = 0; i < buckets.size(); ++i)
+		{
+			msg += to_string(buckets[i].tsUs) + " " +
+					to_string(buckets[i].min) + " " +
+					to_string(buckets[i].max) + "\n";
+		}
+
+		msg += "<done: " + to_string(buckets.size()) + " points>\n";
+	}
+	else
+		return false;
+
+	return true;
+}
+
 bool RemoteCommanding::stateOnlineChanged()
 {
 	if (*mpTargetIsOnline == mTargetIsOnline)
@@ -397,6 +1178,7 @@ bool RemoteCommanding::stateOnlineChanged()
 
 Success RemoteCommanding::commandSend()
 {
+	uint64_t rcvdNs = cmdTraceNowNs();
 	string str, msg;
 	bool ok;
 
@@ -471,23 +1253,96 @@ Success RemoteCommanding::commandSend()
 		return Positive;
 	}
 
+	if (scriptCommandProcess(str, msg) || bulkCommandProcess(str, msg) ||
+			sampleCommandProcess(str, msg))
+	{
+		lineAck();
+
+		if (msg.size())
+		{
+			lfToCrLf(msg.c_str(), str);
+
+			msg = dColorGrey;
+			msg += str;
+			msg += dColorClear;
+
+			mpFilt->send(msg.c_str(), msg.size());
+		}
+
+		if (mpExec)
+		{
+			mState = StScriptDoneWait;
+			return Positive;
+		}
+
+		if (mpBulk)
+		{
+			mState = StBulkDoneWait;
+			return Positive;
+		}
+
+		promptSend();
+
+		return Positive;
+	}
+
 	//procWrnLog("sending command: %s", str.c_str());
 
-	ok = SingleWireScheduling::commandSend(str, mIdReq);
+	ok = SingleWireScheduling::commandSend(str, mIdReq, PrioUser, true);
 	if (!ok)
 		return procErrLog(-1, "could not send command");
 
+	mCntBytesResp = 0;
+	mCntChunksResp = 0;
+
+	cmdTraceMark(mIdReq, CmdTraceRcvd, rcvdNs);
+
 	return Pending;
 }
 
+/*
+ * Responses are streamed. Every chunk is forwarded as soon
+ * as it arrives, so large responses don't need to fit into
+ * a single buffer and the first bytes show up immediately.
+ */
 Success RemoteCommanding::responseReceive()
 {
 	string resp, str, msg;
+	bool last = false;
+	bool truncated = false;
 	bool ok;
 
-	ok = SingleWireScheduling::commandResponseGet(mIdReq, resp);
-	if (!ok)
-		return Pending;
+	while (!last)
+	{
+		ok = SingleWireScheduling::commandChunkGet(mIdReq, resp, last, truncated);
+		if (!ok)
+			return Pending;
+
+		mStartMs = millis(); // response still arriving
+
+		if (!mCntBytesResp && !mModeAuto && mTimestamps)
+		{
+			msg += dColorGrey;
+			msg += nowToStr("%H:%M:%S ");
+			msg += dColorClear;
+		}
+
+		mCntBytesResp += resp.size();
+
+		if (last)
+			break;
+
+		lfToCrLf(resp.data(), str);
+		msg += str;
+
+		if (mModeAuto)
+			mpTrans->send(msg.c_str(), msg.size());
+		else
+			mpFilt->send(msg.c_str(), msg.size());
+
+		msg.clear();
+		++mCntChunksResp;
+	}
 
 	//procWrnLog("response received: '%s'", resp.c_str());
 
@@ -495,37 +1350,51 @@ Success RemoteCommanding::responseReceive()
 	{
 		lfToCrLf(resp.data(), str);
 
+		if (truncated)
+			str = "\r\n<response truncated>";
+
 		if (!str.size() || str.back() != '\n')
 			str += "\r\n";
 
 		mpTrans->send(str.c_str(), str.size());
+		cmdTraceMark(mIdReq, CmdTraceReplied);
 
 		return Positive;
 	}
 
-	if (mTimestamps)
+	if (!mCntBytesResp)
 	{
 		msg += dColorGrey;
-		msg += nowToStr("%H:%M:%S ");
+		msg += "<done>";
 		msg += dColorClear;
 	}
+	else
+	{
+		lfToCrLf(resp.data(), str);
+		msg += str;
+	}
 
-	if (!resp.size())
+	if (truncated)
 	{
-		msg += dColorGrey;
-		msg += "<done>";
+		msg += "\r\n";
+		msg += dColorOrange;
+		msg += "<response truncated after " + to_string(mCntBytesResp) + " bytes>";
 		msg += dColorClear;
 	}
 	else
+	if (mCntChunksResp)
 	{
-		lfToCrLf(resp.data(), str);
-		msg += str;
+		msg += "\r\n";
+		msg += dColorGrey;
+		msg += "<end of response: " + to_string(mCntBytesResp) + " bytes>";
+		msg += dColorClear;
 	}
 
 	if (msg.size())
 		msg += "\r\n";
 
 	mpFilt->send(msg.c_str(), msg.size());
+	cmdTraceMark(mIdReq, CmdTraceReplied);
 	promptSend();
 
 	mDelayResponseCmdMs = millis() - mStartCmdMs;
@@ -855,6 +1724,15 @@ void RemoteCommanding::processInfo(char *pBuf, char *pBufEnd)
 
 	dInfo("Command delay\t\t%u [ms]\n", mDelayResponseCmdMs);
 	dInfo("Command history\t\t%zu\n", mHistory.size());
+
+	if (mModeMux)
+	{
+		dInfo("Commands in flight\t%zu\n", mRequestsMux.size());
+		dInfo("Commands done\t\t%zu\n", mCntMuxDone);
+		dInfo("Output pending\t\t%zu [bytes]\n", mBufMuxOut.size());
+	}
+
+	profilingTickInfo(pBuf, pBufEnd, mpProfTick);
 #if 0
 	list<u32string>::iterator iter;
 	size_t idxHist = 0;
@@ -948,6 +1826,66 @@ void RemoteCommanding::listCommandsUpdate(const list<string> &listStr)
 	entry.group = cInternalCmdCls;
 	cmds.push_back(entry);
 
+	entry.id = U"scriptRun";
+	entry.shortcut = U"";
+	entry.desc = "Run script on gateway: <name>";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"scriptDef";
+	entry.shortcut = U"";
+	entry.desc = "Define script: <name> <cmd>; ..";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"scriptExec";
+	entry.shortcut = U"";
+	entry.desc = "Run script given inline";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"scriptList";
+	entry.shortcut = U"";
+	entry.desc = "List defined scripts";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"scriptDel";
+	entry.shortcut = U"";
+	entry.desc = "Delete script: <name>";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"sampleStart";
+	entry.shortcut = U"";
+	entry.desc = "Sample variables: <rate Hz> <symbol> ..";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"sampleStop";
+	entry.shortcut = U"";
+	entry.desc = "Stop sampling";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"sampleInfo";
+	entry.shortcut = U"";
+	entry.desc = "Show sampling state";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"sampleGet";
+	entry.shortcut = U"";
+	entry.desc = "Get samples: <symbol> <from> [<to> [<points>]]";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
+	entry.id = U"bulkRead";
+	entry.shortcut = U"";
+	entry.desc = "Read from target: <file> <source>";
+	entry.group = cInternalCmdCls;
+	cmds.push_back(entry);
+
 	cmds.sort(commandSort);
 }
 
@@ -30,8 +30,11 @@
 #include <list>
 
 #include "Processing.h"
+#include "LibProfiling.h"
 #include "TelnetFiltering.h"
 #include "TextBox.h"
+#include "ScriptExecuting.h"
+#include "BulkReceiving.h"
 
 struct EntryHelp
 {
@@ -41,6 +44,12 @@ struct EntryHelp
 	std::string group;
 };
 
+struct RequestMux
+{
+	uint32_t idReq;
+	std::string tag;
+};
+
 class RemoteCommanding : public Processing
 {
 
@@ -68,6 +77,8 @@ private:
 	RemoteCommanding(const RemoteCommanding &) = delete;
 	RemoteCommanding &operator=(const RemoteCommanding &) = delete;
 
+	friend class Benchmarking;
+
 	/*
 	 * Naming of functions:  objectVerb()
 	 * Example:              peerAdd()
@@ -78,6 +89,20 @@ private:
 	void processInfo(char *pBuf, char *pBufEnd);
 
 	Success autoCommandProcess();
+	Success autoScriptReceive(const char *pData, size_t len);
+	Success autoCommandExecute(char *pBufIn, ssize_t lenDone, uint64_t rcvdNs);
+	Success muxProcess(uint32_t curTimeMs);
+	Success muxRequestsReceive();
+	void muxResponsesSend(uint32_t curTimeMs);
+	void muxReply(const std::string &tag, const std::string &resp, bool isErr = false, bool partial = false);
+	Success muxOutputFlush();
+	void muxRequestsCancel();
+	bool scriptCommandProcess(const std::string &str, std::string &msg);
+	bool scriptStart(const std::vector<ScriptStmt> &stmts);
+	void scriptResultGet(std::string &msg);
+	bool bulkCommandProcess(const std::string &str, std::string &msg);
+	void bulkResultGet(std::string &msg);
+	bool sampleCommandProcess(const std::string &str, std::string &msg);
 	bool stateOnlineChanged();
 
 	Success commandSend();
@@ -101,6 +126,24 @@ private:
 	uint32_t mIdReq;
 	char mBufOut[1023];
 	uint8_t mTimestamps;
+	size_t mCntBytesResp;
+	size_t mCntChunksResp;
+
+	// multiplexed auto mode
+	bool mModeMux;
+	std::string mBufMux;
+	std::string mBufMuxOut;
+	std::list<RequestMux> mRequestsMux;
+	uint32_t mStartMuxMs;
+	size_t mCntMuxDone;
+
+	// scripts
+	ScriptExecuting *mpExec;
+	std::string mBufScript;
+	bool mDoneAuto;
+
+	// bulk transfers
+	BulkReceiving *mpBulk;
 
 	// target online check
 	bool mTargetIsOnline;
@@ -119,6 +162,9 @@ private:
 	uint32_t mCursorEditLow;
 	std::u32string mStrEdit;
 
+	// profiling
+	ProfilingTick *mpProfTick;
+
 	/* static functions */
 	static void cmdHelpPrint(char *pArgs, char *pBuf, char *pBufEnd);
 	static bool commandSort(const EntryHelp &cmdFirst, const EntryHelp &cmdSecond);
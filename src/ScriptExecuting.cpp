@@ -0,0 +1,302 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ScriptExecuting.h"
+#include "SingleWireScheduling.h"
+#include "LibTime.h"
+
+#define dForEach_ProcState(gen) \
+		gen(StStart) \
+		gen(StStmtNext) \
+		gen(StRespWait) \
+		gen(StDelay) \
+
+#define dGenProcStateEnum(s) s,
+dProcessStateEnum(ProcState);
+
+#if 1
+#define dGenProcStateString(s) #s,
+dProcessStateStr(ProcState);
+#endif
+
+using namespace std;
+
+const size_t cNumCmdsScriptMax = 10000;
+const uint32_t cIntervalUntilMs = 100;
+const uint32_t cNumTriesUntilMax = 50;
+
+ScriptExecuting::ScriptExecuting()
+	: Processing("ScriptExecuting")
+	, mStmts()
+	, mResult("")
+	, mErr("")
+	, mCntCmds(0)
+	, mDurationMs(0)
+	, mStartMs(0)
+	, mStartAllMs(0)
+	, mDelayMs(0)
+	, mIdxStmt(0)
+	, mRepeats()
+	, mIdReq(0)
+	, mReqPending(false)
+	, mCntTries(0)
+	, mRespLast("")
+{
+	mState = StStart;
+}
+
+/* member functions */
+
+Success ScriptExecuting::process()
+{
+	uint32_t curTimeMs = millis();
+	uint32_t diffMs = curTimeMs - mStartMs;
+	const ScriptStmt *pStmt;
+	string resp;
+	bool ok;
+#if 0
+	dStateTrace;
+#endif
+	switch (mState)
+	{
+	case StStart:
+
+		if (!mStmts.size())
+			return procErrLog(-1, "no statements given");
+
+		mStartAllMs = curTimeMs;
+		mIdxStmt = 0;
+
+		mState = StStmtNext;
+
+		break;
+	case StStmtNext:
+
+		if (mIdxStmt >= mStmts.size())
+		{
+			mDurationMs = curTimeMs - mStartAllMs;
+			return Positive;
+		}
+
+		if (mCntCmds >= cNumCmdsScriptMax)
+		{
+			mErr = "command limit reached";
+			return Positive;
+		}
+
+		ok = stmtExecute(curTimeMs);
+		if (!ok)
+		{
+			mDurationMs = curTimeMs - mStartAllMs;
+			return Positive;
+		}
+
+		break;
+	case StRespWait:
+
+		if (diffMs > cTimeoutCommandResponseMs)
+		{
+			SingleWireScheduling::commandCancel(mIdReq);
+			mReqPending = false;
+
+			mErr = "command response timeout: " + mStmts[mIdxStmt].cmd;
+			mDurationMs = curTimeMs - mStartAllMs;
+
+			return Positive;
+		}
+
+		ok = SingleWireScheduling::commandResponseGet(mIdReq, resp);
+		if (!ok)
+			break;
+
+		mReqPending = false;
+		mRespLast = resp;
+
+		pStmt = &mStmts[mIdxStmt];
+
+		if (pStmt->op == ScriptOpUntil &&
+				mRespLast.find(pStmt->text) == string::npos)
+		{
+			if (mCntTries >= cNumTriesUntilMax)
+			{
+				mErr = "until: no match for '" + pStmt->text + "'";
+				mDurationMs = curTimeMs - mStartAllMs;
+
+				return Positive;
+			}
+
+			mDelayMs = cIntervalUntilMs;
+			mStartMs = curTimeMs;
+			mState = StDelay;
+			break;
+		}
+
+		mResult += "> " + pStmt->cmd + "\n";
+		mResult += mRespLast;
+
+		if (!mRespLast.size() || mRespLast.back() != '\n')
+			mResult += "\n";
+
+		++mIdxStmt;
+		mState = StStmtNext;
+
+		break;
+	case StDelay:
+
+		if (diffMs < mDelayMs)
+			break;
+
+		// Delay of until statement: Retry
+		if (mStmts[mIdxStmt].op == ScriptOpUntil)
+		{
+			ok = commandSend(mStmts[mIdxStmt].cmd);
+			if (!ok)
+				return procErrLog(-1, "could not send command");
+
+			++mCntTries;
+
+			mStartMs = curTimeMs;
+			mState = StRespWait;
+			break;
+		}
+
+		++mIdxStmt;
+		mState = StStmtNext;
+
+		break;
+	default:
+		break;
+	}
+
+	return Pending;
+}
+
+Success ScriptExecuting::shutdown()
+{
+	if (mReqPending)
+		SingleWireScheduling::commandCancel(mIdReq);
+
+	return Positive;
+}
+
+// Returns false when the script ends early
+bool ScriptExecuting::stmtExecute(uint32_t curTimeMs)
+{
+	const ScriptStmt &stmt = mStmts[mIdxStmt];
+	bool ok;
+
+	switch (stmt.op)
+	{
+	case ScriptOpCmd:
+	case ScriptOpUntil:
+
+		ok = commandSend(stmt.cmd);
+		if (!ok)
+		{
+			mErr = "could not send command: " + stmt.cmd;
+			return false;
+		}
+
+		mCntTries = 1;
+
+		mStartMs = curTimeMs;
+		mState = StRespWait;
+
+		break;
+	case ScriptOpRepeat:
+
+		if (!stmt.val)
+		{
+			mIdxStmt = stmt.idxJump + 1;
+			break;
+		}
+
+		mRepeats.push_back({ mIdxStmt, stmt.val });
+		++mIdxStmt;
+
+		break;
+	case ScriptOpEnd:
+
+		if (--mRepeats.back().cntLeft)
+		{
+			mIdxStmt = stmt.idxJump + 1;
+			break;
+		}
+
+		mRepeats.pop_back();
+		++mIdxStmt;
+
+		break;
+	case ScriptOpWait:
+
+		mDelayMs = stmt.val;
+		mStartMs = curTimeMs;
+		mState = StDelay;
+
+		break;
+	case ScriptOpExpect:
+
+		if (mRespLast.find(stmt.text) == string::npos)
+		{
+			mErr = "expect: no match for '" + stmt.text + "'";
+			return false;
+		}
+
+		++mIdxStmt;
+
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+bool ScriptExecuting::commandSend(const string &cmd)
+{
+	bool ok;
+
+	ok = SingleWireScheduling::commandSend(cmd, mIdReq);
+	if (!ok)
+		return false;
+
+	mReqPending = true;
+	++mCntCmds;
+
+	return true;
+}
+
+void ScriptExecuting::processInfo(char *pBuf, char *pBufEnd)
+{
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("Statement\t\t%zu / %zu\n", mIdxStmt, mStmts.size());
+	dInfo("Repeat depth\t\t%zu\n", mRepeats.size());
+	dInfo("Commands sent\t\t%zu\n", mCntCmds);
+}
+
+/* static functions */
+
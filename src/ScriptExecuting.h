@@ -0,0 +1,103 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCRIPT_EXECUTING_H
+#define SCRIPT_EXECUTING_H
+
+#include <string>
+#include <vector>
+
+#include "Processing.h"
+#include "LibScripting.h"
+
+struct RepeatScript
+{
+	size_t idxStmt;
+	uint32_t cntLeft;
+};
+
+class ScriptExecuting : public Processing
+{
+
+public:
+
+	static ScriptExecuting *create()
+	{
+		return new dNoThrow ScriptExecuting;
+	}
+
+	// input
+	std::vector<ScriptStmt> mStmts;
+
+	// output
+	std::string mResult;
+	std::string mErr;
+	size_t mCntCmds;
+	uint32_t mDurationMs;
+
+protected:
+
+	ScriptExecuting();
+	virtual ~ScriptExecuting() {}
+
+private:
+
+	ScriptExecuting(const ScriptExecuting &) = delete;
+	ScriptExecuting &operator=(const ScriptExecuting &) = delete;
+
+	/*
+	 * Naming of functions:  objectVerb()
+	 * Example:              peerAdd()
+	 */
+
+	/* member functions */
+	Success process();
+	Success shutdown();
+	void processInfo(char *pBuf, char *pBufEnd);
+
+	bool stmtExecute(uint32_t curTimeMs);
+	bool commandSend(const std::string &cmd);
+
+	/* member variables */
+	uint32_t mStartMs;
+	uint32_t mStartAllMs;
+	uint32_t mDelayMs;
+	size_t mIdxStmt;
+	std::vector<RepeatScript> mRepeats;
+	uint32_t mIdReq;
+	bool mReqPending;
+	uint32_t mCntTries;
+	std::string mRespLast;
+
+	/* static functions */
+
+	/* static variables */
+
+	/* constants */
+
+};
+
+#endif
+
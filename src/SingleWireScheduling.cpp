@@ -25,6 +25,8 @@
 
 #include "SingleWireScheduling.h"
 #include "SingleWire.h"
+#include "LibTracing.h"
+#include "LibProcHistory.h"
 #include "LibTime.h"
 
 #include "env.h"
@@ -35,6 +37,8 @@
 		gen(StDevUartInit) \
 		gen(StTargetInit) \
 		gen(StTargetInitDoneWait) \
+		gen(StProtoV2Set) \
+		gen(StProtoV2SetWait) \
 		gen(StMain) \
 		gen(StDataRequest) \
 		gen(StTargetRespWait) \
@@ -51,6 +55,8 @@ dProcessStateStr(ProcState);
 #define dForEach_SwtState(gen) \
 		gen(StSwtContentRcvWait) \
 		gen(StSwtDataReceive) \
+		gen(StSwtV2Hdr) \
+		gen(StSwtV2Payload) \
 
 #define dGenSwtStateEnum(s) s,
 dProcessStateEnum(SwtState);
@@ -64,22 +70,60 @@ using namespace std;
 
 #define dDebugCommand	0
 
+const char *cCmdRateRefresh = "procRateSet";
+const char *cCmdRateLog = "logRateSet";
+const char *cCmdBulkCaps = "bulkCaps";
+const char *cCmdSampleStart = "sampleStart";
+const char *cCmdSampleStop = "sampleStop";
+const char *cCmdProtoSet = "protoSet";
+const char *cCmdTagsCaps = "cmdTagCaps";
+const uint32_t cVersionTags = 1;
+const char *cCmdPushSet = "pushSet";
+
 const size_t SingleWireScheduling::cSizeFragmentMax = 4095;
+const size_t SingleWireScheduling::cSizeChunkCmd = 1024;
+const size_t SingleWireScheduling::cSizeChunksCmdMax = 256 << 10;
 const uint32_t SingleWireScheduling::cTimeoutRespMs = 330;
 const uint32_t SingleWireScheduling::cTimeoutDequeueMs = 5500;
+const size_t SingleWireScheduling::cSizeBulkQueuedMax = 64 << 10;
+const uint32_t SingleWireScheduling::cDelayAckBulkMs = 20;
+const uint32_t SingleWireScheduling::cTimeoutBulkMs = 150;
+const uint8_t SingleWireScheduling::cNumResendV2Max = 3;
+const size_t SingleWireScheduling::cNumFramesMissingV2Max = 16;
+const uint32_t SingleWireScheduling::cNumCmdsInFlightMax = 16;
+const uint32_t SingleWireScheduling::cTimeoutCmdInFlightMs = 5000;
+const size_t SingleWireScheduling::cLenTagMax = 4;
+const uint32_t SingleWireScheduling::cIntervalKeepaliveMs = 1000;
+const uint32_t SingleWireScheduling::cDurationSlotBudgetMs = 100;
+const uint8_t SingleWireScheduling::cFactorRateBudgetMax = 64;
+const uint32_t SingleWireScheduling::cRateLinkNominal = 115200 / 10; // 8N1, see LibUart
+const uint8_t SingleWireScheduling::cShareSaturatedBudget = 80;
+const uint32_t SingleWireScheduling::cRateLogBudgetMin = 256;
+const uint32_t SingleWireScheduling::cRateLogBudgetMax = 64 << 10;
 
 uint8_t SingleWireScheduling::monitoring = 1;
 uint8_t SingleWireScheduling::uartVirtualTimeout = 0;
+uint8_t SingleWireScheduling::statsDetailed = 0;
 RefDeviceUart SingleWireScheduling::refUart;
+bool SingleWireScheduling::protoV2Active = false;
 
-list<CommandReqResp> SingleWireScheduling::requestsCmd[3];
+list<CommandReqResp> SingleWireScheduling::requestsCmd[cNumPrioCmd];
+list<CommandReqResp> SingleWireScheduling::cmdsInFlight;
 list<CommandReqResp> SingleWireScheduling::responsesCmd;
+list<ChunkResp> SingleWireScheduling::chunksCmd;
+size_t SingleWireScheduling::sizeChunksCmd = 0;
+size_t SingleWireScheduling::cntBytesChunkDropped = 0;
 uint32_t SingleWireScheduling::idReqCmdNext = 0;
 mutex SingleWireScheduling::mtxRequests;
 mutex SingleWireScheduling::mtxResponses;
+TransferBulk SingleWireScheduling::xferBulk;
+uint8_t SingleWireScheduling::idXferBulkNext = 1;
+uint32_t SingleWireScheduling::windowBulk = 0;
+uint32_t SingleWireScheduling::sizeChunkBulk = 0;
 
 SingleWireScheduling::SingleWireScheduling()
 	: Processing("SingleWireScheduling")
+	, mCmdsDoneReport(false)
 	, mDevUartIsOnline(false)
 	, mTargetIsOnline(false)
 	, mContentProc("")
@@ -98,12 +142,95 @@ SingleWireScheduling::SingleWireScheduling()
 	, mContentIgnore(false)
 	, mCmdExpected(false)
 	, mByteLast(0)
-	, mpListCmdCurrent(NULL)
+	, mIdReqCurrent(0)
+	, mStreamedCurrent(false)
+	, mChunksDroppedCurrent(false)
+	, mRespCmdMatched(false)
+	, mTagRespPending(false)
+	, mRespStreamed(false)
+	, mCntBytesStreamed(0)
+	, mCntRespTruncated(0)
+	, mRateRefreshReqMs(0)
+	, mIdReqRate(0)
+	, mStartRateMs(0)
+	, mRatePending(false)
+	, mRateTargetAck(false)
+	, mRateLogReq(0)
+	, mIdReqRateLog(0)
+	, mStartRateLogMs(0)
+	, mRateLogPending(false)
+	, mRateLogTargetAck(false)
+	, mIdReqBulk(0)
+	, mStartBulkMs(0)
+	, mBulkPending(false)
+	, mBulkNegotiated(false)
+	, mTagsActive(false)
+	, mNumCmdsInFlightMax(1)
+	, mTagNext(0)
+	, mIdReqTags(0)
+	, mStartTagsMs(0)
+	, mTagsPending(false)
+	, mTagsNegotiated(false)
+	, mNumCmdsInFlightPeak(0)
+	, mCntCmdsTimedOut(0)
+	, mCntRespUnmatched(0)
+	, mVerSampleReq(0)
+	, mIdReqSample(0)
+	, mStartSampleMs(0)
+	, mSamplePending(false)
+	, mIdSetSample(0)
+	, mSymbolsSample()
 	, mCntDelayPrioLow(0)
 	, mCntRerequest(0)
+	, mProtoV2(false)
+	, mLenHdrV2(0)
+	, mFrmV2()
+	, mPayloadV2()
+	, mSeqRxV2(0)
+	, mSeqTxV2(0)
+	, mCntResendV2(0)
+	, mCntFramesV2(0)
+	, mCntErrHdrV2(0)
+	, mCntErrCrcV2(0)
+	, mCntGapsV2(0)
+	, mCntResendsV2(0)
+	, mFramesMissingV2()
+	, mCntRecoveredV2(0)
+	, mCntLostV2(0)
+	, mPushActive(false)
+	, mPushReq(false)
+	, mPushPending(false)
+	, mPushUnsupported(false)
+	, mIdReqPush(0)
+	, mStartPushMs(0)
+	, mLastRcvdMs(0)
+	, mCntBytesSent(0)
+	, mCntDataRequests(0)
+	, mUsage()
+	, mUsageLast()
+	, mSpecBudget("")
+	, mBytesBudgetWindow(0)
+	, mBytesBudgetCapacity(0)
+	, mSaturatedBudget(false)
+	, mIdxSlotBudget(0)
+	, mIdxBudgetRcv(cNumClassesBudget)
+	, mStartSlotBudgetMs(0)
+	, mLastRateBudgetMs(0)
+	, mFactorRateBudget(1)
+	, mRateLogBudget(0)
+	, mpProfTick(profilingTickRegister("GwSupervising;GwMsgDispatching;SingleWireScheduling"))
 {
 	responseReset();
 	mBufRcv[0] = 0;
+	mHdrV2[0] = 0;
+
+	budgetParse("", mShareMin, mShareMax);
+
+	memset(mShareMaxEff, 100, sizeof(mShareMaxEff));
+	memset(mShare, 0, sizeof(mShare));
+	memset(mThrottled, 0, sizeof(mThrottled));
+	memset(mBytesBudgetCur, 0, sizeof(mBytesBudgetCur));
+	memset(mBytesBudget, 0, sizeof(mBytesBudget));
 
 	mState = StStart;
 }
@@ -112,9 +239,12 @@ SingleWireScheduling::SingleWireScheduling()
 
 Success SingleWireScheduling::process()
 {
+	ProfilingTickScope profTick(mpProfTick);
 	uint32_t curTimeMs = millis();
 	uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
+	size_t numInFlight;
+	bool pollNeeded;
 	bool ok;
 #if 0
 	dStateTrace;
@@ -166,12 +296,28 @@ Success SingleWireScheduling::process()
 
 		targetOnlineSet(false);
 
+		// Init code is v1 framed and resets the target to v1
+		mProtoV2 = false;
+		protoV2Active = false;
+
 		if (env.ctrlManual)
 		{
 			mState = StCtrlManual;
 			break;
 		}
 
+		if (uartVirtual && uartVirtualMode == UartVirtModeReplay)
+		{
+			// recording may not contain the handshake
+			mFragments.clear();
+			mStateSwt = StSwtContentRcvWait;
+
+			targetOnlineSet();
+
+			mState = StMain;
+			break;
+		}
+
 		ok = cmdSend(env.codeUart);
 		if (!ok)
 		{
@@ -222,29 +368,94 @@ Success SingleWireScheduling::process()
 			break;
 		}
 
-		if (mResp.content != "Debug mode 1")
+		if (mResp.content == "Debug mode 2" && !env.protoV1Only)
 		{
 			responseReset();
+
+			mState = StProtoV2Set;
 			break;
 		}
 
-		responseReset();
+		if (mResp.content != "Debug mode 1" &&
+				mResp.content != "Debug mode 2")
+		{
+			responseReset();
+			break;
+		}
+
+		targetConnected();
 
-		targetOnlineSet();
+		break;
+	case StProtoV2Set:
 
+		ok = cmdSend(string(cCmdProtoSet) + " " + to_string(cVersionProto));
+		if (!ok)
 		{
-			Guard lock(mtxRequests);
-			for (size_t i = 0; i < sizeof(requestsCmd) / sizeof(*requestsCmd); ++i)
-				requestsCmd[i].clear();
+			mState = StUartInit;
+			break;
 		}
+
+		ok = dataRequest();
+		if (!ok)
 		{
-			Guard lock(mtxResponses);
-			responsesCmd.clear();
+			mState = StUartInit;
+			break;
+		}
+
+		mStartMs = curTimeMs;
+		mState = StProtoV2SetWait;
+
+		break;
+	case StProtoV2SetWait:
+
+		if ((!uartVirtual && diffMs > cTimeoutRespMs) ||
+			(uartVirtual && uartVirtualTimeout))
+		{
+			mState = StTargetInit;
+			break;
 		}
 
-		mpListCmdCurrent = NULL;
+		success = contentReceive();
+		if (success == Pending)
+			break;
 
-		mState = StMain;
+		if (success != Positive)
+		{
+			mState = StUartInit;
+			break;
+		}
+
+		// Already in debug mode. Answer may follow other content
+		if (mResp.idContent != IdContentTaToScCmd)
+		{
+			responseReset();
+
+			ok = dataRequest();
+			if (!ok)
+				mState = StUartInit;
+
+			break;
+		}
+
+		if (mResp.content == "Proto " + to_string(cVersionProto))
+		{
+			mProtoV2 = true;
+			protoV2Active = true;
+
+			mSeqRxV2 = 0;
+			mSeqTxV2 = 0;
+			mCntResendV2 = 0;
+			mFramesMissingV2.clear();
+
+			mFragments.clear();
+			mStateSwt = StSwtContentRcvWait;
+
+			procDbgLog("using SingleWire v%u", cVersionProto);
+		}
+		else
+			procDbgLog("SingleWire v%u refused by target", cVersionProto);
+
+		targetConnected();
 
 		break;
 	case StMain:
@@ -258,6 +469,9 @@ Success SingleWireScheduling::process()
 		}
 
 		cmdResponsesClear(curTimeMs);
+		cmdsInFlightCheck(curTimeMs);
+		linkUsageUpdate(curTimeMs);
+		budgetUpdate(curTimeMs);
 
 		// communication to target
 
@@ -271,10 +485,30 @@ Success SingleWireScheduling::process()
 		if (success == Positive)
 			responseReset();
 
-		success = cmdQueueConsume();
+		tagsNegotiate(curTimeMs);
+		pushNegotiate(curTimeMs);
+		rateRefreshNegotiate(curTimeMs);
+		rateLogNegotiate(curTimeMs);
+		bulkNegotiate(curTimeMs);
+		sampleNegotiate(curTimeMs);
+
+		ok = bulkAckSend(curTimeMs);
+		if (!ok)
+		{
+			mState = StUartInit;
+			break;
+		}
+
+		// Over budget: Commands wait in the queue
+		success = Pending;
+
+		if (!mThrottled[ClassBudgetCmd])
+			success = cmdQueueConsume();
+
 		if (success == Positive)
 		{
-			mCmdExpected = true;
+			// Tagged responses are collected by the next data requests
+			mCmdExpected = !mTagsActive;
 			mCntRerequest = 0;
 
 			mStartMs = curTimeMs;
@@ -288,7 +522,21 @@ Success SingleWireScheduling::process()
 			break;
 		}
 
-		if (monitoring)
+		{
+			Guard lock(mtxRequests);
+			numInFlight = cmdsInFlight.size();
+		}
+
+		// Chunks, samples and tagged responses are delivered on data requests only
+		pollNeeded = bulkActive() || sampleActive() || numInFlight;
+
+		// Target sends logs and trees by itself. Poll only for liveness
+		if (mPushActive)
+			pollNeeded |= curTimeMs - mLastRcvdMs > cIntervalKeepaliveMs;
+		else
+			pollNeeded |= monitoring && (!mThrottled[ClassBudgetLog] || mRateLogTargetAck);
+
+		if (pollNeeded)
 		{
 			mCmdExpected = false;
 
@@ -315,6 +563,22 @@ Success SingleWireScheduling::process()
 		if ((!uartVirtual && diffMs > cTimeoutRespMs) ||
 			(uartVirtual && uartVirtualTimeout))
 		{
+			// Frame or request lost. Target sends it again
+			if (mProtoV2 && mCntResendV2 < cNumResendV2Max)
+			{
+				++mCntResendV2;
+
+				ok = frameResendRequest(mSeqRxV2);
+				if (!ok)
+				{
+					mState = StUartInit;
+					break;
+				}
+
+				mStartMs = curTimeMs;
+				break;
+			}
+
 			//procErrLog(-1, "response timeout");
 			mState = StTargetInit;
 			break;
@@ -330,6 +594,17 @@ Success SingleWireScheduling::process()
 			break;
 		}
 
+		// Target prefers commands. Binary content means response not ready yet
+		if (mCmdExpected && (mResp.idContent == IdContentTaToScBulk ||
+					mResp.idContent == IdContentTaToScSample))
+		{
+			responseReset();
+
+			mStartMs = curTimeMs;
+			mState = StDataRequest;
+			break;
+		}
+
 		if (mCmdExpected && mResp.idContent != IdContentTaToScCmd)
 		{
 			procWrnLog("re-request");
@@ -343,8 +618,12 @@ Success SingleWireScheduling::process()
 				break;
 			}
 
-			mpListCmdCurrent->pop_front();
-			mpListCmdCurrent = NULL;
+			{
+				Guard lock(mtxRequests);
+
+				if (cmdsInFlight.size())
+					cmdsInFlight.pop_front();
+			}
 
 			mState = StMain;
 			break;
@@ -372,6 +651,74 @@ Success SingleWireScheduling::process()
 	return Pending;
 }
 
+/*
+ * Target is in debug mode and the protocol is settled.
+ * Everything negotiated before is lost on the target.
+ */
+void SingleWireScheduling::targetConnected()
+{
+	responseReset();
+
+	targetOnlineSet();
+
+	{
+		Guard lock(mtxRequests);
+		for (size_t i = 0; i < sizeof(requestsCmd) / sizeof(*requestsCmd); ++i)
+			requestsCmd[i].clear();
+
+		cmdsInFlight.clear();
+	}
+	{
+		Guard lock(mtxResponses);
+		responsesCmd.clear();
+	}
+
+	mRespCmdMatched = false;
+	mTagRespPending = false;
+
+	mTagsActive = false;
+	mNumCmdsInFlightMax = 1;
+	mTagsPending = false;
+	mTagsNegotiated = false;
+
+	mPushActive = false;
+	mPushReq = false;
+	mPushPending = false;
+	mPushUnsupported = false;
+	mLastRcvdMs = millis();
+
+	// Offline time isn't link usage
+	mUsageLast.durationMs = mLastRcvdMs;
+
+	mRateRefreshReqMs = 0;
+	mRatePending = false;
+	mRateTargetAck = false;
+
+	mRateLogReq = 0;
+	mRateLogPending = false;
+	mRateLogTargetAck = false;
+
+	mBulkPending = false;
+	mBulkNegotiated = false;
+
+	{
+		Guard lock(mtxResponses);
+
+		windowBulk = 0;
+		sizeChunkBulk = 0;
+
+		// Target lost the transfer state
+		xferBulk.active = false;
+	}
+
+	// Sampling is restarted with the current configuration
+	mVerSampleReq = 0;
+	mSamplePending = false;
+	sampleSetStop("");
+
+	mState = StMain;
+}
+
 bool SingleWireScheduling::contentProcChanged()
 {
 	bool tmp = mContentProcChanged;
@@ -379,58 +726,265 @@ bool SingleWireScheduling::contentProcChanged()
 	return tmp;
 }
 
+/*
+ * Commands are moved to the in-flight list when sent. Without
+ * tags the target answers in order and only one command is
+ * sent at a time. Tagged commands are limited by the number
+ * negotiated with the target.
+ */
 Success SingleWireScheduling::cmdQueueConsume()
 {
-	if (mpListCmdCurrent)
-		return Pending;
+	list<CommandReqResp> *pList = NULL;
+	string cmd;
+	bool ok;
 
 	Guard lock(mtxRequests);
 
+	if (cmdsInFlight.size() >= mNumCmdsInFlightMax)
+		return Pending;
+
+	if (requestsCmd[PrioSysHigh].size())
+		pList = &requestsCmd[PrioSysHigh];
+	else
 	if (requestsCmd[PrioUser].size())
-		mpListCmdCurrent = &requestsCmd[PrioUser];
+		pList = &requestsCmd[PrioUser];
+	else
+	if (requestsCmd[PrioSysBatch].size())
+		pList = &requestsCmd[PrioSysBatch];
 	else
 	if (requestsCmd[PrioSysLow].size())
 	{
 		if (monitoring && mCntDelayPrioLow)
 			return Pending;
 
-		mpListCmdCurrent = &requestsCmd[PrioSysLow];
+		pList = &requestsCmd[PrioSysLow];
 		mCntDelayPrioLow = 4;
 	}
 
-	if (!mpListCmdCurrent)
+	if (!pList)
 		return Pending;
 
-	const CommandReqResp *pReq = &mpListCmdCurrent->front();
-	bool ok;
+	CommandReqResp &req = pList->front();
+
+	// Queued while v2 was active. Can't be framed in v1
+	ok = true;
+	for (size_t i = 0; !mProtoV2 && i < req.str.size() && ok; ++i)
+		ok = !isCtrl(req.str[i]);
 
-	ok = cmdSend(pReq->str);
 	if (!ok)
 	{
-		mpListCmdCurrent = NULL;
-		return -1;
+		procWrnLog("dropping command with control bytes");
+
+		pList->pop_front();
+
+		return Pending;
+	}
+
+	cmd = req.str;
+
+	if (mTagsActive)
+	{
+		req.tag = cmdTagNext();
+		cmd = "@" + to_string(req.tag) + " " + cmd;
 	}
 
+	ok = cmdSend(cmd);
+	if (!ok)
+		return -1;
+
+	req.sentMs = millis();
+	cmdTraceMark(req.idReq, CmdTraceUartSent);
+
+	cmdsInFlight.splice(cmdsInFlight.end(), *pList, pList->begin());
+
+	if (cmdsInFlight.size() > mNumCmdsInFlightPeak)
+		mNumCmdsInFlightPeak = cmdsInFlight.size();
+
 	return Positive;
 }
 
+// Tag 0 is not used. Caller holds mtxRequests
+uint8_t SingleWireScheduling::cmdTagNext()
+{
+	list<CommandReqResp>::const_iterator iter;
+	bool used = true;
+
+	while (used)
+	{
+		++mTagNext;
+		if (!mTagNext)
+			mTagNext = 1;
+
+		used = false;
+
+		iter = cmdsInFlight.begin();
+		for (; iter != cmdsInFlight.end() && !used; ++iter)
+			used = iter->tag == mTagNext;
+	}
+
+	return mTagNext;
+}
+
+/*
+ * Called when a command response starts. Without tags it
+ * belongs to the oldest command in flight. Otherwise the tag
+ * must be received first.
+ */
+void SingleWireScheduling::cmdRespStart()
+{
+	mRespCmdMatched = false;
+	mTagRespPending = mTagsActive;
+
+	if (!mTagsActive)
+		cmdRespBegin(0);
+}
+
+void SingleWireScheduling::cmdRespBegin(uint8_t tag)
+{
+	Guard lock(mtxRequests);
+
+	list<CommandReqResp>::const_iterator iter;
+
+	iter = cmdsInFlight.begin();
+	for (; iter != cmdsInFlight.end(); ++iter)
+	{
+		if (mTagsActive && iter->tag != tag)
+			continue;
+
+		mIdReqCurrent = iter->idReq;
+		mStreamedCurrent = iter->streamed && !iter->cancelled;
+		mChunksDroppedCurrent = false;
+		mRespCmdMatched = true;
+
+		cmdTraceMark(mIdReqCurrent, CmdTraceRespFirst);
+
+		return;
+	}
+}
+
+// Expected: @<tag>
+void SingleWireScheduling::cmdRespTagged(const string &str)
+{
+	unsigned int tag;
+	int res;
+
+	mTagRespPending = false;
+
+	res = sscanf(str.c_str(), "@%u", &tag);
+	if (res == 1 && tag && tag <= 0xFF)
+		cmdRespBegin((uint8_t)tag);
+
+	if (!mRespCmdMatched)
+		++mCntRespUnmatched;
+}
+
+/*
+ * Tagged commands are answered in any order. The target may
+ * drop them on reset. They are removed after a while to free
+ * the tag.
+ */
+void SingleWireScheduling::cmdsInFlightCheck(uint32_t curTimeMs)
+{
+	Guard lock(mtxRequests);
+
+	list<CommandReqResp>::iterator iter;
+
+	iter = cmdsInFlight.begin();
+	while (iter != cmdsInFlight.end())
+	{
+		if (curTimeMs - iter->sentMs < cTimeoutCmdInFlightMs ||
+				(mRespCmdMatched && iter->idReq == mIdReqCurrent))
+		{
+			++iter;
+			continue;
+		}
+
+		procDbgLog("no response for: %s", iter->str.c_str());
+		++mCntCmdsTimedOut;
+
+		iter = cmdsInFlight.erase(iter);
+	}
+}
+
 void SingleWireScheduling::cmdResponseReceived(const string &resp)
 {
-	if (!mpListCmdCurrent)
+	// Response shorter than the tag
+	if (mTagRespPending)
+	{
+		cmdRespTagged(resp);
+		cmdResponseReceived("");
 		return;
+	}
 #if 0
 	procWrnLog("command response received: %s",
 				resp.c_str());
 #endif
+	list<CommandReqResp>::iterator iter;
 	uint32_t idReq;
+	bool streamed, cancelled;
 
 	{
 		Guard lock(mtxRequests);
 
-		idReq = mpListCmdCurrent->front().idReq;
-		mpListCmdCurrent->pop_front();
+		if (!mTagsActive && cmdsInFlight.size())
+		{
+			mIdReqCurrent = cmdsInFlight.front().idReq;
+			mRespCmdMatched = true;
+		}
+
+		if (!mRespCmdMatched)
+			return;
+		mRespCmdMatched = false;
+
+		iter = cmdsInFlight.begin();
+		for (; iter != cmdsInFlight.end(); ++iter)
+		{
+			if (iter->idReq == mIdReqCurrent)
+				break;
+		}
+
+		// Timed out in the meantime
+		if (iter == cmdsInFlight.end())
+			return;
+
+		idReq = iter->idReq;
+		cancelled = iter->cancelled;
+
+		if (mCmdsDoneReport && !cancelled)
+		{
+			CommandDone done;
+
+			done.idReq = idReq;
+			done.cmd = iter->str;
+			done.resp = resp;
+			done.durationMs = millis() - iter->startMs;
+
+			if (mStreamedCurrent)
+				done.resp = "<streamed: " + to_string(mCntBytesStreamed + resp.size()) + " bytes>";
+
+			ppCmdsDone.commit(done);
+		}
+
+		cmdsInFlight.erase(iter);
+	}
+
+	streamed = mStreamedCurrent;
+	mStreamedCurrent = false;
+
+	if (cancelled)
+	{
+		mCntBytesStreamed = 0;
+		return;
+	}
+
+	cmdTraceMark(idReq, CmdTraceRespEnd);
+
+	if (streamed)
+	{
+		cmdChunkCommit(resp, true);
+		mCntBytesStreamed = 0;
 
-		mpListCmdCurrent = NULL;
+		return;
 	}
 
 	{
@@ -440,6 +994,51 @@ void SingleWireScheduling::cmdResponseReceived(const string &resp)
 	}
 }
 
+/*
+ * Chunks of streamed responses are handed over as they
+ * arrive. Consumers are expected to fetch them every tick.
+ * If they don't, the rest of the response is dropped instead
+ * of letting the memory grow with it. The last chunk is
+ * marked as truncated, so the consumer can report it.
+ */
+void SingleWireScheduling::cmdChunkCommit(const string &data, bool last)
+{
+	ChunkResp chunk;
+
+	if (!last)
+		mCntBytesStreamed += data.size();
+
+	Guard lock(mtxResponses);
+
+	if (!last && (mChunksDroppedCurrent ||
+			sizeChunksCmd + data.size() > cSizeChunksCmdMax))
+	{
+		if (!mChunksDroppedCurrent)
+			procWrnLog("response not fetched fast enough. Dropping rest");
+
+		mChunksDroppedCurrent = true;
+		cntBytesChunkDropped += data.size();
+
+		return;
+	}
+
+	chunk.idReq = mIdReqCurrent;
+	chunk.last = last;
+	chunk.truncated = last && mChunksDroppedCurrent;
+	chunk.createdMs = millis();
+
+	if (!chunk.truncated)
+		chunk.data = data;
+	else
+		cntBytesChunkDropped += data.size();
+
+	if (last)
+		mChunksDroppedCurrent = false;
+
+	sizeChunksCmd += chunk.data.size();
+	chunksCmd.push_back(chunk);
+}
+
 void SingleWireScheduling::cmdResponsesClear(uint32_t curTimeMs)
 {
 	Guard lock(mtxResponses);
@@ -463,19 +1062,43 @@ void SingleWireScheduling::cmdResponsesClear(uint32_t curTimeMs)
 #endif
 		iter = responsesCmd.erase(iter);
 	}
-}
 
-bool SingleWireScheduling::cmdSend(const string &cmd)
-{
-	bool failed = false;
+	list<ChunkResp>::iterator iterChunk;
 
-	failed |= uartSend(mRefUart, FlowSchedToTarget) < 0;
-	failed |= uartSend(mRefUart, IdContentScToTaCmd) < 0;
-	failed |= uartSend(mRefUart, cmd.data(), cmd.size()) < 0;
-	failed |= uartSend(mRefUart, 0x00) < 0;
-	failed |= uartSend(mRefUart, IdContentEnd) < 0;
+	iterChunk = chunksCmd.begin();
+	while (iterChunk != chunksCmd.end())
+	{
+		diffMs = curTimeMs - iterChunk->createdMs;
 
-	if (failed)
+		if (diffMs < cTimeoutDequeueMs)
+		{
+			++iterChunk;
+			continue;
+		}
+
+		sizeChunksCmd -= iterChunk->data.size();
+		iterChunk = chunksCmd.erase(iterChunk);
+	}
+}
+
+bool SingleWireScheduling::cmdSend(const string &cmd)
+{
+	bool failed = false;
+
+	if (mProtoV2)
+		failed |= !frameV2Send(IdContentScToTaCmd, cmd);
+	else
+	{
+		failed |= uartSend(mRefUart, FlowSchedToTarget) < 0;
+		failed |= uartSend(mRefUart, IdContentScToTaCmd) < 0;
+		failed |= uartSend(mRefUart, cmd.data(), cmd.size()) < 0;
+		failed |= uartSend(mRefUart, 0x00) < 0;
+		failed |= uartSend(mRefUart, IdContentEnd) < 0;
+
+		mCntBytesSent += cmd.size() + 4;
+	}
+
+	if (failed)
 		return false;
 
 	procDbgLog("cmd sent: %s", cmd.c_str());
@@ -487,11 +1110,22 @@ bool SingleWireScheduling::dataRequest()
 {
 	ssize_t lenWritten;
 
-	lenWritten = uartSend(mRefUart, FlowTargetToSched);
-	if (lenWritten < 0)
-		return false;
+	if (mProtoV2)
+	{
+		if (!frameV2Send(FlowTargetToSched, ""))
+			return false;
+	}
+	else
+	{
+		lenWritten = uartSend(mRefUart, FlowTargetToSched);
+		if (lenWritten < 0)
+			return false;
+
+		++mCntBytesSent;
+	}
 
 	//procWrnLog("data requested");
+	++mCntDataRequests;
 
 	if (mCntDelayPrioLow)
 	{
@@ -533,6 +1167,8 @@ Success SingleWireScheduling::contentDistribute()
 
 			mContentProc = mResp.content;
 			mContentProcChanged = true;
+
+			procHistAdd(mContentProc);
 		}
 
 		if (mResp.idContent == IdContentTaToScLog)
@@ -541,6 +1177,12 @@ Success SingleWireScheduling::contentDistribute()
 		if (mResp.idContent == IdContentTaToScCmd)
 			cmdResponseReceived(mResp.content);
 
+		if (mResp.idContent == IdContentTaToScBulk)
+			bulkChunkReceived(mResp.content, millis());
+
+		if (mResp.idContent == IdContentTaToScSample)
+			sampleFrameAdd(mResp.content, sampleNowUs());
+
 		if (!mResp.unsolicited)
 			return Positive;
 
@@ -563,6 +1205,9 @@ Success SingleWireScheduling::contentReceive()
 		{
 			mLenDone = uartRead(mRefUart, mBufRcv, sizeof(mBufRcv));
 			mpBuf = mBufRcv;
+
+			if (mLenDone > 0)
+				mLastRcvdMs = curTimeMs;
 		}
 
 		if (!mLenDone)
@@ -578,6 +1223,18 @@ Success SingleWireScheduling::contentReceive()
 			return -1;
 		}
 
+		if (mProtoV2)
+		{
+			success = frameV2Process(curTimeMs);
+			if (success == Positive)
+				return Positive;
+
+			if (success != Pending)
+				return success;
+
+			continue;
+		}
+
 		// Process data
 		while (mLenDone > 0)
 		{
@@ -597,12 +1254,12 @@ Success SingleWireScheduling::contentReceive()
 
 Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 {
-	uint32_t diffMs = curTimeMs - mLastProcTreeRcvdMs;
 #if 0
 	procInfLog("received byte in %s: 0x%02X '%c'",
 				SwtStateString[mStateSwt], ch, ch);
 #endif
 	++mCntBytesRcvd;
+	++mBytesBudgetCur[mStateSwt == StSwtDataReceive ? mIdxBudgetRcv : cNumClassesBudget];
 
 	switch (mStateSwt)
 	{
@@ -618,11 +1275,13 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 			return Positive;
 		}
 
-		if (ch < IdContentTaToScProc || ch > IdContentTaToScCmd)
+		if ((ch < IdContentTaToScProc || ch > IdContentTaToScCmd) &&
+				ch != IdContentTaToScBulk && ch != IdContentTaToScSample)
 			break;
 
 		responseReset(ch);
 		mContentIgnore = false;
+		mIdxBudgetRcv = budgetIdx(ch);
 
 		if (mByteLast == IdContentUnsolicited)
 		{
@@ -630,17 +1289,22 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 			mResp.unsolicited = true;
 		}
 
+		// Continued after cut: Already matched
+		if (ch == IdContentTaToScCmd && mFragments.find(ch) == mFragments.end())
+			cmdRespStart();
+
+		mRespStreamed = ch == IdContentTaToScCmd &&
+					!mResp.unsolicited && mRespCmdMatched &&
+					mStreamedCurrent;
+
 		if (ch != IdContentTaToScProc)
 		{
 			mStateSwt = StSwtDataReceive;
 			break;
 		}
 
-		// Process Tree filter
-
-		if (diffMs > env.rateRefreshMs)
+		if (!procTreeFiltered(curTimeMs))
 		{
-			mLastProcTreeRcvdMs = curTimeMs;
 			mStateSwt = StSwtDataReceive;
 			break;
 		}
@@ -681,43 +1345,1177 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 	return Pending;
 }
 
-Success SingleWireScheduling::shutdown()
+// Process Tree filter
+bool SingleWireScheduling::procTreeFiltered(uint32_t curTimeMs)
 {
+	uint32_t diffMs = curTimeMs - mLastProcTreeRcvdMs;
 
-	if (mRefUart != RefDeviceUartInvalid)
+	// Target honoring our rate: Only catch excess trees
+	if (diffMs > (mRateTargetAck ? rateRefreshMs() >> 1 : rateRefreshMs()))
 	{
-		devUartDeInit(mRefUart);
-		refUart = mRefUart;
+		mLastProcTreeRcvdMs = curTimeMs;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * v2 frames carry their length. Payloads are copied in
+ * blocks instead of being scanned byte by byte. A bad
+ * header is dropped up to the next start of frame byte.
+ */
+Success SingleWireScheduling::frameV2Process(uint32_t curTimeMs)
+{
+	size_t len, i;
+	bool ok;
+
+	while (mLenDone > 0)
+	{
+		switch (mStateSwt)
+		{
+		case StSwtContentRcvWait:
+
+			mByteLast = (uint8_t)*mpBuf;
+
+			--mLenDone;
+			++mpBuf;
+			++mCntBytesRcvd;
+
+			if (mByteLast != cSofV2)
+				break;
+
+			mHdrV2[0] = cSofV2;
+			mLenHdrV2 = 1;
+
+			mStateSwt = StSwtV2Hdr;
+
+			break;
+		case StSwtV2Hdr:
+
+			len = cLenFrameV2Hdr - mLenHdrV2;
+			if (len > (size_t)mLenDone)
+				len = mLenDone;
+
+			memcpy(mHdrV2 + mLenHdrV2, mpBuf, len);
+			mLenHdrV2 += len;
+
+			mLenDone -= len;
+			mpBuf += len;
+			mCntBytesRcvd += len;
+
+			if (mLenHdrV2 < cLenFrameV2Hdr)
+				break;
+
+			ok = frameV2HdrDecode(mHdrV2, mFrmV2);
+			if (!ok)
+			{
+				++mCntErrHdrV2;
+
+				for (i = 1; i < cLenFrameV2Hdr && mHdrV2[i] != cSofV2; ++i)
+					;
+
+				mLenHdrV2 = cLenFrameV2Hdr - i;
+				memmove(mHdrV2, mHdrV2 + i, mLenHdrV2);
+
+				if (!mLenHdrV2)
+					mStateSwt = StSwtContentRcvWait;
+
+				break;
+			}
+
+			mPayloadV2.clear();
+			mPayloadV2.reserve(mFrmV2.len + cLenFrameV2Crc);
+
+			mBytesBudgetCur[budgetIdx(mFrmV2.type)] +=
+					cLenFrameV2Hdr + mFrmV2.len + cLenFrameV2Crc;
+
+			mStateSwt = StSwtV2Payload;
+
+			break;
+		case StSwtV2Payload:
+
+			len = mFrmV2.len + cLenFrameV2Crc - mPayloadV2.size();
+			if (len > (size_t)mLenDone)
+				len = mLenDone;
+
+			mPayloadV2.append(mpBuf, len);
+
+			mLenDone -= len;
+			mpBuf += len;
+			mCntBytesRcvd += len;
+
+			if (mPayloadV2.size() < mFrmV2.len + cLenFrameV2Crc)
+				break;
+
+			mStateSwt = StSwtContentRcvWait;
+
+			if (frameV2Finish(curTimeMs) == Positive)
+				return Positive;
+
+			break;
+		default:
+			break;
+		}
+	}
+
+	return Pending;
+}
+
+/*
+ * Frames skipped in seq and frames with a bad payload are
+ * requested again one by one. They arrive after newer
+ * frames and are only accepted while listed as missing.
+ */
+Success SingleWireScheduling::frameV2Finish(uint32_t curTimeMs)
+{
+	uint8_t type = mFrmV2.type;
+	uint8_t seq = mFrmV2.seq;
+	uint8_t diff = seq - mSeqRxV2;
+	list<uint8_t>::iterator iter;
+	size_t idx;
+	bool ok;
+
+	ok = frameV2PayloadCheck(mPayloadV2);
+	if (!ok)
+		++mCntErrCrcV2;
+
+	if (diff < 0x80)
+	{
+		mCntGapsV2 += diff;
+
+		if (diff > cNumFramesMissingV2Max)
+		{
+			mCntLostV2 += diff - cNumFramesMissingV2Max;
+			mSeqRxV2 = seq - (uint8_t)cNumFramesMissingV2Max;
+		}
+
+		for (; mSeqRxV2 != seq; ++mSeqRxV2)
+			frameMissingAdd(mSeqRxV2, curTimeMs);
+
+		mSeqRxV2 = seq + 1;
+
+		if (!ok)
+		{
+			frameMissingAdd(seq, curTimeMs);
+			return Pending;
+		}
+	}
+	else
+	{
+		iter = mFramesMissingV2.begin();
+		while (iter != mFramesMissingV2.end() && *iter != seq)
+			++iter;
+
+		// Sent again after a resend request we didn't need
+		if (iter == mFramesMissingV2.end())
+			return Pending;
+
+		if (!ok)
+		{
+			if (mCntResendV2 >= cNumResendV2Max)
+				return Pending;
+
+			++mCntResendV2;
+			frameResendRequest(seq);
+
+			mStartMs = curTimeMs;
+
+			return Pending;
+		}
+
+		mFramesMissingV2.erase(iter);
+		++mCntRecoveredV2;
+	}
+
+	mCntResendV2 = 0;
+	++mCntFramesV2;
+
+	mPayloadV2.resize(mFrmV2.len);
+
+	if (type == IdContentTaToScNone)
+	{
+		++mCntContentNoneRcvd;
+
+		responseReset();
+
+		return Positive;
+	}
+
+	if ((type < IdContentTaToScProc || type > IdContentTaToScCmd) &&
+			type != IdContentTaToScBulk && type != IdContentTaToScSample)
+	{
+		responseReset();
+		return Positive;
+	}
+
+	responseReset(type);
+	mResp.unsolicited = mFrmV2.flags & FlagFrameUnsolicited;
+
+	if (type == IdContentTaToScProc && procTreeFiltered(curTimeMs))
+	{
+		responseReset();
+		return Positive;
+	}
+
+	if (type == IdContentTaToScCmd)
+	{
+		cmdRespStart();
+
+		if (mTagRespPending)
+		{
+			idx = mPayloadV2.find(' ');
+			cmdRespTagged(mPayloadV2.substr(0, idx));
+			mPayloadV2.erase(0, idx == string::npos ? idx : idx + 1);
+		}
+
+		// Same chunks as in v1. Last part is passed as response
+		if (!mResp.unsolicited && mRespCmdMatched && mStreamedCurrent)
+		{
+			for (idx = 0; mPayloadV2.size() - idx > cSizeChunkCmd; idx += cSizeChunkCmd)
+				cmdChunkCommit(mPayloadV2.substr(idx, cSizeChunkCmd), false);
+
+			mPayloadV2.erase(0, idx);
+		}
 	}
 
+	mResp.content = move(mPayloadV2);
+	mPayloadV2.clear();
+
 	return Positive;
 }
 
-void SingleWireScheduling::processInfo(char *pBuf, char *pBufEnd)
+bool SingleWireScheduling::frameV2Send(uint8_t type, const string &payload)
 {
-	dInfo("Manual control\t\t%sabled\n", env.ctrlManual ? "En" : "Dis");
-	dInfo("Monitoring\t\t%sabled\n", monitoring ? "En" : "Dis");
-#if 1
-	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
-#endif
-#if 1
-	dInfo("State SWT\t\t\t%s\n", SwtStateString[mStateSwt]);
-#endif
-	dInfo("Virtual UART mode\t\t%s\n", uartVirtualMode ? "uart" : "swart");
-	dInfo("Virtual UART\t\t%sabled\n", uartVirtual ? "En" : "Dis");
-	dInfo("UART: %s\t%sline\n",
-			env.deviceUart.c_str(),
-			mDevUartIsOnline ? "On" : "Off");
-	dInfo("Target\t\t\t%sline\n", mTargetIsOnline ? "On" : "Off");
-	dInfo("Bytes received\t\t%zu\n", mCntBytesRcvd);
-	dInfo("Content 'none' received\t%zu\n", mCntContentNoneRcvd);
-#if 0
-	fragmentsPrint(pBuf, pBufEnd);
-#endif
-#if 0
-	queuesCmdPrint(pBuf, pBufEnd);
-#endif
+	FrameHdrV2 hdr;
+	string frame;
+
+	hdr.type = type;
+	hdr.flags = 0;
+	hdr.seq = mSeqTxV2++;
+	hdr.len = payload.size();
+
+	frameV2Encode(hdr, payload, frame);
+
+	mCntBytesSent += frame.size();
+
+	return uartSend(mRefUart, frame.data(), frame.size()) >= 0;
 }
 
-/* static functions */
+void SingleWireScheduling::frameMissingAdd(uint8_t seq, uint32_t curTimeMs)
+{
+	// Target keeps a limited number of frames
+	if (mFramesMissingV2.size() >= cNumFramesMissingV2Max)
+	{
+		mFramesMissingV2.pop_front();
+		++mCntLostV2;
+	}
+
+	mFramesMissingV2.push_back(seq);
+	frameResendRequest(seq);
+
+	mStartMs = curTimeMs;
+}
+
+bool SingleWireScheduling::frameResendRequest(uint8_t seq)
+{
+	++mCntResendsV2;
+
+	return frameV2Send(IdFrameResend, string(1, (char)seq));
+}
+
+/*
+ * The target is asked to send the process tree only at our
+ * refresh rate. Older firmware doesn't know the command. In
+ * this case the trees are still filtered on the host.
+ */
+void SingleWireScheduling::rateRefreshNegotiate(uint32_t curTimeMs)
+{
+	string resp;
+	bool ok;
+
+	if (mRatePending)
+	{
+		ok = commandResponseGet(mIdReqRate, resp);
+		if (ok)
+		{
+			mRatePending = false;
+			mRateTargetAck = resp == "Refresh rate " + to_string(mRateRefreshReqMs);
+
+			if (!mRateTargetAck)
+				procDbgLog("refresh rate not supported by target. Filtering on host");
+
+			return;
+		}
+
+		if (curTimeMs - mStartRateMs < cTimeoutCommandResponseMs)
+			return;
+
+		commandCancel(mIdReqRate);
+
+		mRatePending = false;
+		mRateTargetAck = false;
+
+		procDbgLog("timeout setting refresh rate on target");
+		return;
+	}
+
+	uint32_t rateMs = rateRefreshMs();
+
+	if (rateMs == mRateRefreshReqMs)
+		return;
+
+	if (mRateRefreshReqMs && !mRateTargetAck)
+		return;
+
+	ok = commandSend(string(cCmdRateRefresh) + " " + to_string(rateMs),
+						mIdReqRate, PrioSysHigh);
+	if (!ok)
+		return;
+
+	mRateRefreshReqMs = rateMs;
+
+	mStartRateMs = curTimeMs;
+	mRatePending = true;
+}
+
+/*
+ * Same for the log rate of the budget. Older firmware doesn't
+ * know the command. Then monitoring requests are skipped while
+ * the log is over its share, which works in poll mode only.
+ */
+void SingleWireScheduling::rateLogNegotiate(uint32_t curTimeMs)
+{
+	string resp;
+	bool ok;
+
+	if (mRateLogPending)
+	{
+		ok = commandResponseGet(mIdReqRateLog, resp);
+		if (ok)
+		{
+			mRateLogPending = false;
+			mRateLogTargetAck = resp == "Log rate " + to_string(mRateLogReq);
+
+			if (!mRateLogTargetAck)
+				procDbgLog("log rate not supported by target. Skipping requests");
+
+			return;
+		}
+
+		if (curTimeMs - mStartRateLogMs < cTimeoutCommandResponseMs)
+			return;
+
+		commandCancel(mIdReqRateLog);
+
+		mRateLogPending = false;
+		mRateLogTargetAck = false;
+
+		procDbgLog("timeout setting log rate on target");
+		return;
+	}
+
+	if (mRateLogBudget == mRateLogReq)
+		return;
+
+	if (mRateLogReq && !mRateLogTargetAck)
+		return;
+
+	ok = commandSend(string(cCmdRateLog) + " " + to_string(mRateLogBudget),
+						mIdReqRateLog, PrioSysHigh);
+	if (!ok)
+		return;
+
+	mRateLogReq = mRateLogBudget;
+
+	mStartRateLogMs = curTimeMs;
+	mRateLogPending = true;
+}
+
+/*
+ * Tagged commands are optional. Firmware without support
+ * doesn't know the command and gets one command at a time.
+ */
+void SingleWireScheduling::tagsNegotiate(uint32_t curTimeMs)
+{
+	unsigned int version, numMax;
+	string resp;
+	bool ok;
+	int res;
+
+	if (mTagsNegotiated)
+		return;
+
+	if (env.numCmdsInFlightMax < 2)
+	{
+		mTagsNegotiated = true;
+		return;
+	}
+
+	if (!mTagsPending)
+	{
+		ok = commandSend(cCmdTagsCaps, mIdReqTags, PrioSysHigh);
+		if (!ok)
+			return;
+
+		mStartTagsMs = curTimeMs;
+		mTagsPending = true;
+
+		return;
+	}
+
+	ok = commandResponseGet(mIdReqTags, resp);
+	if (!ok)
+	{
+		if (curTimeMs - mStartTagsMs < cTimeoutCommandResponseMs)
+			return;
+
+		commandCancel(mIdReqTags);
+		resp = "";
+	}
+
+	mTagsPending = false;
+	mTagsNegotiated = true;
+
+	res = sscanf(resp.c_str(), "Tags %u %u", &version, &numMax);
+	if (res != 2 || version != cVersionTags || numMax < 2)
+	{
+		procDbgLog("tagged commands not supported by target");
+		return;
+	}
+
+	mNumCmdsInFlightMax = numMax;
+
+	if (mNumCmdsInFlightMax > env.numCmdsInFlightMax)
+		mNumCmdsInFlightMax = env.numCmdsInFlightMax;
+
+	if (mNumCmdsInFlightMax > cNumCmdsInFlightMax)
+		mNumCmdsInFlightMax = cNumCmdsInFlightMax;
+
+	mTagsActive = true;
+
+	procDbgLog("tagged commands supported. Up to %u in flight",
+				mNumCmdsInFlightMax);
+}
+
+/*
+ * In push mode the target sends logs and process trees
+ * unsolicited when it has them. Data requests are needed
+ * for commands and binary channels only. Push follows the
+ * monitoring switch.
+ */
+void SingleWireScheduling::pushNegotiate(uint32_t curTimeMs)
+{
+	bool pushWanted = monitoring && !env.pollOnly;
+	string resp;
+	bool ok;
+
+	if (mPushPending)
+	{
+		ok = commandResponseGet(mIdReqPush, resp);
+		if (!ok)
+		{
+			if (curTimeMs - mStartPushMs < cTimeoutCommandResponseMs)
+				return;
+
+			commandCancel(mIdReqPush);
+			resp = "";
+		}
+
+		mPushPending = false;
+
+		if (resp == (mPushReq ? "Push on" : "Push off"))
+		{
+			mPushActive = mPushReq;
+			procDbgLog("push mode %sabled", mPushActive ? "en" : "dis");
+			return;
+		}
+
+		// Target state unknown. Keep polling
+		mPushActive = false;
+		mPushUnsupported = true;
+
+		procDbgLog("push mode not supported by target");
+		return;
+	}
+
+	if (mPushUnsupported || pushWanted == mPushReq)
+		return;
+
+	ok = commandSend(string(cCmdPushSet) + (pushWanted ? " on" : " off"),
+						mIdReqPush, PrioSysHigh);
+	if (!ok)
+		return;
+
+	mPushReq = pushWanted;
+
+	// Stop polling for monitoring data right away
+	if (!pushWanted)
+		mPushActive = false;
+
+	mStartPushMs = curTimeMs;
+	mPushPending = true;
+}
+
+void SingleWireScheduling::linkUsageUpdate(uint32_t curTimeMs)
+{
+	LinkUsage &usage = mUsage[mPushActive ? 1 : 0];
+
+	usage.durationMs += curTimeMs - mUsageLast.durationMs;
+	usage.cntBytesRcvd += mCntBytesRcvd - mUsageLast.cntBytesRcvd;
+	usage.cntBytesSent += mCntBytesSent - mUsageLast.cntBytesSent;
+	usage.cntRequests += mCntDataRequests - mUsageLast.cntRequests;
+	usage.cntContentNone += mCntContentNoneRcvd - mUsageLast.cntContentNone;
+
+	// Used as snapshot
+	mUsageLast.durationMs = curTimeMs;
+	mUsageLast.cntBytesRcvd = mCntBytesRcvd;
+	mUsageLast.cntBytesSent = mCntBytesSent;
+	mUsageLast.cntRequests = mCntDataRequests;
+	mUsageLast.cntContentNone = mCntContentNoneRcvd;
+}
+
+/*
+ * Link budget
+ *
+ * Received bytes are counted per content class in slots of
+ * 100 ms. The shares are calculated over the last 2 s against
+ * the capacity of the link. This is the nominal UART rate or
+ * the highest throughput seen, which decays back to it. A
+ * virtual UART may be faster than the nominal rate.
+ *
+ * Shares matter only when the link is saturated. Then shares
+ * reserved by other active classes lower the maximum of a
+ * class. Classes above their maximum are throttled:
+ *
+ *   Proc  Refresh rate negotiated with the target is lowered
+ *   Log   Log rate negotiated with the target is lowered.
+ *         Older firmware: Data requests for monitoring are
+ *         skipped. This doesn't work in push mode
+ *   Cmd   Queued commands are held back
+ *
+ * Bulk, samples and idle answers count for the total only.
+ */
+void SingleWireScheduling::budgetUpdate(uint32_t curTimeMs)
+{
+	size_t bytes[cNumClassesBudget + 1];
+	size_t capacity;
+	uint32_t reserved;
+	size_t i, k;
+	bool ok;
+
+	if (env.budget != mSpecBudget)
+	{
+		mSpecBudget = env.budget;
+
+		ok = budgetParse(mSpecBudget, mShareMin, mShareMax);
+		if (!ok)
+			procWrnLog("invalid link budget. Using no limits");
+	}
+
+	if (curTimeMs - mStartSlotBudgetMs < cDurationSlotBudgetMs)
+		return;
+	mStartSlotBudgetMs = curTimeMs;
+
+	mIdxSlotBudget = (mIdxSlotBudget + 1) % cNumSlotsBudget;
+
+	memcpy(mBytesBudget[mIdxSlotBudget], mBytesBudgetCur, sizeof(mBytesBudgetCur));
+	memset(mBytesBudgetCur, 0, sizeof(mBytesBudgetCur));
+
+	memset(bytes, 0, sizeof(bytes));
+	mBytesBudgetWindow = 0;
+	capacity = cRateLinkNominal * cNumSlotsBudget * cDurationSlotBudgetMs / 1000;
+
+	for (i = 0; i < cNumSlotsBudget; ++i)
+	{
+		for (k = 0; k <= cNumClassesBudget; ++k)
+		{
+			bytes[k] += mBytesBudget[i][k];
+			mBytesBudgetWindow += mBytesBudget[i][k];
+		}
+	}
+
+	mBytesBudgetCapacity -= mBytesBudgetCapacity >> 8;
+
+	if (mBytesBudgetCapacity < capacity)
+		mBytesBudgetCapacity = capacity;
+
+	if (mBytesBudgetCapacity < mBytesBudgetWindow)
+		mBytesBudgetCapacity = mBytesBudgetWindow;
+
+	mSaturatedBudget = mBytesBudgetWindow * 100 >=
+				mBytesBudgetCapacity * cShareSaturatedBudget;
+
+	for (k = 0; k < cNumClassesBudget; ++k)
+	{
+		mShare[k] = bytes[k] * 100 / mBytesBudgetCapacity;
+
+		reserved = 0;
+
+		for (i = 0; i < cNumClassesBudget; ++i)
+		{
+			if (i != k && bytes[i])
+				reserved += mShareMin[i];
+		}
+
+		mShareMaxEff[k] = mShareMax[k];
+
+		if (reserved > 100U - mShareMaxEff[k])
+			mShareMaxEff[k] = 100 - reserved;
+
+		mThrottled[k] = mSaturatedBudget && mShare[k] > mShareMaxEff[k];
+	}
+
+	budgetRateAdjust(curTimeMs);
+}
+
+// Once per window. The target needs time to follow
+void SingleWireScheduling::budgetRateAdjust(uint32_t curTimeMs)
+{
+	if (curTimeMs - mLastRateBudgetMs < cNumSlotsBudget * cDurationSlotBudgetMs)
+		return;
+	mLastRateBudgetMs = curTimeMs;
+
+	budgetRateLogAdjust();
+
+	if (mThrottled[ClassBudgetProc])
+	{
+		if (mFactorRateBudget < cFactorRateBudgetMax)
+			mFactorRateBudget <<= 1;
+
+		return;
+	}
+
+	if (mFactorRateBudget > 1 &&
+			mShare[ClassBudgetProc] < mShareMaxEff[ClassBudgetProc] >> 1)
+		mFactorRateBudget >>= 1;
+}
+
+/*
+ * The log share can't be lowered by polling less. The target
+ * keeps sending the buffered entries. Instead it is given a
+ * rate in bytes per second which follows the share of the log.
+ * A rate of 0 means no limit.
+ */
+void SingleWireScheduling::budgetRateLogAdjust()
+{
+	size_t bytesLog = 0;
+	size_t rate;
+
+	for (size_t i = 0; i < cNumSlotsBudget; ++i)
+		bytesLog += mBytesBudget[i][ClassBudgetLog];
+
+	if (mThrottled[ClassBudgetLog])
+	{
+		rate = bytesLog * 1000 / (cNumSlotsBudget * cDurationSlotBudgetMs);
+
+		// Throttled: mShare > mShareMaxEff
+		rate = rate * mShareMaxEff[ClassBudgetLog] / mShare[ClassBudgetLog];
+
+		if (rate < cRateLogBudgetMin)
+			rate = cRateLogBudgetMin;
+
+		if (!mRateLogBudget || rate < mRateLogBudget)
+			mRateLogBudget = (uint32_t)rate;
+
+		return;
+	}
+
+	if (!mRateLogBudget)
+		return;
+
+	if (mShare[ClassBudgetLog] >= mShareMaxEff[ClassBudgetLog] >> 1)
+		return;
+
+	if (mRateLogBudget > cRateLogBudgetMax >> 1)
+	{
+		mRateLogBudget = 0;
+		return;
+	}
+
+	mRateLogBudget <<= 1;
+}
+
+uint32_t SingleWireScheduling::rateRefreshMs()
+{
+	uint32_t rateMs = env.rateRefreshMs * mFactorRateBudget;
+
+	if (rateMs > (uint32_t)cRateRefreshMaxMs)
+		rateMs = cRateRefreshMaxMs;
+
+	return rateMs < env.rateRefreshMs ? env.rateRefreshMs : rateMs;
+}
+
+void SingleWireScheduling::budgetPrint(char * &pBuf, char *pBufEnd)
+{
+	const char *throttled = " (throttled)";
+	uint32_t durationMs = cNumSlotsBudget * cDurationSlotBudgetMs;
+
+	dInfo("Budget\t\t\t%zu of %zu [B/s]%s\n",
+			mBytesBudgetWindow * 1000 / durationMs,
+			mBytesBudgetCapacity * 1000 / durationMs,
+			mSaturatedBudget ? ", saturated" : "");
+	dInfo("  Proc/Log/Cmd\t\t%u%%%s / %u%%%s / %u%%%s\n",
+			mShare[ClassBudgetProc], mThrottled[ClassBudgetProc] ? throttled : "",
+			mShare[ClassBudgetLog], mThrottled[ClassBudgetLog] ? throttled : "",
+			mShare[ClassBudgetCmd], mThrottled[ClassBudgetCmd] ? throttled : "");
+}
+
+void SingleWireScheduling::budgetDetailPrint(char * &pBuf, char *pBufEnd)
+{
+	const char *names[cNumClassesBudget] = { "Proc", "Log", "Cmd" };
+
+	for (size_t k = 0; k < cNumClassesBudget; ++k)
+	{
+		dInfo("  %s\t\t\t%3u%% of %u-%u%s\n",
+				names[k], mShare[k],
+				mShareMin[k], mShareMaxEff[k],
+				mThrottled[k] ? ", throttled" : "");
+	}
+
+	if (mRateLogBudget)
+		dInfo("  Log rate\t\t%u [B/s], %s\n", mRateLogBudget,
+				mRateLogTargetAck ? "on target" : "polls skipped");
+}
+
+/*
+ * The bulk channel is optional. Firmware without support
+ * doesn't know the command and the transfers are refused.
+ */
+void SingleWireScheduling::bulkNegotiate(uint32_t curTimeMs)
+{
+	unsigned int version, window, sizeChunk;
+	string resp;
+	bool ok;
+	int res;
+
+	if (mBulkNegotiated)
+		return;
+
+	if (!mBulkPending)
+	{
+		ok = commandSend(cCmdBulkCaps, mIdReqBulk, PrioSysHigh);
+		if (!ok)
+			return;
+
+		mStartBulkMs = curTimeMs;
+		mBulkPending = true;
+
+		return;
+	}
+
+	ok = commandResponseGet(mIdReqBulk, resp);
+	if (!ok)
+	{
+		if (curTimeMs - mStartBulkMs < cTimeoutCommandResponseMs)
+			return;
+
+		commandCancel(mIdReqBulk);
+		resp = "";
+	}
+
+	mBulkPending = false;
+	mBulkNegotiated = true;
+
+	res = sscanf(resp.c_str(), "Bulk %u %u %u", &version, &window, &sizeChunk);
+	if (res != 3 || version != cVersionBulk || !window ||
+			!sizeChunk || sizeChunk > cLenBulkChunkMax)
+	{
+		procDbgLog("bulk transfer not supported by target");
+		return;
+	}
+
+	Guard lock(mtxResponses);
+
+	windowBulk = window;
+	sizeChunkBulk = sizeChunk;
+
+	procDbgLog("bulk transfer supported. Window %u, chunk size %u",
+				windowBulk, sizeChunkBulk);
+}
+
+/*
+ * Chunks are accepted in order only. Everything else
+ * triggers a resend request. Chunks already in flight when
+ * the request is sent are dropped silently until the
+ * target continues at the requested sequence number.
+ */
+void SingleWireScheduling::bulkChunkReceived(const string &frame, uint32_t curTimeMs)
+{
+	BulkChunk chunk;
+	bool ok;
+
+	ok = bulkChunkDecode(frame, chunk);
+
+	Guard lock(mtxResponses);
+
+	if (!xferBulk.active)
+		return;
+
+	if (ok && chunk.idXfer != xferBulk.idXfer)
+		return;
+
+	if (ok && chunk.seq < xferBulk.seqNext)
+		return;
+
+	if (!ok || chunk.seq > xferBulk.seqNext)
+	{
+		if (!ok)
+			++xferBulk.cntErrCrc;
+		else
+		if (!xferBulk.resendSent)
+			++xferBulk.cntGaps;
+
+		xferBulk.resendReq = true;
+
+		// More than a window without progress. Resend was lost too
+		if (xferBulk.resendSent && ++xferBulk.cntStale >= windowBulk)
+			xferBulk.resendSent = false;
+
+		return;
+	}
+
+	++xferBulk.seqNext;
+	xferBulk.resendReq = false;
+	xferBulk.resendSent = false;
+	xferBulk.lastRcvdMs = curTimeMs;
+
+	xferBulk.cntBytes += chunk.data.size();
+	xferBulk.sizeQueued += chunk.data.size();
+	xferBulk.chunks.push_back(move(chunk.data));
+}
+
+/*
+ * Acks are cumulative and sent every half window or when
+ * the target pauses. A full queue withholds them. The
+ * target stops after one window in this case.
+ */
+bool SingleWireScheduling::bulkAckSend(uint32_t curTimeMs)
+{
+	string frame;
+	BulkAck ack;
+	bool failed = false;
+
+	{
+		Guard lock(mtxResponses);
+
+		if (!xferBulk.active)
+			return true;
+
+		if (xferBulk.sizeQueued > cSizeBulkQueuedMax)
+			return true;
+
+		ack.idXfer = xferBulk.idXfer;
+		ack.seqNext = xferBulk.seqNext;
+		ack.flags = 0;
+
+		if (xferBulk.resendReq && !xferBulk.resendSent)
+			ack.flags = BulkAckResend;
+		else
+		if (curTimeMs - xferBulk.lastRcvdMs > cTimeoutBulkMs &&
+				curTimeMs - xferBulk.lastAckMs > cTimeoutBulkMs)
+			ack.flags = BulkAckResend;
+		else
+		if (xferBulk.seqNext == xferBulk.seqAcked)
+			return true;
+		else
+		if (xferBulk.seqNext - xferBulk.seqAcked < (windowBulk >> 1) &&
+				curTimeMs - xferBulk.lastRcvdMs < cDelayAckBulkMs)
+			return true;
+
+		if (ack.flags & BulkAckResend)
+		{
+			++xferBulk.cntResends;
+
+			xferBulk.resendReq = false;
+			xferBulk.resendSent = true;
+			xferBulk.cntStale = 0;
+		}
+
+		xferBulk.seqAcked = ack.seqNext;
+		xferBulk.lastAckMs = curTimeMs;
+	}
+
+	bulkAckEncode(ack, frame);
+
+	if (mProtoV2)
+		return frameV2Send(IdContentScToTaBulk, frame);
+
+	failed |= uartSend(mRefUart, FlowSchedToTarget) < 0;
+	failed |= uartSend(mRefUart, IdContentScToTaBulk) < 0;
+	failed |= uartSend(mRefUart, frame.data(), frame.size()) < 0;
+	failed |= uartSend(mRefUart, IdContentEnd) < 0;
+
+	mCntBytesSent += frame.size() + 3;
+
+	return !failed;
+}
+
+/*
+ * Clients only change the requested configuration. It is
+ * applied here, one request at a time. Newer requests
+ * override pending ones once the target has answered.
+ */
+void SingleWireScheduling::sampleNegotiate(uint32_t curTimeMs)
+{
+	unsigned int idSet, numCh, periodUs;
+	uint32_t verConfig, periodUsReq;
+	string resp, cmd;
+	bool ok;
+	int res;
+
+	if (mSamplePending)
+	{
+		ok = commandResponseGet(mIdReqSample, resp);
+		if (!ok)
+		{
+			if (curTimeMs - mStartSampleMs < cTimeoutCommandResponseMs)
+				return;
+
+			commandCancel(mIdReqSample);
+			mSamplePending = false;
+
+			sampleSetStop("timeout");
+			return;
+		}
+
+		mSamplePending = false;
+
+		if (!mSymbolsSample.size())
+		{
+			sampleSetStop("");
+			return;
+		}
+
+		res = sscanf(resp.c_str(), "Sample %u %u %u", &idSet, &numCh, &periodUs);
+		if (res != 3 || idSet != mIdSetSample || numCh != mSymbolsSample.size())
+		{
+			sampleSetStop(resp.size() ? resp : "not supported by target");
+			return;
+		}
+
+		sampleSetStart(mIdSetSample, periodUs, mSymbolsSample);
+
+		procDbgLog("sampling %u channels every %u us", numCh, periodUs);
+
+		return;
+	}
+
+	verConfig = sampleConfigGet(periodUsReq, mSymbolsSample);
+	if (verConfig == mVerSampleReq)
+		return;
+
+	if (mSymbolsSample.size())
+	{
+		++mIdSetSample;
+
+		cmd = string(cCmdSampleStart) + " " + to_string(mIdSetSample) +
+				" " + to_string(periodUsReq);
+
+		for (size_t i = 0; i < mSymbolsSample.size(); ++i)
+			cmd += " " + mSymbolsSample[i];
+	}
+	else
+		cmd = cCmdSampleStop;
+
+	ok = commandSend(cmd, mIdReqSample, PrioSysHigh);
+	if (!ok)
+		return;
+
+	mVerSampleReq = verConfig;
+
+	mStartSampleMs = curTimeMs;
+	mSamplePending = true;
+}
+
+Success SingleWireScheduling::shutdown()
+{
+
+	if (mRefUart != RefDeviceUartInvalid)
+	{
+		devUartDeInit(mRefUart);
+		refUart = mRefUart;
+	}
+
+	return Positive;
+}
+
+void SingleWireScheduling::processInfo(char *pBuf, char *pBufEnd)
+{
+	dInfo("Manual control\t\t%sabled\n", env.ctrlManual ? "En" : "Dis");
+	dInfo("Monitoring\t\t%sabled\n", monitoring ? "En" : "Dis");
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+#if 1
+	dInfo("State SWT\t\t\t%s\n", SwtStateString[mStateSwt]);
+#endif
+	dInfo("Virtual UART mode\t\t%s\n",
+			uartVirtualMode == UartVirtModeSim ? "sim" :
+			uartVirtualMode == UartVirtModeReplay ? "replay" :
+			uartVirtualMode == UartVirtModeUart ? "uart" : "swart");
+	dInfo("Virtual UART\t\t%sabled\n", uartVirtual ? "En" : "Dis");
+	dInfo("Virtual UART dropped\t%zu\n", uartVirtDropped());
+	dInfo("UART: %s\t%sline\n",
+			env.deviceUart.c_str(),
+			mDevUartIsOnline ? "On" : "Off");
+	dInfo("Target\t\t\t%sline\n", mTargetIsOnline ? "On" : "Off");
+	dInfo("Protocol\t\tSingleWire v%u\n", mProtoV2 ? cVersionProto : 1);
+	dInfo("Refresh rate\t\t%u [ms], %s\n",
+			rateRefreshMs(),
+			mRateTargetAck ? "on target" : "host filter");
+	dInfo("Bytes received\t\t%zu\n", mCntBytesRcvd);
+	dInfo("Content 'none' received\t%zu\n", mCntContentNoneRcvd);
+	dInfo("Push mode\t\t%s\n",
+			mPushActive ? "Active" :
+			mPushUnsupported ? "Not supported" : "Inactive");
+	budgetPrint(pBuf, pBufEnd);
+	dInfo("Statistics\t\t%s\n", statsDetailed ? "Detailed" : "Hidden, see statsToggle");
+
+	if (statsDetailed)
+	{
+		linkUsagePrint(pBuf, pBufEnd, "poll", mUsage[0]);
+		linkUsagePrint(pBuf, pBufEnd, "push", mUsage[1]);
+		budgetDetailPrint(pBuf, pBufEnd);
+		dInfo("Responses truncated\t%zu\n", mCntRespTruncated);
+		dInfo("Chunks queued\t\t%zu (%zu bytes)\n", chunksCmd.size(), sizeChunksCmd);
+		dInfo("Chunk bytes dropped\t%zu\n", cntBytesChunkDropped);
+		{
+			Guard lock(mtxRequests);
+
+			dInfo("Commands in flight\t%zu / %u, %s\n",
+					cmdsInFlight.size(), mNumCmdsInFlightMax,
+					mTagsActive ? "tagged" : "untagged");
+		}
+		dInfo("Commands in flight peak\t%zu\n", mNumCmdsInFlightPeak);
+		dInfo("Commands timed out\t%zu\n", mCntCmdsTimedOut);
+		dInfo("Responses unmatched\t%zu\n", mCntRespUnmatched);
+		if (mProtoV2)
+		{
+			dInfo("Frames received\t\t%zu\n", mCntFramesV2);
+			dInfo("Frame errors hdr/crc\t%zu / %zu\n", mCntErrHdrV2, mCntErrCrcV2);
+			dInfo("Frame gaps\t\t%zu\n", mCntGapsV2);
+			dInfo("Frame resends\t\t%zu\n", mCntResendsV2);
+			dInfo("Frames recovered/lost\t%zu / %zu\n", mCntRecoveredV2, mCntLostV2);
+		}
+		{
+			Guard lock(mtxResponses);
+
+			if (windowBulk)
+				dInfo("Bulk transfer\t\tWindow %u, chunk %u [bytes]\n",
+						windowBulk, sizeChunkBulk);
+			else
+				dInfo("Bulk transfer\t\tNot supported\n");
+
+			dInfo("Bulk received\t\t%zu [bytes]%s\n",
+					xferBulk.cntBytes, xferBulk.active ? ", active" : "");
+			dInfo("Bulk errors crc/gap\t%zu / %zu\n",
+					xferBulk.cntErrCrc, xferBulk.cntGaps);
+			dInfo("Bulk resends\t\t%zu\n", xferBulk.cntResends);
+		}
+	}
+
+	profilingTickInfo(pBuf, pBufEnd, mpProfTick);
+#if 0
+	fragmentsPrint(pBuf, pBufEnd);
+#endif
+#if 0
+	queuesCmdPrint(pBuf, pBufEnd);
+#endif
+}
+
+void SingleWireScheduling::linkUsagePrint(char * &pBuf, char *pBufEnd,
+				const char *pMode, const LinkUsage &usage)
+{
+	uint32_t durationMs = usage.durationMs ? usage.durationMs : 1;
+
+	dInfo("Link %s\t\t%u [s], rx %zu [B/s], tx %zu [B/s]\n",
+			pMode, usage.durationMs / 1000,
+			usage.cntBytesRcvd * 1000 / durationMs,
+			usage.cntBytesSent * 1000 / durationMs);
+	dInfo("  Requests\t\t%zu [1/s], %zu%% idle\n",
+			usage.cntRequests * 1000 / durationMs,
+			usage.cntRequests ? usage.cntContentNone * 100 / usage.cntRequests : 0);
+}
+
+/* static functions */
+
+size_t SingleWireScheduling::budgetIdx(uint8_t idContent)
+{
+	if (idContent == IdContentTaToScProc)
+		return ClassBudgetProc;
+
+	if (idContent == IdContentTaToScLog)
+		return ClassBudgetLog;
+
+	if (idContent == IdContentTaToScCmd)
+		return ClassBudgetCmd;
+
+	return cNumClassesBudget;
+}
+
+/*
+ * Format: <class>:<min>-<max>,..
+ * Classes: proc, log, cmd. Missing classes: 0-100
+ * Given arrays are set to no limits on error.
+ */
+bool SingleWireScheduling::budgetParse(const string &spec, uint8_t *pMin, uint8_t *pMax)
+{
+	const char *names[cNumClassesBudget] = { "proc", "log", "cmd" };
+	uint8_t shareMin[cNumClassesBudget];
+	uint8_t shareMax[cNumClassesBudget];
+	unsigned int valMin, valMax;
+	uint32_t sumMin = 0;
+	char name[8];
+	size_t idx, k;
+	int res, len;
+
+	memset(shareMin, 0, sizeof(shareMin));
+	memset(shareMax, 100, sizeof(shareMax));
+
+	if (pMin)
+		memcpy(pMin, shareMin, sizeof(shareMin));
+
+	if (pMax)
+		memcpy(pMax, shareMax, sizeof(shareMax));
+
+	for (idx = 0; idx < spec.size(); idx += (size_t)len + 1)
+	{
+		len = 0;
+
+		res = sscanf(spec.c_str() + idx, "%7[a-z]:%u-%u%n",
+						name, &valMin, &valMax, &len);
+		if (res != 3 || valMin > valMax || valMax > 100)
+			return false;
+
+		if (spec[idx + (size_t)len] && spec[idx + (size_t)len] != ',')
+			return false;
+
+		for (k = 0; k < cNumClassesBudget; ++k)
+		{
+			if (!strcmp(name, names[k]))
+				break;
+		}
+
+		if (k >= cNumClassesBudget)
+			return false;
+
+		shareMin[k] = (uint8_t)valMin;
+		shareMax[k] = (uint8_t)valMax;
+	}
+
+	for (k = 0; k < cNumClassesBudget; ++k)
+		sumMin += shareMin[k];
+
+	if (sumMin > 100)
+		return false;
+
+	if (pMin)
+		memcpy(pMin, shareMin, sizeof(shareMin));
+
+	if (pMax)
+		memcpy(pMax, shareMax, sizeof(shareMax));
+
+	return true;
+}
 
@@ -30,17 +30,24 @@
 #include <map>
 
 #include "Processing.h"
+#include "LibProfiling.h"
 #include "Pipe.h"
 #include "SingleWire.h"
 #include "LibUart.h"
+#include "LibBulkTransfer.h"
+#include "LibSampling.h"
+#include "LibSingleWireV2.h"
 
 enum PrioCmd
 {
 	PrioSysHigh = 0,
 	PrioUser,
+	PrioSysBatch,	// Back to back, not delayed by monitoring
 	PrioSysLow,
 };
 
+const size_t cNumPrioCmd = 4;
+
 struct SingleWireResponse
 {
 	uint8_t idContent;
@@ -48,22 +55,84 @@ struct SingleWireResponse
 	bool unsolicited;
 };
 
+struct CommandDone
+{
+	uint32_t idReq;
+	std::string cmd;
+	std::string resp;
+	uint32_t durationMs;
+};
+
 typedef ssize_t (*FuncUartSend)(RefDeviceUart refUart, const void *pBuf, size_t lenReq);
 
 struct CommandReqResp
 {
-	CommandReqResp(std::string cmd, uint32_t id, uint32_t start)
+	CommandReqResp(std::string cmd, uint32_t id, uint32_t start, bool chunked = false)
 		: str(std::move(cmd))
 		, idReq(id)
 		, startMs(start)
+		, streamed(chunked)
+		, tag(0)
+		, sentMs(0)
+		, cancelled(false)
 	{}
 
 	std::string str;
 	uint32_t idReq;
 	uint32_t startMs;
+	bool streamed;
+	uint8_t tag;
+	uint32_t sentMs;
+	bool cancelled;
+};
+
+struct ChunkResp
+{
+	uint32_t idReq;
+	std::string data;
+	bool last;
+	bool truncated;
+	uint32_t createdMs;
+};
+
+struct TransferBulk
+{
+	uint8_t idXfer;
+	bool active;
+	uint32_t seqNext;
+	uint32_t seqAcked;
+	bool resendReq;
+	bool resendSent;
+	uint32_t cntStale;
+	uint32_t lastRcvdMs;
+	uint32_t lastAckMs;
+	std::list<std::string> chunks;
+	size_t sizeQueued;
+	size_t cntBytes;
+	size_t cntErrCrc;
+	size_t cntGaps;
+	size_t cntResends;
+};
+
+struct LinkUsage
+{
+	uint32_t durationMs;
+	size_t cntBytesRcvd;
+	size_t cntBytesSent;
+	size_t cntRequests;
+	size_t cntContentNone;
+};
+
+enum ClassBudget
+{
+	ClassBudgetProc = 0,
+	ClassBudgetLog,
+	ClassBudgetCmd,
 };
 
 const uint32_t cTimeoutCommandResponseMs = 1500;
+const size_t cNumClassesBudget = 3;
+const size_t cNumSlotsBudget = 20;
 
 class SingleWireScheduling : public Processing
 {
@@ -77,22 +146,33 @@ public:
 
 	// input
 	static uint8_t monitoring;
+	bool mCmdsDoneReport;
 
 	// output
 	bool mDevUartIsOnline;
 	bool mTargetIsOnline;
+	static bool protoV2Active;
 
 	bool contentProcChanged();
 	std::string mContentProc;
 
 	Pipe<std::string> ppEntriesLog;
+	Pipe<CommandDone> ppCmdsDone;
 
 	static bool commandSend(const std::string &cmd,
 					uint32_t &idReq,
-					PrioCmd prio = PrioUser);
+					PrioCmd prio = PrioUser,
+					bool streamed = false);
 	static bool commandResponseGet(uint32_t idReq, std::string &resp);
+	static bool commandChunkGet(uint32_t idReq, std::string &chunk, bool &last, bool &truncated);
+	static void commandCancel(uint32_t idReq);
+
+	static bool bulkOpen(uint8_t &idXfer);
+	static Success bulkDataGet(uint8_t idXfer, std::string &data);
+	static void bulkClose(uint8_t idXfer);
 
 	static bool isCtrl(char ch);
+	static bool budgetParse(const std::string &spec, uint8_t *pMin, uint8_t *pMax);
 
 protected:
 
@@ -104,6 +184,8 @@ private:
 	SingleWireScheduling(const SingleWireScheduling &) = delete;
 	SingleWireScheduling &operator=(const SingleWireScheduling &) = delete;
 
+	friend class Benchmarking;
+
 	/*
 	 * Naming of functions:  objectVerb()
 	 * Example:              peerAdd()
@@ -120,6 +202,12 @@ private:
 
 	Success cmdQueueConsume();
 	void cmdResponseReceived(const std::string &resp);
+	void cmdRespStart();
+	void cmdRespBegin(uint8_t tag);
+	void cmdRespTagged(const std::string &str);
+	uint8_t cmdTagNext();
+	void cmdsInFlightCheck(uint32_t curTimeMs);
+	void cmdChunkCommit(const std::string &data, bool last);
 	void cmdResponsesClear(uint32_t curTimeMs);
 	bool cmdSend(const std::string &cmd);
 	bool dataRequest();
@@ -127,6 +215,29 @@ private:
 	Success contentReceive();
 	Success byteProcess(uint8_t ch, uint32_t curTimeMs);
 	void targetOnlineSet(bool online = true);
+	void targetConnected();
+	bool procTreeFiltered(uint32_t curTimeMs);
+	Success frameV2Process(uint32_t curTimeMs);
+	Success frameV2Finish(uint32_t curTimeMs);
+	bool frameV2Send(uint8_t type, const std::string &payload);
+	void frameMissingAdd(uint8_t seq, uint32_t curTimeMs);
+	bool frameResendRequest(uint8_t seq);
+	void rateRefreshNegotiate(uint32_t curTimeMs);
+	void rateLogNegotiate(uint32_t curTimeMs);
+	void bulkNegotiate(uint32_t curTimeMs);
+	void tagsNegotiate(uint32_t curTimeMs);
+	void pushNegotiate(uint32_t curTimeMs);
+	void linkUsageUpdate(uint32_t curTimeMs);
+	void linkUsagePrint(char * &pBuf, char *pBufEnd, const char *pMode, const LinkUsage &usage);
+	void budgetUpdate(uint32_t curTimeMs);
+	void budgetRateAdjust(uint32_t curTimeMs);
+	void budgetRateLogAdjust();
+	void budgetPrint(char * &pBuf, char *pBufEnd);
+	void budgetDetailPrint(char * &pBuf, char *pBufEnd);
+	uint32_t rateRefreshMs();
+	void bulkChunkReceived(const std::string &frame, uint32_t curTimeMs);
+	bool bulkAckSend(uint32_t curTimeMs);
+	void sampleNegotiate(uint32_t curTimeMs);
 	void responseReset(uint8_t idContent = IdContentTaToScNone);
 	void fragmentAppend(uint8_t ch);
 	void fragmentFinish();
@@ -150,10 +261,98 @@ private:
 	bool mContentIgnore;
 	bool mCmdExpected;
 	uint8_t mByteLast;
-	std::list<CommandReqResp> *mpListCmdCurrent;
+	uint32_t mIdReqCurrent;
+	bool mStreamedCurrent;
+	bool mChunksDroppedCurrent;
+	bool mRespCmdMatched;
+	bool mTagRespPending;
+	bool mRespStreamed;
+	size_t mCntBytesStreamed;
+	size_t mCntRespTruncated;
+	uint32_t mRateRefreshReqMs;
+	uint32_t mIdReqRate;
+	uint32_t mStartRateMs;
+	bool mRatePending;
+	bool mRateTargetAck;
+	uint32_t mRateLogReq;
+	uint32_t mIdReqRateLog;
+	uint32_t mStartRateLogMs;
+	bool mRateLogPending;
+	bool mRateLogTargetAck;
+	uint32_t mIdReqBulk;
+	uint32_t mStartBulkMs;
+	bool mBulkPending;
+	bool mBulkNegotiated;
+	bool mTagsActive;
+	uint32_t mNumCmdsInFlightMax;
+	uint8_t mTagNext;
+	uint32_t mIdReqTags;
+	uint32_t mStartTagsMs;
+	bool mTagsPending;
+	bool mTagsNegotiated;
+	size_t mNumCmdsInFlightPeak;
+	size_t mCntCmdsTimedOut;
+	size_t mCntRespUnmatched;
+	uint32_t mVerSampleReq;
+	uint32_t mIdReqSample;
+	uint32_t mStartSampleMs;
+	bool mSamplePending;
+	uint8_t mIdSetSample;
+	std::vector<std::string> mSymbolsSample;
 	uint8_t mCntDelayPrioLow;
 	uint8_t mCntRerequest;
 
+	// protocol v2
+	bool mProtoV2;
+	uint8_t mHdrV2[cLenFrameV2Hdr];
+	size_t mLenHdrV2;
+	FrameHdrV2 mFrmV2;
+	std::string mPayloadV2;
+	uint8_t mSeqRxV2;
+	uint8_t mSeqTxV2;
+	uint8_t mCntResendV2;
+	size_t mCntFramesV2;
+	size_t mCntErrHdrV2;
+	size_t mCntErrCrcV2;
+	size_t mCntGapsV2;
+	size_t mCntResendsV2;
+	std::list<uint8_t> mFramesMissingV2;
+	size_t mCntRecoveredV2;
+	size_t mCntLostV2;
+
+	// push mode
+	bool mPushActive;
+	bool mPushReq;
+	bool mPushPending;
+	bool mPushUnsupported;
+	uint32_t mIdReqPush;
+	uint32_t mStartPushMs;
+	uint32_t mLastRcvdMs;
+	size_t mCntBytesSent;
+	size_t mCntDataRequests;
+	LinkUsage mUsage[2];
+	LinkUsage mUsageLast;
+
+	// bandwidth budget
+	std::string mSpecBudget;
+	uint8_t mShareMin[cNumClassesBudget];
+	uint8_t mShareMax[cNumClassesBudget];
+	uint8_t mShareMaxEff[cNumClassesBudget];
+	uint8_t mShare[cNumClassesBudget];
+	bool mThrottled[cNumClassesBudget];
+	size_t mBytesBudgetCur[cNumClassesBudget + 1];
+	size_t mBytesBudget[cNumSlotsBudget][cNumClassesBudget + 1];
+	size_t mBytesBudgetWindow;
+	size_t mBytesBudgetCapacity;
+	bool mSaturatedBudget;
+	size_t mIdxSlotBudget;
+	size_t mIdxBudgetRcv;
+	uint32_t mStartSlotBudgetMs;
+	uint32_t mLastRateBudgetMs;
+	uint8_t mFactorRateBudget;
+	uint32_t mRateLogBudget;
+	ProfilingTick *mpProfTick;
+
 	/* static functions */
 
 	// Manual Control
@@ -170,6 +369,13 @@ private:
 	static void cmdTimeoutUartVirtToggle(char *pArgs, char *pBuf, char *pBufEnd);
 	static void cmdDataUartRcv(char *pArgs, char *pBuf, char *pBufEnd);
 	static void cmdStrUartRcv(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdSizeUartVirtSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdProcsSimSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdRateLogSimSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdLatencySimSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdRateRefreshSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdBudgetSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdStatsDetailedToggle(char *pArgs, char *pBuf, char *pBufEnd);
 
 	static void dataUartSend(char *pArgs, char *pBuf, char *pBufEnd, FuncUartSend pFctSend);
 	static void strUartSend(char *pArgs, char *pBuf, char *pBufEnd, FuncUartSend pFctSend);
@@ -177,19 +383,48 @@ private:
 	// Commands
 	static void cmdCommandSend(char *pArgs, char *pBuf, char *pBufEnd);
 
+	static bool bulkActive();
+	static size_t budgetIdx(uint8_t idContent);
+
 	/* static variables */
 	static uint8_t uartVirtualTimeout;
+	static uint8_t statsDetailed;
 	static RefDeviceUart refUart;
-	static std::list<CommandReqResp> requestsCmd[3];
+	static std::list<CommandReqResp> requestsCmd[cNumPrioCmd];
+	static std::list<CommandReqResp> cmdsInFlight;
 	static std::list<CommandReqResp> responsesCmd;
+	static std::list<ChunkResp> chunksCmd;
+	static size_t sizeChunksCmd;
+	static size_t cntBytesChunkDropped;
 	static uint32_t idReqCmdNext;
 	static std::mutex mtxRequests;
 	static std::mutex mtxResponses;
+	static TransferBulk xferBulk;
+	static uint8_t idXferBulkNext;
+	static uint32_t windowBulk;
+	static uint32_t sizeChunkBulk;
 
 	/* constants */
 	static const size_t cSizeFragmentMax;
+	static const size_t cSizeChunkCmd;
+	static const size_t cSizeChunksCmdMax;
 	static const uint32_t cTimeoutRespMs;
 	static const uint32_t cTimeoutDequeueMs;
+	static const size_t cSizeBulkQueuedMax;
+	static const uint32_t cDelayAckBulkMs;
+	static const uint32_t cTimeoutBulkMs;
+	static const uint8_t cNumResendV2Max;
+	static const size_t cNumFramesMissingV2Max;
+	static const uint32_t cNumCmdsInFlightMax;
+	static const uint32_t cTimeoutCmdInFlightMs;
+	static const size_t cLenTagMax;
+	static const uint32_t cIntervalKeepaliveMs;
+	static const uint32_t cDurationSlotBudgetMs;
+	static const uint8_t cFactorRateBudgetMax;
+	static const uint32_t cRateLinkNominal;
+	static const uint8_t cShareSaturatedBudget;
+	static const uint32_t cRateLogBudgetMin;
+	static const uint32_t cRateLogBudgetMax;
 
 };
 
@@ -0,0 +1,235 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * SingleWire target emulator
+ *
+ * Opens a pseudo-terminal and acts as target on it.
+ * CodeOrb is then started with: codeorb -d /dev/pts/<N>
+ */
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <cstdlib>
+#include <cstdio>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <ctime>
+
+#include "LibTargetSim.h"
+
+using namespace std;
+using namespace chrono;
+
+static bool closeRequested = false;
+static deque<uint8_t> bytesOut;
+
+static void applicationCloseRequest(int signum)
+{
+	(void)signum;
+	closeRequested = true;
+}
+
+static void bytesOutQueue(const void *pData, size_t len)
+{
+	const uint8_t *pSrc = (const uint8_t *)pData;
+	bytesOut.insert(bytesOut.end(), pSrc, pSrc + len);
+}
+
+static uint32_t msSince(const steady_clock::time_point &start)
+{
+	return (uint32_t)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+/*
+ * Literature
+ * - https://man7.org/linux/man-pages/man3/posix_openpt.3.html
+ * - https://man7.org/linux/man-pages/man3/cfmakeraw.3.html
+ */
+static int ptyOpen(int &fdSlave)
+{
+	struct termios to;
+	const char *pNameSlave;
+	int fdMaster;
+
+	fdMaster = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fdMaster < 0)
+		return -1;
+
+	if (grantpt(fdMaster) || unlockpt(fdMaster))
+	{
+		close(fdMaster);
+		return -1;
+	}
+
+	pNameSlave = ptsname(fdMaster);
+	if (!pNameSlave)
+	{
+		close(fdMaster);
+		return -1;
+	}
+
+	// Keep slave open: Settings persist and master doesn't see EIO
+	fdSlave = open(pNameSlave, O_RDWR | O_NOCTTY);
+	if (fdSlave < 0)
+	{
+		close(fdMaster);
+		return -1;
+	}
+
+	if (!tcgetattr(fdSlave, &to))
+	{
+		cfmakeraw(&to);
+		tcsetattr(fdSlave, TCSANOW, &to);
+	}
+
+	fcntl(fdMaster, F_SETFL, fcntl(fdMaster, F_GETFL) | O_NONBLOCK);
+
+	fprintf(stdout, "Target emulator on %s\n", pNameSlave);
+	fflush(stdout);
+
+	return fdMaster;
+}
+
+int main(int argc, char *argv[])
+{
+	steady_clock::time_point start = steady_clock::now();
+	uint32_t curTimeMs, nextSendMs = 0, lastBudgetMs = 0;
+	double budget = 0;
+	size_t cntBytesIn = 0, cntBytesOut = 0;
+	size_t cntDropped, cntCorrupted;
+	uint8_t buf[256];
+	struct pollfd pfd;
+	int fdMaster, fdSlave;
+	ssize_t lenDone;
+	size_t lenPlanned;
+	string strErr;
+
+	if (argc >= 2 && (string(argv[1]) == "-h" || string(argv[1]) == "--help"))
+	{
+		fprintf(stdout, "Usage: %s [scenario file]\n", argv[0]);
+		return 0;
+	}
+
+	if (argc >= 2 && !targetSimConfigLoad(argv[1], strErr))
+	{
+		fprintf(stderr, "Error loading scenario: %s\n", strErr.c_str());
+		return 1;
+	}
+
+	signal(SIGINT, applicationCloseRequest);
+	signal(SIGTERM, applicationCloseRequest);
+
+	fdMaster = ptyOpen(fdSlave);
+	if (fdMaster < 0)
+	{
+		fprintf(stderr, "could not open pseudo-terminal\n");
+		return 1;
+	}
+
+	srand((unsigned)time(NULL));
+	targetSimInit(bytesOutQueue);
+
+	pfd.fd = fdMaster;
+	pfd.events = POLLIN;
+
+	while (!closeRequested)
+	{
+		poll(&pfd, 1, 1);
+
+		curTimeMs = msSince(start);
+
+		// scheduler -> target
+		while (1)
+		{
+			lenDone = read(fdMaster, buf, sizeof(buf));
+			if (lenDone <= 0)
+				break;
+
+			cntBytesIn += (size_t)lenDone;
+
+			for (ssize_t i = 0; i < lenDone; ++i)
+				targetSimByteProcess(buf[i], curTimeMs);
+		}
+
+		targetSimProcess(curTimeMs);
+
+		// target -> scheduler
+		if (!bytesOut.size())
+		{
+			budget = 0;
+			lastBudgetMs = curTimeMs;
+			continue;
+		}
+
+		if ((int32_t)(curTimeMs - nextSendMs) < 0)
+			continue;
+
+		lenPlanned = bytesOut.size();
+		if (lenPlanned > sizeof(buf))
+			lenPlanned = sizeof(buf);
+
+		if (targetSimConf.throughputBps)
+		{
+			budget += (double)(curTimeMs - lastBudgetMs) * targetSimConf.throughputBps / 1000;
+			lastBudgetMs = curTimeMs;
+
+			if (budget < 1)
+				continue;
+
+			if (lenPlanned > (size_t)budget)
+				lenPlanned = (size_t)budget;
+		}
+
+		for (size_t i = 0; i < lenPlanned; ++i)
+			buf[i] = bytesOut[i];
+
+		lenDone = write(fdMaster, buf, lenPlanned);
+		if (lenDone <= 0)
+			continue;
+
+		bytesOut.erase(bytesOut.begin(), bytesOut.begin() + lenDone);
+		cntBytesOut += (size_t)lenDone;
+		budget -= (double)lenDone;
+
+		if (targetSimConf.jitterMs)
+			nextSendMs = curTimeMs + (uint32_t)(rand() % (int)(targetSimConf.jitterMs + 1));
+	}
+
+	targetSimStatsGet(cntDropped, cntCorrupted);
+
+	fprintf(stdout, "\nBytes in %zu, out %zu, dropped %zu, corrupted %zu\n",
+			cntBytesIn, cntBytesOut, cntDropped, cntCorrupted);
+
+	close(fdSlave);
+	close(fdMaster);
+
+	return 0;
+}
+
@@ -0,0 +1,223 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "UartCapturing.h"
+#include "LibCapture.h"
+#include "LibTime.h"
+
+#define dForEach_ProcState(gen) \
+		gen(StStart) \
+		gen(StMain) \
+
+#define dGenProcStateEnum(s) s,
+dProcessStateEnum(ProcState);
+
+#if 1
+#define dGenProcStateString(s) #s,
+dProcessStateStr(ProcState);
+#endif
+
+using namespace std;
+
+const size_t cSizeBufFlush = 64 * 1024;
+const size_t cNumFilesCaptureMax = 4;
+const uint32_t cIntervalFlushMs = 200;
+
+UartCapturing::UartCapturing()
+	: Processing("UartCapturing")
+	, mStartMs(0)
+	, mNameFile("")
+	, mSizeFileMax(64 * 1024 * 1024)
+	, mpFile(NULL)
+	, mSizeFile(0)
+	, mBuf()
+	, mCntBytesWritten(0)
+	, mCntRotations(0)
+{
+	mState = StStart;
+}
+
+/* member functions */
+
+void UartCapturing::fileSet(const string &nameFile)
+{
+	mNameFile = nameFile;
+}
+
+void UartCapturing::sizeFileMaxSet(size_t sizeMax)
+{
+	mSizeFileMax = sizeMax;
+}
+
+Success UartCapturing::process()
+{
+	uint32_t curTimeMs = millis();
+	uint32_t diffMs = curTimeMs - mStartMs;
+	bool ok;
+#if 0
+	dStateTrace;
+#endif
+	switch (mState)
+	{
+	case StStart:
+
+		if (!mNameFile.size())
+			return procErrLog(-1, "capture file not set");
+
+		mBuf.resize(cSizeBufFlush);
+
+		ok = fileOpen();
+		if (!ok)
+			return procErrLog(-1, "could not open capture file");
+
+		mStartMs = curTimeMs;
+		mState = StMain;
+
+		break;
+	case StMain:
+
+		ok = recordsFlush();
+		if (!ok)
+			return procErrLog(-1, "could not write capture file");
+
+		if (diffMs < cIntervalFlushMs)
+			break;
+		mStartMs = curTimeMs;
+
+		fflush(mpFile);
+
+		break;
+	default:
+		break;
+	}
+
+	return Pending;
+}
+
+Success UartCapturing::shutdown()
+{
+	captureEnabled = false;
+
+	if (mpFile)
+		recordsFlush();
+
+	fileClose();
+
+	return Positive;
+}
+
+bool UartCapturing::fileOpen()
+{
+	size_t lenDone;
+
+	mpFile = fopen(mNameFile.c_str(), "wb");
+	if (!mpFile)
+		return false;
+
+	lenDone = fwrite(cCaptureMagic, 1, cLenCaptureMagic, mpFile);
+	if (lenDone != cLenCaptureMagic)
+		return false;
+
+	mSizeFile = lenDone;
+
+	return true;
+}
+
+void UartCapturing::fileClose()
+{
+	if (!mpFile)
+		return;
+
+	fclose(mpFile);
+	mpFile = NULL;
+}
+
+/*
+ * capture.bin -> capture.bin.1 -> .. -> capture.bin.<N-1>
+ */
+bool UartCapturing::fileRotate()
+{
+	string nameOld, nameNew;
+
+	fileClose();
+
+	for (size_t i = cNumFilesCaptureMax - 1; i > 0; --i)
+	{
+		nameOld = mNameFile;
+		if (i > 1)
+			nameOld += "." + to_string(i - 1);
+
+		nameNew = mNameFile + "." + to_string(i);
+
+		rename(nameOld.c_str(), nameNew.c_str());
+	}
+
+	++mCntRotations;
+
+	return fileOpen();
+}
+
+bool UartCapturing::recordsFlush()
+{
+	size_t lenReq, lenDone;
+	bool ok;
+
+	while (1)
+	{
+		lenReq = captureFetch(mBuf.data(), mBuf.size());
+		if (!lenReq)
+			break;
+
+		if (mSizeFile + lenReq > mSizeFileMax)
+		{
+			ok = fileRotate();
+			if (!ok)
+				return false;
+		}
+
+		lenDone = fwrite(mBuf.data(), 1, lenReq, mpFile);
+		if (lenDone != lenReq)
+			return false;
+
+		mSizeFile += lenDone;
+		mCntBytesWritten += lenDone;
+	}
+
+	return true;
+}
+
+void UartCapturing::processInfo(char *pBuf, char *pBufEnd)
+{
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("File\t\t\t%s\n", mNameFile.c_str());
+	dInfo("Bytes written\t\t%zu\n", mCntBytesWritten);
+	dInfo("Records dropped\t\t%zu\n", captureDropped());
+	dInfo("Rotations\t\t%zu\n", mCntRotations);
+}
+
+/* static functions */
+
@@ -0,0 +1,91 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 18.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UART_CAPTURING_H
+#define UART_CAPTURING_H
+
+#include <string>
+#include <vector>
+
+#include "Processing.h"
+
+class UartCapturing : public Processing
+{
+
+public:
+
+	static UartCapturing *create()
+	{
+		return new dNoThrow UartCapturing;
+	}
+
+	void fileSet(const std::string &nameFile);
+	void sizeFileMaxSet(size_t sizeMax);
+
+protected:
+
+	UartCapturing();
+	virtual ~UartCapturing() {}
+
+private:
+
+	UartCapturing(const UartCapturing &) = delete;
+	UartCapturing &operator=(const UartCapturing &) = delete;
+
+	/*
+	 * Naming of functions:  objectVerb()
+	 * Example:              peerAdd()
+	 */
+
+	/* member functions */
+	Success process();
+	Success shutdown();
+	void processInfo(char *pBuf, char *pBufEnd);
+
+	bool fileOpen();
+	void fileClose();
+	bool fileRotate();
+	bool recordsFlush();
+
+	/* member variables */
+	uint32_t mStartMs;
+	std::string mNameFile;
+	size_t mSizeFileMax;
+	FILE *mpFile;
+	size_t mSizeFile;
+	std::vector<uint8_t> mBuf;
+	size_t mCntBytesWritten;
+	size_t mCntRotations;
+
+	/* static functions */
+
+	/* static variables */
+
+	/* constants */
+
+};
+
+#endif
+
@@ -32,12 +32,35 @@ struct Environment
 	uint8_t ctrlManual;
 	std::string codeUart;
 	std::string deviceUart;
+	bool protoV1Only;
+	uint32_t numCmdsInFlightMax;
+	uint32_t depthGather;
+	bool pollOnly;
+	std::string dirCache;
+	std::string cmdIdFw;
+	std::string prefixIdFw;
+	std::string fileReplay;
+	bool replayRealtime;
+	std::string fileCapture;
+	bool targetSim;
+	bool levelLogAuto;
+	uint8_t levelLogIdle;
+	std::string dirLogStore;
+	uint8_t fsyncLogStore;
+	uint32_t sizeLogStoreMaxMb;
+	std::string dirScripts;
 	uint32_t rateRefreshMs;
+	std::string budget;
 	uint16_t startPortsOrb;
 	uint16_t startPortsTarget;
 };
 
 extern Environment env;
 
+const int cRateRefreshMinMs = 10;
+const int cRateRefreshMaxMs = 20000;
+
+const uint8_t cLevelLogIdleRestore = 0xFF;
+
 #endif
 
@@ -45,6 +45,14 @@
 #include "TclapOutput.h"
 #endif
 #include "GwSupervising.h"
+#include "LibUart.h"
+#include "LibCapture.h"
+#include "LibTargetSim.h"
+#include "LibTracing.h"
+#include "LibLogStore.h"
+#include "LibProcHistory.h"
+#include "LibSampling.h"
+#include "SingleWireScheduling.h"
 #include "LibDspc.h"
 
 #include "env.h"
@@ -65,8 +73,7 @@ using namespace TCLAP;
 #endif
 
 const int cRateRefreshDefaultMs = 500;
-const int cRateRefreshMinMs = 10;
-const int cRateRefreshMaxMs = 20000;
+#define dCmdIdFwDefault		"infoFirmware"
 #define dStartPortsOrbDefault "2000"
 #define dStartPortsTargetDefault "3000"
 const int cPortMax = 64000;
@@ -140,7 +147,25 @@ int main(int argc, char *argv[])
 	env.ctrlManual = 0;
 	env.codeUart = dCodeUartDefault;
 	env.deviceUart = dDeviceUartDefault;
+	env.protoV1Only = false;
+	env.numCmdsInFlightMax = 4;
+	env.depthGather = 4;
+	env.pollOnly = false;
+	env.dirCache = "";
+	env.cmdIdFw = dCmdIdFwDefault;
+	env.prefixIdFw = "";
+	env.fileReplay = "";
+	env.replayRealtime = false;
+	env.fileCapture = "";
+	env.targetSim = false;
+	env.levelLogAuto = false;
+	env.levelLogIdle = cLevelLogIdleRestore;
+	env.dirLogStore = "";
+	env.fsyncLogStore = LogStoreFsyncInterval;
+	env.sizeLogStoreMaxMb = 1024;
+	env.dirScripts = "";
 	env.rateRefreshMs = cRateRefreshDefaultMs;
+	env.budget = "";
 
 	env.startPortsOrb = atoi(dStartPortsOrbDefault);
 	env.startPortsTarget = atoi(dStartPortsTargetDefault);
@@ -167,6 +192,16 @@ int main(int argc, char *argv[])
 #endif
 	SwitchArg argCtrlManual("", "ctrl-manual", "Use manual control (automatic control disabled)", false);
 	cmd.add(argCtrlManual);
+	SwitchArg argProtoV1("", "proto-v1", "Don't negotiate SingleWire v2 with the target", false);
+	cmd.add(argProtoV1);
+	ValueArg<uint32_t> argCmdsInFlight("", "cmds-in-flight", "Commands sent to the target before the first response. 1: Disabled. Default: 4",
+								false, env.numCmdsInFlightMax, "uint32");
+	cmd.add(argCmdsInFlight);
+	ValueArg<uint32_t> argDepthGather("", "gather-depth", "Help requests queued while enumerating the target commands. 1: One at a time. Default: 4",
+								false, env.depthGather, "uint32");
+	cmd.add(argDepthGather);
+	SwitchArg argPollOnly("", "poll-only", "Always poll the target. Don't negotiate push mode", false);
+	cmd.add(argPollOnly);
 	ValueArg<string> argCodeUart("c", "code", "Code used for UART initialization. Default: " dCodeUartDefault,
 								false, env.codeUart, "string");
 	cmd.add(argCodeUart);
@@ -176,6 +211,73 @@ int main(int argc, char *argv[])
 	ValueArg<uint32_t> argRateRefreshMs("", "refresh-rate", "Refresh rate of process tree in [ms]",
 								false, env.rateRefreshMs, "uint16");
 	cmd.add(argRateRefreshMs);
+	ValueArg<string> argBudget("", "budget", "Link shares in [%]: proc:<min>-<max>,log:<min>-<max>,cmd:<min>-<max>. Default: No limits",
+								false, env.budget, "string");
+	cmd.add(argBudget);
+	ValueArg<string> argDirCache("", "cache-dir", "Directory used to cache the command list of the target. Default: Disabled",
+								false, env.dirCache, "string");
+	cmd.add(argDirCache);
+	ValueArg<string> argCmdIdFw("", "cmd-id-fw", "Target command used to identify the firmware. Default: " dCmdIdFwDefault,
+								false, env.cmdIdFw, "string");
+	cmd.add(argCmdIdFw);
+	ValueArg<string> argPrefixIdFw("", "id-fw-prefix", "Expected start of the firmware identity. Default: Any answer",
+								false, env.prefixIdFw, "string");
+	cmd.add(argPrefixIdFw);
+	ValueArg<string> argReplay("", "replay", "Feed recorded UART data from file instead of using the device",
+								false, env.fileReplay, "string");
+	cmd.add(argReplay);
+	SwitchArg argReplayRealtime("", "replay-realtime", "Replay with original timing. Default: As fast as possible", false);
+	cmd.add(argReplayRealtime);
+	ValueArg<string> argCapture("", "capture", "Record UART traffic to file",
+								false, env.fileCapture, "string");
+	cmd.add(argCapture);
+	ValueArg<string> argCaptureDecode("", "capture-decode", "Print SingleWire frames of capture file and exit",
+								false, "", "string");
+	cmd.add(argCaptureDecode);
+	SwitchArg argSim("", "sim", "Use in-process target simulator instead of the device", false);
+	cmd.add(argSim);
+	ValueArg<uint32_t> argSimProcs("", "sim-procs", "Number of simulated processes",
+								false, targetSimConf.numProcs, "uint32");
+	cmd.add(argSimProcs);
+	ValueArg<uint32_t> argSimLogRate("", "sim-log-rate", "Simulated log entries per second",
+								false, targetSimConf.rateLogPerSec, "uint32");
+	cmd.add(argSimLogRate);
+	ValueArg<uint32_t> argSimLatency("", "sim-latency", "Simulated command latency in [ms]",
+								false, targetSimConf.latencyCmdMs, "uint32");
+	cmd.add(argSimLatency);
+	ValueArg<uint32_t> argTraceSample("", "trace-sample", "Trace every Nth command. Default: Disabled",
+								false, cmdTraceSampleRate, "uint32");
+	cmd.add(argTraceSample);
+	ValueArg<string> argTraceFile("", "trace-file", "Write command traces in Chrome trace format to file on exit",
+								false, cmdTraceFile, "string");
+	cmd.add(argTraceFile);
+	ValueArg<uint32_t> argProcHist("", "proc-history", "Memory used for process tree history in [MiB]. 0: Disabled. Default: 16",
+								false, (uint32_t)(procHistSizeMax >> 20), "uint32");
+	cmd.add(argProcHist);
+	ValueArg<uint32_t> argSampleRing("", "sample-ring", "Samples kept in memory per variable. 0: Disabled. Default: 1048576",
+								false, (uint32_t)sampleRingSizeMax, "uint32");
+	cmd.add(argSampleRing);
+	ValueArg<string> argSampleSpill("", "sample-spill", "Directory used to store samples dropped from memory. Default: Disabled",
+								false, sampleDirSpill, "string");
+	cmd.add(argSampleSpill);
+
+	SwitchArg argLevelLogAuto("", "log-level-auto", "Set log level of target based on connected log peers", false);
+	cmd.add(argLevelLogAuto);
+	ValueArg<string> argLevelLogIdle("", "log-level-idle", "Log level of target without log consumers: 0-5 or restore. Default: restore",
+								false, "restore", "string");
+	cmd.add(argLevelLogIdle);
+	ValueArg<string> argLogStore("", "log-store", "Directory used to store target logs. Default: Disabled",
+								false, env.dirLogStore, "string");
+	cmd.add(argLogStore);
+	ValueArg<string> argLogStoreFsync("", "log-store-fsync", "When to sync log store to disk: never, block, interval. Default: interval",
+								false, "interval", "string");
+	cmd.add(argLogStoreFsync);
+	ValueArg<uint32_t> argLogStoreSize("", "log-store-size", "Maximum size of log store in [MiB]",
+								false, env.sizeLogStoreMaxMb, "uint32");
+	cmd.add(argLogStoreSize);
+	ValueArg<string> argDirScripts("", "script-dir", "Directory containing command scripts <name>.txt. Default: Disabled",
+								false, env.dirScripts, "string");
+	cmd.add(argDirScripts);
 
 	ValueArg<uint16_t> argStartPortOrb("", "start-ports-orb", "Start of 3-port interface for CodeOrb. Default: " dStartPortsOrbDefault,
 								false, env.startPortsOrb, "uint16");
@@ -193,11 +295,70 @@ int main(int argc, char *argv[])
 	levelLogSet(env.verbosity);
 
 	env.ctrlManual = argCtrlManual.getValue() ? 1 : 0;
+	env.protoV1Only = argProtoV1.getValue();
+	env.numCmdsInFlightMax = argCmdsInFlight.getValue();
+	env.depthGather = argDepthGather.getValue();
+	env.pollOnly = argPollOnly.getValue();
 #if defined(__unix__)
 	env.coreDump = argCoreDump.getValue();
 #endif
 	env.codeUart = argCodeUart.getValue();
 	env.deviceUart = argDevUart.getValue();
+	env.dirCache = argDirCache.getValue();
+	env.cmdIdFw = argCmdIdFw.getValue();
+	env.prefixIdFw = argPrefixIdFw.getValue();
+	env.fileReplay = argReplay.getValue();
+	env.replayRealtime = argReplayRealtime.getValue();
+	env.fileCapture = argCapture.getValue();
+	env.targetSim = argSim.getValue();
+	env.levelLogAuto = argLevelLogAuto.getValue();
+
+	if (argLevelLogIdle.getValue() != "restore")
+	{
+		const string &str = argLevelLogIdle.getValue();
+
+		if (str.size() != 1 || str[0] < '0' || str[0] > '5')
+		{
+			errLog(-1, "invalid idle log level");
+			return 1;
+		}
+
+		env.levelLogIdle = str[0] - '0';
+	}
+
+	env.dirLogStore = argLogStore.getValue();
+	env.sizeLogStoreMaxMb = argLogStoreSize.getValue();
+	env.dirScripts = argDirScripts.getValue();
+
+	if (argLogStoreFsync.getValue() == "never")
+		env.fsyncLogStore = LogStoreFsyncNever;
+	else
+	if (argLogStoreFsync.getValue() == "block")
+		env.fsyncLogStore = LogStoreFsyncBlock;
+
+	targetSimConf.numProcs = argSimProcs.getValue();
+	targetSimConf.rateLogPerSec = argSimLogRate.getValue();
+	targetSimConf.latencyCmdMs = argSimLatency.getValue();
+
+	cmdTraceSampleRate = argTraceSample.getValue();
+	cmdTraceFile = argTraceFile.getValue();
+
+	if (cmdTraceFile.size() && !cmdTraceSampleRate)
+		cmdTraceSampleRate = 1;
+
+	procHistSizeMax = (size_t)argProcHist.getValue() << 20;
+	sampleRingSizeMax = argSampleRing.getValue();
+	sampleDirSpill = argSampleSpill.getValue();
+
+	if (argCaptureDecode.getValue().size())
+		return captureDecode(argCaptureDecode.getValue());
+
+	env.budget = argBudget.getValue();
+	if (!SingleWireScheduling::budgetParse(env.budget, NULL, NULL))
+	{
+		errLog(-1, "invalid link budget");
+		return 1;
+	}
 
 	uint32_t ures = argRateRefreshMs.getValue();
 	if (ures > cRateRefreshMinMs &&
@@ -243,6 +404,19 @@ int main(int argc, char *argv[])
 	signal(SIGINT, applicationCloseRequest);
 	signal(SIGTERM, applicationCloseRequest);
 #endif
+	if (env.fileReplay.size() &&
+			!uartReplayOpen(env.fileReplay, env.replayRealtime))
+	{
+		errLog(-1, "could not open replay file");
+		return 1;
+	}
+
+	if (env.targetSim)
+	{
+		targetSimConf.codeInit = env.codeUart;
+		uartSimStart();
+	}
+
 	pApp = GwSupervising::create();
 	if (!pApp)
 	{
@@ -252,6 +426,9 @@ int main(int argc, char *argv[])
 
 	pApp->procTreeDisplaySet(true);
 
+	bool replayFast = env.fileReplay.size() && !env.replayRealtime;
+	bool closeRequested = false;
+
 	while (1)
 	{
 		for (int i = 0; i < 12; ++i)
@@ -260,12 +437,24 @@ int main(int argc, char *argv[])
 		if (!pApp->progress())
 			break;
 
+		if (env.fileReplay.size() && uartReplayDone() && !closeRequested)
+		{
+			pApp->unusedSet();
+			closeRequested = true;
+		}
+
+		if (replayFast)
+			continue;
+
 		this_thread::sleep_for(chrono::milliseconds(15));
 	}
 
 	Success success = pApp->success();
 	Processing::destroy(pApp);
 
+	if (cmdTraceFile.size() && !cmdTraceSave(cmdTraceFile))
+		errLog(-1, "could not write command traces");
+
 	Processing::applicationClose();
 
 	filesStdClose();